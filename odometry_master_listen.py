@@ -2,8 +2,8 @@
 from cvra_rpc.message import *
 
 def odometry_raw_cb(args):
-    x, y, theta = tuple(args)
-    print("{:.3f} {:.3f} {:.3f}".format(x, y, theta))
+    x, y, theta, seq, local_ts, unix_s, unix_us = tuple(args)
+    print("{} {}.{:06d} {:.3f} {:.3f} {:.3f}".format(seq, unix_s, unix_us, x, y, theta))
 
 TARGET = ('0.0.0.0', 20000)
 callbacks = {'odometry_raw': odometry_raw_cb}
@@ -1,3 +1,4 @@
 RPC_PORT = 20001
 MSG_PORT = 20000
 BUTTON_PRESS_CALLBACK_PORT = 20002
+FIRMWARE_UPDATE_PORT = 20005
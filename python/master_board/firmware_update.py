@@ -0,0 +1,68 @@
+import socket
+import struct
+import zlib
+
+from cvra_rpc import service_call
+from master_board import FIRMWARE_UPDATE_PORT
+
+
+class State:
+    """
+    Update state of a node, as reported by firmware_update_status.
+    """
+    Idle = 0
+    Pending = 1
+    Beginning = 2
+    Reading = 3
+    Done = 4
+    Failed = 5
+
+
+IMAGE_ERRORS = {
+    1: "image too large",
+    2: "bad CRC",
+    3: "an update is running",
+    4: "image truncated",
+}
+
+
+def upload_image(host, image):
+    """
+    Uploads a firmware image to the master, which keeps it in flash.
+
+    host is the IP address of the master. The robot must be stopped, as
+    writing the image stalls the master for a few seconds.
+    """
+    header = struct.pack('<II', len(image), zlib.crc32(image) & 0xffffffff)
+    conn = socket.create_connection((host, FIRMWARE_UPDATE_PORT), timeout=10)
+    try:
+        conn.sendall(header + image)
+        status = conn.recv(1)
+    finally:
+        conn.close()
+
+    if not status:
+        raise RuntimeError("Firmware upload: no answer")
+    if ord(status[0:1]) != 0:
+        raise RuntimeError("Firmware upload: {}".format(
+            IMAGE_ERRORS.get(ord(status[0:1]), "unknown error")))
+
+
+def update_nodes(host, node_ids):
+    """
+    Updates the given nodes with the image uploaded last.
+
+    host is the (address, port) of the RPC server of the master.
+    """
+    res = service_call.call(host, 'firmware_update_start', list(node_ids))
+    if res is not True:
+        raise RuntimeError("Error starting firmware update: {}".format(str(res)))
+
+
+def status(host):
+    """
+    Returns the size of the image and a dict of node ID to
+    (state, bytes read, attempts, error).
+    """
+    image_size, nodes = service_call.call(host, 'firmware_update_status', [])
+    return image_size, {node: tuple(s) for node, s in nodes.items()}
@@ -0,0 +1,53 @@
+import struct
+import unittest
+import zlib
+from master_board import firmware_update, FIRMWARE_UPDATE_PORT
+
+try:
+    import unittest.mock as mock
+except ImportError:
+    import mock
+
+
+class FirmwareUpdateTestCase(unittest.TestCase):
+    @mock.patch('socket.create_connection')
+    def test_upload_image(self, create_connection):
+        conn = create_connection.return_value
+        conn.recv.return_value = b'\x00'
+        image = b'\x01\x02\x03'
+
+        firmware_update.upload_image('10.0.10.2', image)
+
+        create_connection.assert_called_with(('10.0.10.2', FIRMWARE_UPDATE_PORT),
+                                             timeout=10)
+        header = struct.pack('<II', 3, zlib.crc32(image) & 0xffffffff)
+        conn.sendall.assert_called_with(header + image)
+
+    @mock.patch('socket.create_connection')
+    def test_upload_error(self, create_connection):
+        create_connection.return_value.recv.return_value = b'\x02'
+
+        with self.assertRaises(RuntimeError):
+            firmware_update.upload_image('10.0.10.2', b'\x01')
+
+    @mock.patch('cvra_rpc.service_call.call')
+    def test_update_nodes(self, call):
+        call.return_value = True
+        firmware_update.update_nodes('host', [10, 11])
+        call.assert_any_call('host', 'firmware_update_start', [10, 11])
+
+    @mock.patch('cvra_rpc.service_call.call')
+    def test_update_without_image(self, call):
+        call.return_value = "Error: no firmware image."
+
+        with self.assertRaises(RuntimeError):
+            firmware_update.update_nodes('host', [10])
+
+    @mock.patch('cvra_rpc.service_call.call')
+    def test_status(self, call):
+        call.return_value = [1000, {10: [4, 1000, 1, 0]}]
+
+        size, nodes = firmware_update.status('host')
+
+        self.assertEqual(size, 1000)
+        self.assertEqual(nodes[10][0], firmware_update.State.Done)
@@ -125,6 +125,26 @@ void bus_enumerator_update_node_info(bus_enumerator_t *en, const char *str_id, u
     }
 }
 
+void bus_enumerator_clear_node_info(bus_enumerator_t *en, const char *str_id)
+{
+    uint16_t index = index_by_str_id(en, str_id);
+
+    if (index == BUS_ENUMERATOR_INDEX_NOT_FOUND ||
+        en->str_to_can[index].can_id == BUS_ENUMERATOR_CAN_ID_NOT_SET) {
+        return;
+    }
+
+    uint16_t can_index = index_by_can_id(en, en->str_to_can[index].can_id);
+    if (can_index != BUS_ENUMERATOR_INDEX_NOT_FOUND) {
+        memmove(&en->can_to_str[can_index],
+                &en->can_to_str[can_index + 1],
+                (en->nb_entries_can_to_str - can_index - 1) * sizeof(bus_enumerator_entry_t));
+        en->nb_entries_can_to_str--;
+    }
+
+    en->str_to_can[index].can_id = BUS_ENUMERATOR_CAN_ID_NOT_SET;
+}
+
 uint16_t bus_enumerator_get_number_of_entries(bus_enumerator_t *en)
 {
     return en->nb_entries_str_to_can;
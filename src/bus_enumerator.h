@@ -59,6 +59,10 @@ void bus_enumerator_add_node(bus_enumerator_t *en, const char *str_id, void *dri
 // called by the CAN driver
 void bus_enumerator_update_node_info(bus_enumerator_t *en, const char *str_id, uint8_t can_id);
 
+// forgets the CAN ID of a node, for example when it was preloaded from a
+// cache and turned out to be wrong
+void bus_enumerator_clear_node_info(bus_enumerator_t *en, const char *str_id);
+
 uint16_t bus_enumerator_get_number_of_entries(bus_enumerator_t *en);
 
 uint8_t bus_enumerator_get_can_id(bus_enumerator_t *en, const char *str_id);
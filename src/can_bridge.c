@@ -0,0 +1,113 @@
+#include <string.h>
+#include "can_bridge.h"
+
+static void write_u16(uint8_t *p, uint16_t v)
+{
+    p[0] = v;
+    p[1] = v >> 8;
+}
+
+static void write_u32(uint8_t *p, uint32_t v)
+{
+    p[0] = v;
+    p[1] = v >> 8;
+    p[2] = v >> 16;
+    p[3] = v >> 24;
+}
+
+static uint32_t read_u32(const uint8_t *p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+void can_bridge_batch_start(can_bridge_batch_t *b, uint8_t *buffer, size_t size,
+                            uint16_t sequence, uint32_t dropped)
+{
+    b->buffer = buffer;
+    b->size = size;
+    b->buffer[0] = CAN_BRIDGE_VERSION;
+    b->buffer[1] = 0;
+    write_u16(&b->buffer[2], sequence);
+    write_u32(&b->buffer[4], dropped);
+    b->pos = CAN_BRIDGE_HEADER_LEN;
+}
+
+bool can_bridge_batch_append(can_bridge_batch_t *b, const can_bridge_frame_t *frame)
+{
+    uint8_t dlc = frame->dlc > 8 ? 8 : frame->dlc;
+
+    if (b->pos + 10 + dlc > b->size || b->buffer[1] == UINT8_MAX) {
+        return false;
+    }
+
+    uint8_t *p = &b->buffer[b->pos];
+    write_u32(&p[0], frame->timestamp_us);
+    write_u32(&p[4], frame->id);
+    p[8] = frame->flags;
+    p[9] = dlc;
+    memcpy(&p[10], frame->data, dlc);
+
+    b->pos += 10 + dlc;
+    b->buffer[1]++;
+    return true;
+}
+
+uint8_t can_bridge_batch_nb_frames(const can_bridge_batch_t *b)
+{
+    return b->buffer[1];
+}
+
+size_t can_bridge_batch_len(const can_bridge_batch_t *b)
+{
+    return b->pos;
+}
+
+int can_bridge_decode(const uint8_t *buffer, size_t len,
+                      can_bridge_frame_t *frames, int max_frames)
+{
+    if (len < CAN_BRIDGE_HEADER_LEN || buffer[0] != CAN_BRIDGE_VERSION) {
+        return -1;
+    }
+    int nb_frames = buffer[1];
+    if (nb_frames > max_frames) {
+        return -1;
+    }
+
+    size_t pos = CAN_BRIDGE_HEADER_LEN;
+    int i;
+    for (i = 0; i < nb_frames; i++) {
+        if (pos + 10 > len) {
+            return -1;
+        }
+        const uint8_t *p = &buffer[pos];
+        uint8_t dlc = p[9];
+        if (dlc > 8 || pos + 10 + dlc > len) {
+            return -1;
+        }
+        frames[i].timestamp_us = read_u32(&p[0]);
+        frames[i].id = read_u32(&p[4]);
+        frames[i].flags = p[8];
+        frames[i].dlc = dlc;
+        memcpy(frames[i].data, &p[10], dlc);
+        pos += 10 + dlc;
+    }
+
+    if (pos != len) {
+        return -1;
+    }
+    return nb_frames;
+}
+
+bool can_bridge_filter_match(const can_bridge_filter_t *filters, int nb_filters, uint32_t id)
+{
+    int i;
+    if (nb_filters == 0) {
+        return true;
+    }
+    for (i = 0; i < nb_filters; i++) {
+        if ((id & filters[i].mask) == (filters[i].id & filters[i].mask)) {
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,96 @@
+#ifndef CAN_BRIDGE_H
+#define CAN_BRIDGE_H
+
+/*
+
+# CAN bridge datagrams
+
+Raw CAN frames are exchanged with the PC in batches, one UDP datagram
+holding as many frames as fit. All fields are little endian.
+
+    header: uint8 version, uint8 nb_frames, uint16 sequence, uint32 dropped
+    frame:  uint32 timestamp [us], uint32 id, uint8 flags, uint8 dlc, data[dlc]
+
+The id has the SocketCAN flags: bit 31 for extended frames, 30 for remote
+frames. Timestamps are taken when the frame was received by the CAN
+peripheral, in the clock of the timestamp module. dropped is the number of
+frames lost on the master because the bridge could not keep up.
+
+The PC injects frames with datagrams of the same format, whose timestamps
+and sequence numbers are ignored.
+
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define CAN_BRIDGE_VERSION          1
+#define CAN_BRIDGE_HEADER_LEN       8
+#define CAN_BRIDGE_FRAME_MAX_LEN    18
+
+#define CAN_BRIDGE_ID_EXT           (1u << 31)
+#define CAN_BRIDGE_ID_RTR           (1u << 30)
+#define CAN_BRIDGE_ID_MASK          0x1fffffff
+
+/** Frame flags. */
+#define CAN_BRIDGE_FLAG_TX          (1 << 0) /**< Sent by the master. */
+
+#define CAN_BRIDGE_MAX_FILTERS      8
+
+typedef struct {
+    uint32_t timestamp_us;
+    uint32_t id;
+    uint8_t flags;
+    uint8_t dlc;
+    uint8_t data[8];
+} can_bridge_frame_t;
+
+typedef struct {
+    uint8_t *buffer;
+    size_t size;
+    size_t pos;
+} can_bridge_batch_t;
+
+/** A frame matches if (id & mask) == (filter id & mask). */
+typedef struct {
+    uint32_t id;
+    uint32_t mask;
+} can_bridge_filter_t;
+
+/** Starts a datagram in buffer, which must hold at least the header. */
+void can_bridge_batch_start(can_bridge_batch_t *b, uint8_t *buffer, size_t size,
+                            uint16_t sequence, uint32_t dropped);
+
+/** Appends a frame to the datagram.
+ *
+ * @return false if it does not fit, the datagram is then left unchanged.
+ */
+bool can_bridge_batch_append(can_bridge_batch_t *b, const can_bridge_frame_t *frame);
+
+uint8_t can_bridge_batch_nb_frames(const can_bridge_batch_t *b);
+
+/** @return Length of the datagram so far, in bytes. */
+size_t can_bridge_batch_len(const can_bridge_batch_t *b);
+
+/** Reads the frames of a datagram.
+ *
+ * @return The number of frames read, or -1 if the datagram is malformed or
+ * holds more than max_frames frames.
+ */
+int can_bridge_decode(const uint8_t *buffer, size_t len,
+                      can_bridge_frame_t *frames, int max_frames);
+
+/** Tells whether a frame id passes the filters. No filter lets everything
+ * through. */
+bool can_bridge_filter_match(const can_bridge_filter_t *filters, int nb_filters, uint32_t id);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CAN_BRIDGE_H */
@@ -0,0 +1,240 @@
+#include <ch.h>
+#include <lwip/api.h>
+#include <lwip/udp.h>
+#include <lwip/tcpip.h>
+#include "priorities.h"
+#include "spsc_queue.h"
+#include "can_bridge_server.h"
+
+#define CAN_BRIDGE_STACKSIZE        1024
+#define FORWARD_QUEUE_LEN           256
+#define INJECT_QUEUE_LEN            64
+#define DATAGRAM_SIZE               512
+/* Frames wait at most that long for a datagram to fill up. */
+#define BATCH_TIMEOUT_MS            5
+#define SUBSCRIPTION_TIMEOUT_MS     5000
+
+static spsc_queue_t forward_queue;
+static can_bridge_frame_t forward_buffer[FORWARD_QUEUE_LEN];
+static BSEMAPHORE_DECL(frames_forwarded, true);
+
+static spsc_queue_t inject_queue;
+static can_bridge_frame_t inject_buffer[INJECT_QUEUE_LEN];
+
+static can_bridge_filter_t filters[CAN_BRIDGE_MAX_FILTERS];
+static int nb_filters = 0;
+
+static can_bridge_stats_t stats;
+
+// host the frames are forwarded to
+static volatile bool subscribed = false;
+static ip_addr_t subscriber;
+static uint16_t subscriber_port;
+static systime_t last_subscription;
+
+void can_bridge_forward(const can_bridge_frame_t *frame)
+{
+    if (!subscribed) {
+        return;
+    }
+
+    chSysLock();
+    bool match = can_bridge_filter_match(filters, nb_filters, frame->id);
+    if (!match) {
+        stats.filtered++;
+    }
+    chSysUnlock();
+    if (!match) {
+        return;
+    }
+
+    if (spsc_queue_push(&forward_queue, frame)) {
+        chBSemSignal(&frames_forwarded);
+    } else {
+        chSysLock();
+        stats.dropped++;
+        chSysUnlock();
+    }
+}
+
+bool can_bridge_pop_injected(can_bridge_frame_t *frame)
+{
+    return spsc_queue_pop(&inject_queue, frame);
+}
+
+void can_bridge_injected(bool sent)
+{
+    chSysLock();
+    if (sent) {
+        stats.injected++;
+    } else {
+        stats.inject_dropped++;
+    }
+    chSysUnlock();
+}
+
+void can_bridge_set_filters(const can_bridge_filter_t *new_filters, int nb_new_filters)
+{
+    int i;
+    if (nb_new_filters > CAN_BRIDGE_MAX_FILTERS) {
+        nb_new_filters = CAN_BRIDGE_MAX_FILTERS;
+    }
+    chSysLock();
+    for (i = 0; i < nb_new_filters; i++) {
+        filters[i] = new_filters[i];
+    }
+    nb_filters = nb_new_filters;
+    chSysUnlock();
+}
+
+void can_bridge_get_stats(can_bridge_stats_t *s)
+{
+    chSysLock();
+    *s = stats;
+    chSysUnlock();
+}
+
+/* Called by the tcpip thread for each datagram on CAN_BRIDGE_PORT. */
+static void can_bridge_recv_cb(void *arg, struct udp_pcb *pcb, struct pbuf *p,
+                               ip_addr_t *addr, u16_t port)
+{
+    static uint8_t buffer[DATAGRAM_SIZE];
+    static can_bridge_frame_t frames[DATAGRAM_SIZE / 10];
+    (void) arg;
+    (void) pcb;
+
+    chSysLock();
+    ip_addr_copy(subscriber, *addr);
+    subscriber_port = port;
+    last_subscription = chVTGetSystemTimeX();
+    subscribed = true;
+    chSysUnlock();
+
+    int nb_frames = -1;
+    if (p->tot_len <= sizeof(buffer)) {
+        pbuf_copy_partial(p, buffer, p->tot_len, 0);
+        nb_frames = can_bridge_decode(buffer, p->tot_len, frames, DATAGRAM_SIZE / 10);
+    }
+    pbuf_free(p);
+
+    int i, nb_dropped = 0;
+    for (i = 0; i < nb_frames; i++) {
+        if (!spsc_queue_push(&inject_queue, &frames[i])) {
+            nb_dropped++;
+        }
+    }
+
+    chSysLock();
+    if (nb_frames < 0) {
+        stats.decode_errors++;
+    }
+    stats.inject_dropped += nb_dropped;
+    chSysUnlock();
+}
+
+static void can_bridge_start(void *arg)
+{
+    struct udp_pcb *pcb;
+    (void) arg;
+
+    pcb = udp_new();
+    if (pcb == NULL) {
+        chSysHalt("Cannot create CAN bridge (out of memory).");
+    }
+    udp_bind(pcb, IP_ADDR_ANY, CAN_BRIDGE_PORT);
+    udp_recv(pcb, can_bridge_recv_cb, NULL);
+}
+
+static void send_batch(struct netconn *conn, can_bridge_batch_t *batch)
+{
+    ip_addr_t addr;
+    uint16_t port;
+    struct netbuf *buf;
+
+    chSysLock();
+    ip_addr_copy(addr, subscriber);
+    port = subscriber_port;
+    chSysUnlock();
+
+    buf = netbuf_new();
+    if (buf == NULL) {
+        return;
+    }
+    netbuf_ref(buf, batch->buffer, can_bridge_batch_len(batch));
+    if (netconn_sendto(conn, buf, &addr, port) == ERR_OK) {
+        chSysLock();
+        stats.datagrams++;
+        chSysUnlock();
+    }
+    netbuf_delete(buf);
+}
+
+static THD_WORKING_AREA(wa_can_bridge, CAN_BRIDGE_STACKSIZE);
+
+static void can_bridge_thread(void *arg)
+{
+    static uint8_t buffer[DATAGRAM_SIZE];
+    can_bridge_batch_t batch;
+    can_bridge_frame_t frame;
+    uint16_t sequence = 0;
+    systime_t batch_start = 0;
+    struct netconn *conn;
+    (void) arg;
+
+    chRegSetThreadName("can_bridge");
+
+    conn = netconn_new(NETCONN_UDP);
+    if (conn == NULL) {
+        chSysHalt("Cannot create CAN bridge connection (out of memory).");
+    }
+
+    can_bridge_batch_start(&batch, buffer, sizeof(buffer), sequence, 0);
+
+    while (1) {
+        chBSemWaitTimeout(&frames_forwarded, MS2ST(BATCH_TIMEOUT_MS));
+
+        if (subscribed &&
+            chVTTimeElapsedSinceX(last_subscription) > MS2ST(SUBSCRIPTION_TIMEOUT_MS)) {
+            subscribed = false;
+        }
+
+        while (spsc_queue_pop(&forward_queue, &frame)) {
+            if (can_bridge_batch_nb_frames(&batch) == 0) {
+                batch_start = chVTGetSystemTime();
+            }
+            if (!can_bridge_batch_append(&batch, &frame)) {
+                send_batch(conn, &batch);
+                can_bridge_batch_start(&batch, buffer, sizeof(buffer), ++sequence, stats.dropped);
+                batch_start = chVTGetSystemTime();
+                can_bridge_batch_append(&batch, &frame);
+            }
+            chSysLock();
+            stats.forwarded_frames++;
+            stats.forwarded_bytes += frame.dlc;
+            chSysUnlock();
+        }
+
+        if (can_bridge_batch_nb_frames(&batch) > 0 &&
+            chVTTimeElapsedSinceX(batch_start) >= MS2ST(BATCH_TIMEOUT_MS)) {
+            send_batch(conn, &batch);
+            can_bridge_batch_start(&batch, buffer, sizeof(buffer), ++sequence, stats.dropped);
+        }
+    }
+}
+
+void can_bridge_server_init(void)
+{
+    spsc_queue_init(&forward_queue, forward_buffer, sizeof(can_bridge_frame_t),
+                    FORWARD_QUEUE_LEN);
+    spsc_queue_init(&inject_queue, inject_buffer, sizeof(can_bridge_frame_t),
+                    INJECT_QUEUE_LEN);
+
+    chThdCreateStatic(wa_can_bridge,
+                      sizeof(wa_can_bridge),
+                      CAN_BRIDGE_PRIO,
+                      can_bridge_thread,
+                      NULL);
+
+    /* The raw API may only be used from the tcpip thread. */
+    tcpip_callback_with_block(can_bridge_start, NULL, 1);
+}
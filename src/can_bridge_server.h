@@ -0,0 +1,58 @@
+#ifndef CAN_BRIDGE_SERVER_H
+#define CAN_BRIDGE_SERVER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "can_bridge.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define CAN_BRIDGE_PORT 20004
+
+typedef struct {
+    uint32_t forwarded_frames;  /**< Frames sent to the PC. */
+    uint32_t forwarded_bytes;   /**< Payload bytes of those frames. */
+    uint32_t filtered;          /**< Frames which did not pass the filters. */
+    uint32_t dropped;           /**< Frames lost because the bridge thread fell behind. */
+    uint32_t datagrams;         /**< Datagrams sent to the PC. */
+    uint32_t injected;          /**< Frames from the PC sent on the bus. */
+    uint32_t inject_dropped;    /**< Frames from the PC which could not be sent. */
+    uint32_t decode_errors;     /**< Malformed datagrams from the PC. */
+} can_bridge_stats_t;
+
+/** Starts the Ethernet to CAN bridge on UDP port CAN_BRIDGE_PORT.
+ *
+ * Frames are forwarded to the last host which sent a datagram to the port,
+ * for as long as it keeps sending one at least every 5 s. Datagrams without
+ * frames can be used for that.
+ */
+void can_bridge_server_init(void);
+
+/** Hands a frame seen on the bus to the bridge.
+ *
+ * Called from the CAN thread, never blocks. Returns immediately when nobody
+ * is listening.
+ */
+void can_bridge_forward(const can_bridge_frame_t *frame);
+
+/** Gets the next frame to send on the bus on behalf of the PC.
+ *
+ * @return false if there is none.
+ */
+bool can_bridge_pop_injected(can_bridge_frame_t *frame);
+
+/** Reports whether a frame returned by can_bridge_pop_injected was sent. */
+void can_bridge_injected(bool sent);
+
+/** Only forwards frames passing one of the filters, none forwards all. */
+void can_bridge_set_filters(const can_bridge_filter_t *filters, int nb_filters);
+
+void can_bridge_get_stats(can_bridge_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CAN_BRIDGE_SERVER_H */
@@ -0,0 +1,109 @@
+#include <ch.h>
+#include "timestamp/timestamp.h"
+#include "log.h"
+#include "can_capture.h"
+
+/* Not cleared at boot, see can_capture_init. */
+__attribute__ ((section(".noinit")))
+static can_recorder_t recorder;
+__attribute__ ((section(".noinit")))
+static can_bridge_frame_t capture[CAN_CAPTURE_LEN];
+
+// lets the CAN thread skip the lock when nothing is recorded
+static volatile bool recording = false;
+
+static const char *trigger_names[] = {
+    "none", "rpc", "trajectory underrun", "service timeout", "emergency stop",
+};
+
+static void update_recording(void)
+{
+    recording = recorder.state == CAN_RECORDER_RECORDING
+                || recorder.state == CAN_RECORDER_TRIGGERED;
+}
+
+void can_capture_init(void)
+{
+    if (can_recorder_restore(&recorder, capture, CAN_CAPTURE_LEN)) {
+        log_message("CAN capture of %d frames kept, triggered by %s",
+                    (int)can_recorder_nb_frames(&recorder),
+                    trigger_names[recorder.trigger_reason]);
+    } else {
+        can_recorder_arm(&recorder, CAN_CAPTURE_DEFAULT_POST_TRIGGER);
+    }
+    update_recording();
+}
+
+void can_capture_frame(const can_bridge_frame_t *frame)
+{
+    if (!recording) {
+        return;
+    }
+    chSysLock();
+    can_recorder_record(&recorder, frame);
+    update_recording();
+    chSysUnlock();
+}
+
+void can_capture_trigger(can_recorder_trigger_t reason)
+{
+    uint32_t now = timestamp_get();
+
+    chSysLock();
+    bool triggered = can_recorder_trigger(&recorder, reason, now);
+    update_recording();
+    chSysUnlock();
+
+    if (triggered) {
+        log_message("CAN capture triggered by %s", trigger_names[reason]);
+    }
+}
+
+void can_capture_freeze(can_recorder_trigger_t reason)
+{
+    uint32_t now = timestamp_get();
+
+    chSysLock();
+    can_recorder_freeze(&recorder, reason, now);
+    update_recording();
+    chSysUnlock();
+}
+
+void can_capture_arm(uint32_t post_trigger, const can_bridge_filter_t *filters, int nb_filters)
+{
+    chSysLock();
+    can_recorder_set_filters(&recorder, filters, nb_filters);
+    can_recorder_arm(&recorder, post_trigger);
+    update_recording();
+    chSysUnlock();
+}
+
+uint32_t can_capture_read(uint32_t offset, can_bridge_frame_t *frames, uint32_t max,
+                          can_capture_info_t *info)
+{
+    uint32_t n;
+
+    chSysLock();
+    info->state = recorder.state;
+    info->trigger_reason = recorder.trigger_reason;
+    info->nb_frames = can_recorder_nb_frames(&recorder);
+    info->trigger_index = can_recorder_trigger_index(&recorder);
+    info->trigger_time_us = recorder.trigger_time_us;
+    chSysUnlock();
+
+    // frames are copied one by one to keep the critical sections short, the
+    // capture is only consistent once frozen anyway
+    for (n = 0; n < max; n++) {
+        chSysLock();
+        const can_bridge_frame_t *f = can_recorder_get(&recorder, offset + n);
+        if (f != NULL) {
+            frames[n] = *f;
+        }
+        chSysUnlock();
+        if (f == NULL) {
+            break;
+        }
+    }
+
+    return n;
+}
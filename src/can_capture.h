@@ -0,0 +1,58 @@
+#ifndef CAN_CAPTURE_H
+#define CAN_CAPTURE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "can_recorder.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define CAN_CAPTURE_LEN                     512
+#define CAN_CAPTURE_DEFAULT_POST_TRIGGER    32
+
+typedef struct {
+    uint8_t state;          /**< can_recorder_state_t */
+    uint8_t trigger_reason; /**< can_recorder_trigger_t */
+    uint32_t nb_frames;
+    int32_t trigger_index;  /**< See can_recorder_trigger_index. */
+    uint32_t trigger_time_us;
+} can_capture_info_t;
+
+/** Sets up the CAN recorder of the master.
+ *
+ * The capture is kept in RAM which is not cleared at boot, so that a capture
+ * frozen before a reset, for example by an emergency stop, can still be
+ * read. It stays frozen until armed again, otherwise recording starts right
+ * away.
+ */
+void can_capture_init(void);
+
+/** Records a frame seen on the bus. Called from the CAN thread, only costs a
+ * flag check when the recorder is not recording. */
+void can_capture_frame(const can_bridge_frame_t *frame);
+
+/** Triggers the recorder, see can_recorder_trigger. Can be called from any
+ * thread. */
+void can_capture_trigger(can_recorder_trigger_t reason);
+
+/** Freezes the recorder right away, before a reset. */
+void can_capture_freeze(can_recorder_trigger_t reason);
+
+/** Discards the capture and starts recording frames which pass one of the
+ * filters, none records all. */
+void can_capture_arm(uint32_t post_trigger, const can_bridge_filter_t *filters, int nb_filters);
+
+/** Copies up to max frames of the capture, starting at the offset-th oldest.
+ *
+ * @return The number of frames copied.
+ */
+uint32_t can_capture_read(uint32_t offset, can_bridge_frame_t *frames, uint32_t max,
+                          can_capture_info_t *info);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CAN_CAPTURE_H */
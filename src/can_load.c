@@ -0,0 +1,90 @@
+#include <string.h>
+#include "can_load.h"
+
+#define UAVCAN_SERVICE_NOT_MESSAGE (1 << 7)
+
+void can_load_init(can_load_t *l)
+{
+    memset(l, 0, sizeof(can_load_t));
+}
+
+uint32_t can_load_frame_bits(uint8_t dlc)
+{
+    if (dlc > 8) {
+        dlc = 8;
+    }
+    /* 67 bits of overhead and 54 stuffable bits for an extended frame. */
+    return 67 + 8 * dlc + (54 + 8 * dlc - 1) / 4;
+}
+
+static void count(can_load_counter_t *c, uint8_t dlc)
+{
+    c->frames++;
+    c->bytes += dlc;
+}
+
+static can_load_counter_t *type_counter(can_load_t *l, uint32_t key)
+{
+    int i;
+    for (i = 0; i < l->nb_types; i++) {
+        if (l->types[i].key == key) {
+            return &l->types[i].count;
+        }
+    }
+    if (l->nb_types == CAN_LOAD_MAX_TYPES) {
+        return &l->other_types;
+    }
+    l->types[l->nb_types].key = key;
+    return &l->types[l->nb_types++].count;
+}
+
+void can_load_record(can_load_t *l, uint32_t can_id, uint8_t dlc, bool tx)
+{
+    uint32_t key;
+    uint8_t node;
+
+    if (can_id & UAVCAN_SERVICE_NOT_MESSAGE) {
+        key = CAN_LOAD_TYPE_SERVICE | ((can_id >> 16) & 0xff);
+        node = tx ? (can_id >> 8) & 0x7f : can_id & 0x7f;
+    } else {
+        key = (can_id >> 8) & 0xffff;
+        node = tx ? CAN_LOAD_BROADCAST_NODE : can_id & 0x7f;
+    }
+
+    count(type_counter(l, key), dlc);
+    count(&l->nodes[node], dlc);
+
+    if (tx) {
+        l->tx_frames++;
+    } else {
+        l->rx_frames++;
+    }
+    l->window_bits += can_load_frame_bits(dlc);
+}
+
+float can_load_update(can_load_t *l, uint32_t window_us, uint32_t bitrate)
+{
+    if (window_us > 0) {
+        l->utilization = (float)l->window_bits / ((float)bitrate * window_us * 1e-6f);
+    }
+    l->window_bits = 0;
+    l->windows++;
+    return l->utilization;
+}
+
+float can_load_rate_scale(float scale, float utilization, float budget, float max_scale)
+{
+    if (budget <= 0) {
+        return 1;
+    }
+
+    scale = scale * (0.5f + 0.5f * utilization / budget);
+
+    if (scale < 1) {
+        return 1;
+    }
+    if (scale > max_scale) {
+        return max_scale;
+    }
+    return scale;
+}
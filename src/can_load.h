@@ -0,0 +1,84 @@
+#ifndef CAN_LOAD_H
+#define CAN_LOAD_H
+
+/*
+
+# CAN bus load accounting
+
+Counts the frames going through the CAN driver per UAVCAN data type and per
+node, and turns the bits they occupied into a bus utilization figure.
+
+Frames are attributed to the node they concern: the source of received
+frames and the destination of sent service frames. Broadcasts sent by the
+master are counted on CAN_LOAD_BROADCAST_NODE.
+
+Frame lengths are worst case (maximum bit stuffing), so the utilization is
+an upper bound. No locking is done.
+
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define CAN_LOAD_MAX_TYPES      32
+#define CAN_LOAD_NB_NODES       128
+#define CAN_LOAD_BROADCAST_NODE 0
+
+/* Set in the key of service data types. */
+#define CAN_LOAD_TYPE_SERVICE   0x10000
+
+typedef struct {
+    uint32_t frames;
+    uint32_t bytes;
+} can_load_counter_t;
+
+typedef struct {
+    uint32_t key; /**< Data type ID, ORed with CAN_LOAD_TYPE_SERVICE for services. */
+    can_load_counter_t count;
+} can_load_type_t;
+
+typedef struct {
+    can_load_type_t types[CAN_LOAD_MAX_TYPES];
+    uint16_t nb_types;
+    can_load_counter_t other_types; /**< Types which did not fit the table. */
+    can_load_counter_t nodes[CAN_LOAD_NB_NODES];
+    uint32_t tx_frames;
+    uint32_t rx_frames;
+    uint32_t window_bits; /**< Bits since the last can_load_update. */
+    float utilization;    /**< Of the last window, 1 being a saturated bus. */
+    uint32_t windows;     /**< Number of windows computed so far. */
+} can_load_t;
+
+void can_load_init(can_load_t *l);
+
+/** Worst case number of bit times taken by an extended data frame carrying
+ * dlc bytes, interframe space included. */
+uint32_t can_load_frame_bits(uint8_t dlc);
+
+/** Accounts for a frame sent (tx) or received by the master. */
+void can_load_record(can_load_t *l, uint32_t can_id, uint8_t dlc, bool tx);
+
+/** Computes the utilization over the window_us elapsed since the last call.
+ *
+ * @return The new utilization.
+ */
+float can_load_update(can_load_t *l, uint32_t window_us, uint32_t bitrate);
+
+/** Adapts the factor by which setpoint periods are stretched to bring the
+ * utilization back under budget.
+ *
+ * The scale moves half way towards the ratio of utilization to budget each
+ * call, and stays between 1 and max_scale. A budget of 0 disables the
+ * policy and returns 1.
+ */
+float can_load_rate_scale(float scale, float utilization, float budget, float max_scale);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CAN_LOAD_H */
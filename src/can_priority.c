@@ -0,0 +1,102 @@
+#include <string.h>
+#include "can_priority.h"
+
+#define CAN_ID_PRIORITY_SHIFT   24
+#define CAN_ID_PRIORITY_MASK    0x1f
+#define TAIL_END_OF_TRANSFER    (1 << 6)
+
+const uint8_t can_priority_of_class[CAN_PRIORITY_NB_CLASSES] = {
+    [CAN_PRIORITY_EMERGENCY_STOP] = 0,
+    [CAN_PRIORITY_SETPOINT] = 4,
+    [CAN_PRIORITY_FEEDBACK_CONFIG] = 12,
+    [CAN_PRIORITY_BULK_CONFIG] = 24,
+};
+
+static void pop_oldest(can_priority_queue_t *q)
+{
+    q->head = (q->head + 1) % CAN_PRIORITY_QUEUE_LEN;
+    q->depth--;
+}
+
+void can_priority_init(can_priority_stats_t *s)
+{
+    memset(s, 0, sizeof(*s));
+}
+
+int can_priority_class_of_frame(uint32_t can_id)
+{
+    uint8_t priority = (can_id >> CAN_ID_PRIORITY_SHIFT) & CAN_ID_PRIORITY_MASK;
+    int c;
+
+    for (c = 0; c < CAN_PRIORITY_NB_CLASSES; c++) {
+        if (can_priority_of_class[c] == priority) {
+            return c;
+        }
+    }
+    return -1;
+}
+
+void can_priority_submitted(can_priority_stats_t *s, can_priority_class_t c, uint32_t now_us)
+{
+    can_priority_queue_t *q = &s->classes[c];
+
+    // a full ring only holds transfers which were dropped long ago
+    if (q->depth == CAN_PRIORITY_QUEUE_LEN) {
+        pop_oldest(q);
+        q->expired++;
+    }
+    q->submitted_us[(q->head + q->depth) % CAN_PRIORITY_QUEUE_LEN] = now_us;
+    q->depth++;
+    if (q->depth > q->max_depth) {
+        q->max_depth = q->depth;
+    }
+}
+
+void can_priority_cancelled(can_priority_stats_t *s, can_priority_class_t c)
+{
+    can_priority_queue_t *q = &s->classes[c];
+
+    if (q->depth > 0) {
+        q->depth--;
+    }
+}
+
+void can_priority_frame_sent(can_priority_stats_t *s, uint32_t can_id, uint8_t tail_byte,
+                             uint32_t now_us)
+{
+    int c = can_priority_class_of_frame(can_id);
+
+    if (c < 0 || !(tail_byte & TAIL_END_OF_TRANSFER)) {
+        return;
+    }
+    can_priority_queue_t *q = &s->classes[c];
+    if (q->depth == 0) {
+        return;
+    }
+    latency_histogram_record(&q->latency, now_us - q->submitted_us[q->head]);
+    pop_oldest(q);
+    q->sent++;
+}
+
+void can_priority_expire(can_priority_stats_t *s, uint32_t now_us)
+{
+    int c;
+
+    for (c = 0; c < CAN_PRIORITY_NB_CLASSES; c++) {
+        can_priority_queue_t *q = &s->classes[c];
+        while (q->depth > 0 && now_us - q->submitted_us[q->head] > CAN_PRIORITY_TIMEOUT_US) {
+            pop_oldest(q);
+            q->expired++;
+        }
+    }
+}
+
+void can_priority_clear(can_priority_stats_t *s)
+{
+    int c;
+
+    for (c = 0; c < CAN_PRIORITY_NB_CLASSES; c++) {
+        s->classes[c].max_depth = s->classes[c].depth;
+        latency_histogram_init(&s->classes[c].latency);
+    }
+}
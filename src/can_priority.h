@@ -0,0 +1,98 @@
+#ifndef CAN_PRIORITY_H
+#define CAN_PRIORITY_H
+
+/*
+
+# CAN transfer priority classes
+
+Transfers sent by the master are sorted in classes, each with its own
+UAVCAN transfer priority, so that the CAN controller and the TX queue of
+the node send setpoints before configuration:
+
+    emergency stop > setpoints > feedback config > bulk config
+
+The priorities are set in can_priority_of_class. Other transfers, such as
+NodeStatus, use the libuavcan default, between feedback and bulk config.
+
+For each class, the transfers handed to the node but whose last frame did
+not leave yet are tracked, giving the depth of the queue and the latency
+from the call to publish until the last frame reaches the CAN controller.
+Frames are attributed to a class by their priority, so the priorities of
+the classes must differ from each other and from the other traffic. When
+transfers of a class leave out of order, the oldest one is assumed to have
+left. No locking is done.
+
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "latency_histogram.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum {
+    CAN_PRIORITY_EMERGENCY_STOP = 0,
+    CAN_PRIORITY_SETPOINT,
+    CAN_PRIORITY_FEEDBACK_CONFIG,   /**< Feedback streams and motor enable. */
+    CAN_PRIORITY_BULK_CONFIG,       /**< LoadConfiguration and PID gains. */
+    CAN_PRIORITY_NB_CLASSES
+} can_priority_class_t;
+
+/* Pending transfers tracked per class. */
+#define CAN_PRIORITY_QUEUE_LEN      32
+/* A transfer still pending after that long is assumed to have been dropped
+ * by the TX queue. */
+#define CAN_PRIORITY_TIMEOUT_US     100000
+
+/** UAVCAN transfer priority of each class, 0 being the highest. */
+extern const uint8_t can_priority_of_class[CAN_PRIORITY_NB_CLASSES];
+
+typedef struct {
+    uint32_t submitted_us[CAN_PRIORITY_QUEUE_LEN]; /**< Ring of pending transfers. */
+    uint16_t head;
+    uint16_t depth;         /**< Transfers pending. */
+    uint16_t max_depth;
+    uint32_t sent;          /**< Transfers whose last frame left. */
+    uint32_t expired;       /**< Transfers which never left. */
+    latency_histogram_t latency;
+} can_priority_queue_t;
+
+typedef struct {
+    can_priority_queue_t classes[CAN_PRIORITY_NB_CLASSES];
+} can_priority_stats_t;
+
+void can_priority_init(can_priority_stats_t *s);
+
+/** Class of a frame from the priority field of its extended CAN ID.
+ *
+ * @return The class, or -1 if the priority is not the one of a class.
+ */
+int can_priority_class_of_frame(uint32_t can_id);
+
+/** Accounts for a transfer handed to the node for sending. */
+void can_priority_submitted(can_priority_stats_t *s, can_priority_class_t c, uint32_t now_us);
+
+/** Forgets the transfer submitted last, when the node refused it. */
+void can_priority_cancelled(can_priority_stats_t *s, can_priority_class_t c);
+
+/** Accounts for a frame handed to the CAN controller.
+ *
+ * @param tail_byte Last data byte of the frame, which tells whether it ends
+ * its transfer.
+ */
+void can_priority_frame_sent(can_priority_stats_t *s, uint32_t can_id, uint8_t tail_byte,
+                             uint32_t now_us);
+
+/** Drops the transfers pending for more than CAN_PRIORITY_TIMEOUT_US. */
+void can_priority_expire(can_priority_stats_t *s, uint32_t now_us);
+
+/** Clears the maximum depth and the latencies, keeping pending transfers. */
+void can_priority_clear(can_priority_stats_t *s);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CAN_PRIORITY_H */
@@ -0,0 +1,108 @@
+#include <string.h>
+#include "can_recorder.h"
+
+#define CAN_RECORDER_MAGIC 0x43524543 // "CREC"
+
+void can_recorder_init(can_recorder_t *r, can_bridge_frame_t *frames, uint32_t len)
+{
+    memset(r, 0, sizeof(*r));
+    r->magic = CAN_RECORDER_MAGIC;
+    r->frames = frames;
+    r->len = len;
+    r->state = CAN_RECORDER_STOPPED;
+}
+
+bool can_recorder_restore(can_recorder_t *r, can_bridge_frame_t *frames, uint32_t len)
+{
+    if (r->magic == CAN_RECORDER_MAGIC && r->frames == frames && r->len == len
+        && r->state == CAN_RECORDER_FROZEN && r->nb_filters <= CAN_BRIDGE_MAX_FILTERS
+        && r->trigger_reason <= CAN_RECORDER_TRIGGER_EMERGENCY_STOP
+        && r->trigger_frame <= r->head && r->head - r->trigger_frame < len) {
+        return true;
+    }
+    can_recorder_init(r, frames, len);
+    return false;
+}
+
+void can_recorder_arm(can_recorder_t *r, uint32_t post_trigger)
+{
+    // the trigger must stay in the capture
+    if (post_trigger >= r->len) {
+        post_trigger = r->len - 1;
+    }
+    r->head = 0;
+    r->post_trigger = post_trigger;
+    r->trigger_frame = 0;
+    r->trigger_time_us = 0;
+    r->trigger_reason = CAN_RECORDER_TRIGGER_NONE;
+    r->state = CAN_RECORDER_RECORDING;
+}
+
+void can_recorder_set_filters(can_recorder_t *r, const can_bridge_filter_t *filters, int nb_filters)
+{
+    if (nb_filters > CAN_BRIDGE_MAX_FILTERS) {
+        nb_filters = CAN_BRIDGE_MAX_FILTERS;
+    }
+    memcpy(r->filters, filters, nb_filters * sizeof(can_bridge_filter_t));
+    r->nb_filters = nb_filters;
+}
+
+void can_recorder_record(can_recorder_t *r, const can_bridge_frame_t *frame)
+{
+    if (r->state != CAN_RECORDER_RECORDING && r->state != CAN_RECORDER_TRIGGERED) {
+        return;
+    }
+    if (!can_bridge_filter_match(r->filters, r->nb_filters, frame->id)) {
+        return;
+    }
+    r->frames[r->head % r->len] = *frame;
+    r->head++;
+
+    if (r->state == CAN_RECORDER_TRIGGERED && --r->remaining == 0) {
+        r->state = CAN_RECORDER_FROZEN;
+    }
+}
+
+bool can_recorder_trigger(can_recorder_t *r, uint8_t reason, uint32_t now_us)
+{
+    if (r->state != CAN_RECORDER_RECORDING) {
+        return false;
+    }
+    r->trigger_reason = reason;
+    r->trigger_frame = r->head;
+    r->trigger_time_us = now_us;
+    r->remaining = r->post_trigger;
+    r->state = r->post_trigger > 0 ? CAN_RECORDER_TRIGGERED : CAN_RECORDER_FROZEN;
+    return true;
+}
+
+void can_recorder_freeze(can_recorder_t *r, uint8_t reason, uint32_t now_us)
+{
+    can_recorder_trigger(r, reason, now_us);
+    if (r->state == CAN_RECORDER_TRIGGERED) {
+        r->state = CAN_RECORDER_FROZEN;
+    }
+}
+
+uint32_t can_recorder_nb_frames(const can_recorder_t *r)
+{
+    return r->head < r->len ? r->head : r->len;
+}
+
+int32_t can_recorder_trigger_index(const can_recorder_t *r)
+{
+    if (r->trigger_reason == CAN_RECORDER_TRIGGER_NONE) {
+        return -1;
+    }
+    return r->trigger_frame - (r->head - can_recorder_nb_frames(r));
+}
+
+const can_bridge_frame_t *can_recorder_get(const can_recorder_t *r, uint32_t index)
+{
+    uint32_t nb_frames = can_recorder_nb_frames(r);
+
+    if (index >= nb_frames) {
+        return NULL;
+    }
+    return &r->frames[(r->head - nb_frames + index) % r->len];
+}
@@ -0,0 +1,103 @@
+#ifndef CAN_RECORDER_H
+#define CAN_RECORDER_H
+
+/*
+
+# CAN recorder
+
+Ring buffer of the last CAN frames seen by the master, for post-mortem
+analysis. While recording, every frame passing the filters overwrites the
+oldest one. A trigger lets post_trigger more frames in, after which the
+capture is frozen until it is armed again, so it shows what happened on the
+bus before and right after the event.
+
+Only the first trigger of a recording counts.
+
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "can_bridge.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum {
+    CAN_RECORDER_STOPPED = 0,
+    CAN_RECORDER_RECORDING,
+    CAN_RECORDER_TRIGGERED, /**< Recording the frames following the trigger. */
+    CAN_RECORDER_FROZEN,
+} can_recorder_state_t;
+
+typedef enum {
+    CAN_RECORDER_TRIGGER_NONE = 0,
+    CAN_RECORDER_TRIGGER_RPC,
+    CAN_RECORDER_TRIGGER_TRAJECTORY_UNDERRUN,
+    CAN_RECORDER_TRIGGER_SERVICE_TIMEOUT,
+    CAN_RECORDER_TRIGGER_EMERGENCY_STOP,
+} can_recorder_trigger_t;
+
+typedef struct {
+    uint32_t magic;             /**< Tells a capture which survived a reset. */
+    can_bridge_frame_t *frames;
+    uint32_t len;
+    uint32_t head;              /**< Number of frames recorded since armed. */
+    uint32_t post_trigger;      /**< Frames to record after the trigger. */
+    uint32_t remaining;
+    uint32_t trigger_frame;     /**< Value of head when triggered. */
+    uint32_t trigger_time_us;
+    uint8_t state;
+    uint8_t trigger_reason;
+    uint8_t nb_filters;
+    can_bridge_filter_t filters[CAN_BRIDGE_MAX_FILTERS];
+} can_recorder_t;
+
+/** Initializes a stopped recorder, discarding any capture. */
+void can_recorder_init(can_recorder_t *r, can_bridge_frame_t *frames, uint32_t len);
+
+/** Keeps the frozen capture found in r, if any, for example one left in
+ * uninitialized RAM by the firmware before a reset. Otherwise r is
+ * initialized as with can_recorder_init.
+ *
+ * @return true if a capture was kept.
+ */
+bool can_recorder_restore(can_recorder_t *r, can_bridge_frame_t *frames, uint32_t len);
+
+/** Discards the capture and starts recording. */
+void can_recorder_arm(can_recorder_t *r, uint32_t post_trigger);
+
+/** Sets the filters, see can_bridge_filter_match. They apply to the frames
+ * recorded afterwards. */
+void can_recorder_set_filters(can_recorder_t *r, const can_bridge_filter_t *filters, int nb_filters);
+
+void can_recorder_record(can_recorder_t *r, const can_bridge_frame_t *frame);
+
+/** Triggers the recorder, which freezes after post_trigger more frames.
+ *
+ * @return false if it was not recording.
+ */
+bool can_recorder_trigger(can_recorder_t *r, uint8_t reason, uint32_t now_us);
+
+/** Triggers the recorder and freezes it right away, when no frame will be
+ * recorded anymore. A capture already triggered keeps its trigger. */
+void can_recorder_freeze(can_recorder_t *r, uint8_t reason, uint32_t now_us);
+
+/** @return Number of frames in the capture. */
+uint32_t can_recorder_nb_frames(const can_recorder_t *r);
+
+/** @return Index of the first frame recorded after the trigger, or -1 if it
+ * was not triggered. Frames before it might have been overwritten. */
+int32_t can_recorder_trigger_index(const can_recorder_t *r);
+
+/** Gets a frame of the capture, the oldest one has index 0.
+ *
+ * @return NULL if index is out of range.
+ */
+const can_bridge_frame_t *can_recorder_get(const can_recorder_t *r, uint32_t index);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CAN_RECORDER_H */
@@ -15,6 +15,12 @@
 #include "uavcan_node.h"
 #include "node_tracker.h"
 #include "robot_pose.h"
+#include "wheel_odometry.h"
+#include "main.h"
+#include "motor_driver_uavcan.h"
+#include <lwipthread.h>
+#include <lwip/memp.h>
+#include <lwip/stats.h>
 
 
 
@@ -231,43 +237,270 @@ static void cmd_node_tracker(BaseSequentialStream *chp, int argc, char **argv)
 {
     (void)argc;
     (void)argv;
-    uint64_t d, hi;
-    node_tracker_get_and_clear(&d, &hi);
-    chprintf(chp, "UAVCAN: tracking active nodes...\n");
-    chThdSleepMilliseconds(2000);
-    node_tracker_get_and_clear(&d, &hi);
-    chprintf(chp, "present nodes: ");
+    static const char *health_names[] = {"ok", "warning", "error", "critical"};
+    node_tracker_entry_t node;
+    uint32_t now = timestamp_get();
     int id;
-    for (id = 0; id < 128; id++) {
-        if (d & 1) {
-            chprintf(chp, "%u ", id);
-        }
-        d >>= 1;
-        if (d == 0) {
-            if (id < 64) {
-                id = 63;
-                d = hi;
-            } else {
-                break;
-            }
+
+    for (id = 0; id < NODE_TRACKER_NB_NODES; id++) {
+        if (!uavcan_node_get_node_status(id, &node)) {
+            continue;
         }
+        chprintf(chp, "%3d %-8s %-8s up: %6lu s seen: %6lu ms ago mode: %u reboots: %u\r\n",
+                 id,
+                 now - node.last_seen_us < NODE_TRACKER_OFFLINE_TIMEOUT_US ? "online" : "offline",
+                 health_names[node.health & 3],
+                 node.uptime_s,
+                 (now - node.last_seen_us) / 1000,
+                 node.mode,
+                 node.reboots);
     }
-    chprintf(chp, "\r\n");
 }
 
 static void cmd_pos(BaseSequentialStream *chp, int argc, char **argv)
 {
     (void)argc;
     (void)argv;
-    float x, y, theta;
+    struct robot_base_pose_2d_s pose;
+
+    robot_pose_get(&pose, NULL, NULL);
+
+    chprintf(chp, "%.3f;%.3f;%.3f\r\n", pose.x, pose.y, pose.theta);
+}
+
+static void cmd_eth_stats(BaseSequentialStream *chp, int argc, char **argv)
+{
+    (void)argc;
+    (void)argv;
+    eth_stats_t s;
+
+    eth_stats_reset();
+    chprintf(chp, "Ethernet: sampling for 1s...\r\n");
+    chThdSleepMilliseconds(1000);
+    eth_stats_get(&s);
+
+    chprintf(chp, "rx: %lu frames/s, %lu bytes/s, %lu zero-copy\r\n",
+             s.rx_frames, s.rx_bytes, s.rx_zero_copy);
+    chprintf(chp, "tx: %lu frames/s, %lu bytes/s\r\n",
+             s.tx_frames, s.tx_bytes);
+    if (s.rx_frames > 0) {
+        chprintf(chp, "rx cost: %lu cycles/frame, %lu cycles/kB\r\n",
+                 s.rx_cycles / s.rx_frames,
+                 s.rx_bytes > 0 ? (uint32_t)(1024ULL * s.rx_cycles / s.rx_bytes) : 0);
+    }
+    if (s.tx_frames > 0) {
+        chprintf(chp, "tx cost: %lu cycles/frame, %lu cycles/kB\r\n",
+                 s.tx_cycles / s.tx_frames,
+                 s.tx_bytes > 0 ? (uint32_t)(1024ULL * s.tx_cycles / s.tx_bytes) : 0);
+    }
+    chprintf(chp, "cpu load: rx %lu.%02lu%% tx %lu.%02lu%%\r\n",
+             s.rx_cycles / (STM32_SYSCLK / 100), (s.rx_cycles / (STM32_SYSCLK / 10000)) % 100,
+             s.tx_cycles / (STM32_SYSCLK / 100), (s.tx_cycles / (STM32_SYSCLK / 10000)) % 100);
+}
+
+static void cmd_lwip_pools(BaseSequentialStream *chp, int argc, char **argv)
+{
+    (void)argc;
+    (void)argv;
+#if MEMP_STATS
+    static const char *pool_names[MEMP_MAX] = {
+#define LWIP_MEMPOOL(name, num, size, desc) desc,
+#include <lwip/memp_std.h>
+    };
+    int i;
+
+    chprintf(chp, "%-20s %6s %6s %6s %6s\r\n", "pool", "used", "max", "avail", "err");
+    for (i = 0; i < MEMP_MAX; i++) {
+        chprintf(chp, "%-20s %6u %6u %6u %6u\r\n", pool_names[i],
+                 (unsigned)lwip_stats.memp[i].used,
+                 (unsigned)lwip_stats.memp[i].max,
+                 (unsigned)lwip_stats.memp[i].avail,
+                 (unsigned)lwip_stats.memp[i].err);
+    }
+#endif
+#if MEM_STATS
+    chprintf(chp, "%-20s %6u %6u %6u %6u\r\n", "HEAP",
+             (unsigned)lwip_stats.mem.used,
+             (unsigned)lwip_stats.mem.max,
+             (unsigned)lwip_stats.mem.avail,
+             (unsigned)lwip_stats.mem.err);
+#endif
+}
+
+static void print_latency(BaseSequentialStream *chp, const char *name, msg_latency_t *l)
+{
+    if (l->count == 0) {
+        chprintf(chp, "%-8s no messages\r\n", name);
+        return;
+    }
+    chprintf(chp, "%-8s %lu msgs, avg %lu us, max %lu us\r\n", name,
+             l->count, l->total_us / l->count, l->max_us);
+}
+
+static void cmd_msg_latency(BaseSequentialStream *chp, int argc, char **argv)
+{
+    (void)argc;
+    (void)argv;
+    msg_latency_t queued, raw;
+
+    message_server_get_latency(&queued, &raw);
+    print_latency(chp, "queued", &queued);
+    print_latency(chp, "raw", &raw);
+}
+
+static void cmd_msg_stats(BaseSequentialStream *chp, int argc, char **argv)
+{
+    (void)argc;
+    (void)argv;
+    message_server_stats_t s;
+
+    message_server_get_stats(&s);
+    chprintf(chp, "received: %lu\r\n", s.received);
+    chprintf(chp, "oversized: %lu\r\n", s.oversized);
+    chprintf(chp, "decode errors: %lu\r\n", s.decode_error);
+    chprintf(chp, "dropped: setpoint %lu, trajectory %lu, other %lu\r\n",
+             s.dropped[MSG_CLASS_SETPOINT],
+             s.dropped[MSG_CLASS_TRAJECTORY],
+             s.dropped[MSG_CLASS_OTHER]);
+}
+
+static void print_jitter(BaseSequentialStream *chp, const char *name,
+                         wheel_odometry_jitter_t *j)
+{
+    chprintf(chp, "%-9s %4lu samples, interval mean %.1f us, stddev %.1f us, min %lu us, max %lu us\r\n",
+             name, j->count, j->mean, j->stddev, j->min, j->max);
+}
+
+static void cmd_encoder_jitter(BaseSequentialStream *chp, int argc, char **argv)
+{
+    (void)argc;
+    (void)argv;
+    wheel_odometry_jitter_t rx, dispatch;
+
+    wheel_odometry_get_jitter(&rx, &dispatch);
+    chprintf(chp, "Right wheel encoder: sampling for 1s...\r\n");
+    chThdSleepMilliseconds(1000);
+    wheel_odometry_get_jitter(&rx, &dispatch);
+
+    print_jitter(chp, "rx", &rx);
+    print_jitter(chp, "dispatch", &dispatch);
+}
+
+/* chprintf has no 64 bit integers, offsets are printed as seconds and
+ * microseconds. */
+static void print_offset(BaseSequentialStream *chp, const char *name, int64_t offset_us)
+{
+    const char *sign = offset_us < 0 ? "-" : "";
+    uint64_t abs_us = offset_us < 0 ? -(uint64_t)offset_us : (uint64_t)offset_us;
+
+    chprintf(chp, "%s offset: %s%lu.%06lu s\r\n", name, sign,
+             (uint32_t)(abs_us / 1000000), (uint32_t)(abs_us % 1000000));
+}
+
+static void cmd_time_sync(BaseSequentialStream *chp, int argc, char **argv)
+{
+    (void)argc;
+    (void)argv;
+    uavcan_time_sync_stats_t s;
+
+    uavcan_node_get_time_sync_stats(&s);
+    chprintf(chp, "published: %lu\r\n", s.published);
+    print_offset(chp, "last", s.last_offset_us);
+    print_offset(chp, "max", s.max_offset_us);
+}
+
+static void cmd_can_load(BaseSequentialStream *chp, int argc, char **argv)
+{
+    (void)argc;
+    (void)argv;
+    static can_load_t load;
+    float scale;
+    int i;
+
+    uavcan_node_get_can_load(&load, &scale);
+    chprintf(chp, "utilization: %.1f %%\r\n", load.utilization * 100);
+    chprintf(chp, "rate scale: %.2f\r\n", scale);
+    chprintf(chp, "frames tx: %lu rx: %lu\r\n", load.tx_frames, load.rx_frames);
+    for (i = 0; i < load.nb_types; i++) {
+        chprintf(chp, "%s %5lu: %8lu frames %10lu bytes\r\n",
+                 load.types[i].key & CAN_LOAD_TYPE_SERVICE ? "srv" : "msg",
+                 load.types[i].key & ~CAN_LOAD_TYPE_SERVICE,
+                 load.types[i].count.frames, load.types[i].count.bytes);
+    }
+    if (load.other_types.frames != 0) {
+        chprintf(chp, "other    : %8lu frames %10lu bytes\r\n",
+                 load.other_types.frames, load.other_types.bytes);
+    }
+    for (i = 0; i < CAN_LOAD_NB_NODES; i++) {
+        if (load.nodes[i].frames != 0) {
+            chprintf(chp, "node %3d : %8lu frames %10lu bytes\r\n",
+                     i, load.nodes[i].frames, load.nodes[i].bytes);
+        }
+    }
+}
+
+static void cmd_setpoint_stats(BaseSequentialStream *chp, int argc, char **argv)
+{
+    (void)argc;
+    (void)argv;
+    motor_driver_t *drv_list;
+    uint16_t drv_list_len;
+    uint32_t sent, suppressed;
+    int i;
+
+    motor_manager_get_list(&motor_manager, &drv_list, &drv_list_len);
+    for (i = 0; i < drv_list_len; i++) {
+        motor_driver_uavcan_get_setpoint_stats(&drv_list[i], &sent, &suppressed);
+        chprintf(chp, "%-24s sent: %8lu saved: %8lu\r\n",
+                 motor_driver_get_id(&drv_list[i]), sent, suppressed);
+    }
+}
 
-    chMtxLock(&robot_pose_lock);
-    x = robot_pose.x;
-    y = robot_pose.y;
-    theta = robot_pose.theta;
-    chMtxUnlock(&robot_pose_lock);
+static void cmd_config_queue(BaseSequentialStream *chp, int argc, char **argv)
+{
+    (void)argc;
+    (void)argv;
+    motor_driver_t *drv_list;
+    uint16_t drv_list_len;
+    uint32_t pending, sent, failed;
+    int i;
 
-    chprintf(chp, "%.3f;%.3f;%.3f\r\n", x, y, theta);
+    uint32_t time_to_ready_ms;
+    if (uavcan_node_actuators_ready(&time_to_ready_ms)) {
+        chprintf(chp, "ready %lu ms after boot\r\n", time_to_ready_ms);
+    } else {
+        chprintf(chp, "not ready\r\n");
+    }
+
+    motor_manager_get_list(&motor_manager, &drv_list, &drv_list_len);
+    for (i = 0; i < drv_list_len; i++) {
+        motor_driver_uavcan_get_config_stats(&drv_list[i], &pending, &sent, &failed);
+        chprintf(chp, "%-24s pending: 0x%03lx calls: %6lu failed: %6lu\r\n",
+                 motor_driver_get_id(&drv_list[i]), pending, sent, failed);
+    }
+}
+
+static void cmd_node_ids(BaseSequentialStream *chp, int argc, char **argv)
+{
+    (void)argc;
+    (void)argv;
+    motor_driver_t *drv_list;
+    uint16_t drv_list_len;
+    uavcan_node_id_cache_stats_t stats;
+    int i;
+
+    uavcan_node_get_node_id_cache_stats(&stats);
+    chprintf(chp, "cache: %lu preloaded, %lu corrected, %lu free slots\r\n",
+             stats.preloaded, stats.corrected, stats.free_slots);
+    chprintf(chp, "allocator: %lu node IDs allocated\r\n", stats.allocations);
+
+    motor_manager_get_list(&motor_manager, &drv_list, &drv_list_len);
+    for (i = 0; i < drv_list_len; i++) {
+        chprintf(chp, "%-24s CAN ID: %5d first setpoint: %6lu ms\r\n",
+                 motor_driver_get_id(&drv_list[i]),
+                 motor_driver_get_can_id(&drv_list[i]),
+                 motor_driver_uavcan_get_first_setpoint_time(&drv_list[i]));
+    }
 }
 
 const ShellCommand commands[] = {
@@ -283,5 +516,15 @@ const ShellCommand commands[] = {
     {"pos", cmd_pos},
     {"node_reboot", cmd_uavcan_node_reboot},
     {"node_tracker", cmd_node_tracker},
+    {"eth_stats", cmd_eth_stats},
+    {"lwip_pools", cmd_lwip_pools},
+    {"msg_latency", cmd_msg_latency},
+    {"msg_stats", cmd_msg_stats},
+    {"encoder_jitter", cmd_encoder_jitter},
+    {"time_sync", cmd_time_sync},
+    {"can_load", cmd_can_load},
+    {"setpoint_stats", cmd_setpoint_stats},
+    {"config_queue", cmd_config_queue},
+    {"node_ids", cmd_node_ids},
     {NULL, NULL}
 };
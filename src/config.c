@@ -10,6 +10,8 @@ parameter_namespace_t actuator_config;
 
 parameter_namespace_t master_config;
 
+EVENTSOURCE_DECL(config_updated);
+
 static parameter_t foo;
 
 static parameter_namespace_t odometry_config;
@@ -18,6 +20,19 @@ static parameter_t odometry_left_radius;
 static parameter_t odometry_right_radius;
 static parameter_t odometry_left_wheel_direction;
 static parameter_t odometry_right_wheel_direction;
+static parameter_t odometry_publish_period;
+
+static parameter_namespace_t time_sync_config;
+static parameter_t time_sync_period;
+
+static parameter_namespace_t can_config;
+static parameter_t can_utilization_budget;
+static parameter_t can_node_id_cache;
+static parameter_t can_expected_actuators;
+
+static parameter_namespace_t firmware_update_config;
+static parameter_t firmware_update_max_concurrent;
+static parameter_t firmware_update_rate;
 
 
 
@@ -53,6 +68,52 @@ void config_init(void)
                                            "left_wheel_direction",
                                            ROBOT_LEFT_WHEEL_DIRECTION);
 
+    /* Minimum time between two published poses [s], 0 sends every update. */
+    parameter_scalar_declare_with_default(&odometry_publish_period,
+                                          &odometry_config,
+                                          "publish_period",
+                                          0.f);
+
+    parameter_namespace_declare(&time_sync_config, &master_config, "time_sync");
+    /* Interval between two GlobalTimeSync messages on the CAN bus [s]. */
+    parameter_scalar_declare_with_default(&time_sync_period,
+                                          &time_sync_config,
+                                          "period",
+                                          1.f);
+
+    parameter_namespace_declare(&can_config, &master_config, "can");
+    /* Bus utilization above which setpoint periods and stream frequencies
+     * are scaled down, 0 disables the scaling. */
+    parameter_scalar_declare_with_default(&can_utilization_budget,
+                                          &can_config,
+                                          "utilization_budget",
+                                          0.f);
+    /* Address actuators with the CAN ID they had before the last reboot
+     * until they announce their string ID, 0 waits for the announcement. */
+    parameter_integer_declare_with_default(&can_node_id_cache,
+                                           &can_config,
+                                           "node_id_cache",
+                                           1);
+    /* Number of actuators the master waits for before reporting them ready,
+     * 0 accepts any number of created drivers. */
+    parameter_integer_declare_with_default(&can_expected_actuators,
+                                           &can_config,
+                                           "expected_actuators",
+                                           0);
+
+    parameter_namespace_declare(&firmware_update_config, &master_config, "firmware_update");
+    /* Nodes reading the firmware image at the same time. */
+    parameter_integer_declare_with_default(&firmware_update_max_concurrent,
+                                           &firmware_update_config,
+                                           "max_concurrent",
+                                           8);
+    /* Firmware image bytes served per second above which no more nodes
+     * start their update. */
+    parameter_scalar_declare_with_default(&firmware_update_rate,
+                                          &firmware_update_config,
+                                          "rate",
+                                          20000.f);
+
     parameter_scalar_declare(&foo, &master_config, "foo");
 }
 
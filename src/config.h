@@ -1,3 +1,4 @@
+#include <ch.h>
 #include <parameter/parameter.h>
 
 #ifdef __cplusplus
@@ -9,6 +10,9 @@ extern parameter_namespace_t global_config;
 extern parameter_namespace_t actuator_config;
 extern parameter_namespace_t master_config;
 
+/* Broadcast after parameters were written through the config_update RPC. */
+extern event_source_t config_updated;
+
 
 /* Inits all the globally available objects. */
 void config_init(void);
@@ -0,0 +1,70 @@
+#include "config_queue.h"
+
+void config_queue_init(config_queue_t *q, uint32_t full_item, uint32_t covered_items)
+{
+    q->pending = 0;
+    q->in_flight = 0;
+    q->full_item = full_item;
+    q->covered_items = covered_items;
+    q->retry_at_us = 0;
+    q->backoff_us = 0;
+    q->sent = 0;
+    q->failed = 0;
+}
+
+void config_queue_request(config_queue_t *q, uint32_t items)
+{
+    q->pending |= items;
+    if (q->pending & q->full_item) {
+        q->pending &= ~q->covered_items;
+    }
+}
+
+void config_queue_request_urgent(config_queue_t *q, uint32_t items)
+{
+    config_queue_request(q, items);
+    q->backoff_us = 0;
+}
+
+uint32_t config_queue_next(config_queue_t *q, uint32_t now_us)
+{
+    if (q->in_flight != 0 || q->pending == 0) {
+        return 0;
+    }
+    if (q->backoff_us != 0 && (int32_t)(now_us - q->retry_at_us) < 0) {
+        return 0;
+    }
+
+    uint32_t item = q->pending & -q->pending;
+    q->pending &= ~item;
+    q->in_flight = item;
+    q->sent++;
+
+    return item;
+}
+
+void config_queue_complete(config_queue_t *q, bool success, uint32_t now_us)
+{
+    if (q->in_flight == 0) {
+        return;
+    }
+
+    if (success) {
+        q->backoff_us = 0;
+    } else {
+        q->failed++;
+        config_queue_request(q, q->in_flight);
+        if (q->backoff_us == 0) {
+            q->backoff_us = CONFIG_QUEUE_BACKOFF_MIN_US;
+        } else if (q->backoff_us < CONFIG_QUEUE_BACKOFF_MAX_US) {
+            q->backoff_us *= 2;
+        }
+        q->retry_at_us = now_us + q->backoff_us;
+    }
+    q->in_flight = 0;
+}
+
+bool config_queue_is_idle(const config_queue_t *q)
+{
+    return q->pending == 0 && q->in_flight == 0;
+}
@@ -0,0 +1,78 @@
+#ifndef CONFIG_QUEUE_H
+#define CONFIG_QUEUE_H
+
+/*
+
+# Config queue
+
+Tracks the configuration items which still have to be sent to one node, so
+that parameter changes are pushed as service calls one at a time instead of
+all at once.
+
+Items are bits of a mask: requesting an item which is already pending does
+nothing, and a "full" item can be declared to cover a set of other items,
+which are dropped while it is pending. Pending items go out lowest bit first.
+
+Covered items are also dropped when a failed full item is queued again, so
+the caller must copy the values of a covered item into the data of the full
+item whenever it requests it. Calls then send the data current at the time
+they are made.
+
+A failed call puts its item back in the queue and delays the next call with
+an exponential backoff. Urgent requests cancel the backoff, so that with the
+lowest bit they only wait for the call in flight. No locking is done.
+
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define CONFIG_QUEUE_BACKOFF_MIN_US     250000
+#define CONFIG_QUEUE_BACKOFF_MAX_US     4000000
+
+typedef struct {
+    uint32_t pending;
+    uint32_t in_flight;   /**< Item of the call in progress, 0 if none. */
+    uint32_t full_item;
+    uint32_t covered_items;
+    uint32_t retry_at_us;
+    uint32_t backoff_us;
+    uint32_t sent;
+    uint32_t failed;
+} config_queue_t;
+
+/** Initializes an empty queue.
+ *
+ * @param [in] full_item Item which makes the covered_items redundant.
+ */
+void config_queue_init(config_queue_t *q, uint32_t full_item, uint32_t covered_items);
+
+/** Adds the given items to the pending ones. */
+void config_queue_request(config_queue_t *q, uint32_t items);
+
+/** Adds the given items and cancels the backoff, so that the next call is
+ * made as soon as the one in flight completes. */
+void config_queue_request_urgent(config_queue_t *q, uint32_t items);
+
+/** Picks the next item to send and marks it in flight.
+ *
+ * @return The item, or 0 if nothing is pending, a call is already in flight
+ * or the queue is backing off after a failure.
+ */
+uint32_t config_queue_next(config_queue_t *q, uint32_t now_us);
+
+/** Reports the outcome of the call in flight. */
+void config_queue_complete(config_queue_t *q, bool success, uint32_t now_us);
+
+/** @return true if nothing is pending nor in flight. */
+bool config_queue_is_idle(const config_queue_t *q);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CONFIG_QUEUE_H */
@@ -126,13 +126,13 @@ void differential_base_tracking_thread_tracy(void *p)
 
 
             /* Get data from odometry. */
-            chMtxLock(&robot_pose_lock);
-                error.x_error = x - robot_pose.x;
-                error.y_error = y - robot_pose.y;
-                error.theta_error = theta - robot_pose.theta;
+            struct robot_base_pose_2d_s pose;
+            robot_pose_get(&pose, NULL, NULL);
+            error.x_error = x - pose.x;
+            error.y_error = y - pose.y;
+            error.theta_error = theta - pose.theta;
 
-                theta = robot_pose.theta;
-            chMtxUnlock(&robot_pose_lock);
+            theta = pose.theta;
 
             input.tangential_velocity = speed;
             input.angular_velocity = omega;
@@ -186,9 +186,7 @@ void differential_base_tracking_thread_waypoint(void *p)
         struct robot_base_pose_2d_s odometry_pose;
 
         /* Get data from odometry. */
-        chMtxLock(&robot_pose_lock);
-            odometry_pose = robot_pose;
-        chMtxUnlock(&robot_pose_lock);
+        robot_pose_get(&odometry_pose, NULL, NULL);
 
 
         float left_wheel_velocity, right_wheel_velocity;
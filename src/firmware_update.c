@@ -0,0 +1,192 @@
+#include <string.h>
+#include "firmware_update.h"
+
+static bool is_active(const firmware_update_node_t *n)
+{
+    return n->state == FIRMWARE_UPDATE_BEGINNING || n->state == FIRMWARE_UPDATE_READING;
+}
+
+static void update_rate(firmware_update_t *u, uint32_t now_us)
+{
+    uint32_t elapsed = now_us - u->window_start_us;
+
+    if (elapsed >= FIRMWARE_UPDATE_RATE_WINDOW_US) {
+        u->rate = (uint64_t)u->window_bytes * 1000000 / elapsed;
+        u->window_start_us = now_us;
+        u->window_bytes = 0;
+    }
+}
+
+void firmware_update_init(firmware_update_t *u)
+{
+    memset(u, 0, sizeof(*u));
+}
+
+bool firmware_update_set_image(firmware_update_t *u, const uint8_t *image, uint32_t size)
+{
+    if (firmware_update_is_running(u)) {
+        return false;
+    }
+    u->image = image;
+    u->image_size = size;
+    return true;
+}
+
+bool firmware_update_start(firmware_update_t *u, const uint8_t *node_ids, int nb_nodes,
+                           uint32_t max_concurrent, uint32_t budget, uint32_t now_us)
+{
+    int i;
+
+    if (u->image == NULL) {
+        return false;
+    }
+    if (!firmware_update_is_running(u)) {
+        u->window_start_us = now_us;
+        u->window_bytes = 0;
+        u->rate = 0;
+    }
+    u->max_concurrent = max_concurrent;
+    u->budget = budget;
+
+    for (i = 0; i < nb_nodes; i++) {
+        uint8_t id = node_ids[i];
+        if (id == 0 || id >= FIRMWARE_UPDATE_MAX_NODES) {
+            continue;
+        }
+        firmware_update_node_t *n = &u->nodes[id];
+        if (n->state == FIRMWARE_UPDATE_PENDING || is_active(n)) {
+            continue;
+        }
+        memset(n, 0, sizeof(*n));
+        n->state = FIRMWARE_UPDATE_PENDING;
+    }
+    return true;
+}
+
+uint8_t firmware_update_poll(firmware_update_t *u, uint32_t now_us, bool may_start)
+{
+    uint32_t active = 0;
+    int id;
+
+    update_rate(u, now_us);
+
+    for (id = 1; id < FIRMWARE_UPDATE_MAX_NODES; id++) {
+        firmware_update_node_t *n = &u->nodes[id];
+        if (n->state == FIRMWARE_UPDATE_READING
+            && now_us - n->last_activity_us > FIRMWARE_UPDATE_READ_TIMEOUT_US) {
+            n->state = FIRMWARE_UPDATE_FAILED;
+        }
+        if (is_active(n)) {
+            active++;
+        }
+    }
+
+    if (!may_start || active >= u->max_concurrent) {
+        return 0;
+    }
+    // nodes are added one per window, so that the rate accounts for the
+    // previous ones, and while one more would stay under budget
+    if (active > 0 && now_us - u->last_start_us < FIRMWARE_UPDATE_RATE_WINDOW_US) {
+        return 0;
+    }
+    if (active > 0 && (uint64_t)u->rate * (active + 1) > (uint64_t)u->budget * active) {
+        return 0;
+    }
+
+    for (id = 1; id < FIRMWARE_UPDATE_MAX_NODES; id++) {
+        firmware_update_node_t *n = &u->nodes[id];
+        if (n->state == FIRMWARE_UPDATE_PENDING) {
+            n->state = FIRMWARE_UPDATE_BEGINNING;
+            n->attempts++;
+            n->last_activity_us = now_us;
+            u->last_start_us = now_us;
+            return id;
+        }
+    }
+    return 0;
+}
+
+void firmware_update_begin_result(firmware_update_t *u, uint8_t node_id, bool responded,
+                                  uint8_t error, uint32_t now_us)
+{
+    if (node_id >= FIRMWARE_UPDATE_MAX_NODES) {
+        return;
+    }
+    firmware_update_node_t *n = &u->nodes[node_id];
+
+    // the node might have started reading before its response arrived
+    if (n->state != FIRMWARE_UPDATE_BEGINNING) {
+        return;
+    }
+
+    if (!responded) {
+        if (n->attempts < FIRMWARE_UPDATE_BEGIN_ATTEMPTS) {
+            n->state = FIRMWARE_UPDATE_PENDING;
+        } else {
+            n->state = FIRMWARE_UPDATE_FAILED;
+        }
+        return;
+    }
+
+    n->error = error;
+    n->last_activity_us = now_us;
+    n->state = error == 0 ? FIRMWARE_UPDATE_READING : FIRMWARE_UPDATE_FAILED;
+}
+
+int firmware_update_read(firmware_update_t *u, uint8_t node_id, uint32_t offset,
+                         uint8_t *data, uint32_t now_us)
+{
+    if (node_id >= FIRMWARE_UPDATE_MAX_NODES || u->image == NULL) {
+        return -1;
+    }
+    firmware_update_node_t *n = &u->nodes[node_id];
+
+    // a node which is done may read the last chunk again if its response got lost
+    if (!is_active(n) && n->state != FIRMWARE_UPDATE_DONE) {
+        return -1;
+    }
+
+    uint32_t len = 0;
+    if (offset < u->image_size) {
+        len = u->image_size - offset;
+        if (len > FIRMWARE_UPDATE_CHUNK_LEN) {
+            len = FIRMWARE_UPDATE_CHUNK_LEN;
+        }
+        memcpy(data, &u->image[offset], len);
+    }
+
+    update_rate(u, now_us);
+    u->window_bytes += len;
+
+    if (offset + len > n->progress) {
+        n->progress = offset + len;
+    }
+    n->last_activity_us = now_us;
+    if (len < FIRMWARE_UPDATE_CHUNK_LEN) {
+        n->state = FIRMWARE_UPDATE_DONE;
+    } else if (n->state != FIRMWARE_UPDATE_DONE) {
+        n->state = FIRMWARE_UPDATE_READING;
+    }
+
+    return len;
+}
+
+bool firmware_update_is_running(const firmware_update_t *u)
+{
+    return firmware_update_count(u, FIRMWARE_UPDATE_PENDING) > 0
+           || firmware_update_count(u, FIRMWARE_UPDATE_BEGINNING) > 0
+           || firmware_update_count(u, FIRMWARE_UPDATE_READING) > 0;
+}
+
+int firmware_update_count(const firmware_update_t *u, firmware_update_state_t state)
+{
+    int count = 0;
+    int id;
+
+    for (id = 1; id < FIRMWARE_UPDATE_MAX_NODES; id++) {
+        if (u->nodes[id].state == state) {
+            count++;
+        }
+    }
+    return count;
+}
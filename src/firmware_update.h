@@ -0,0 +1,118 @@
+#ifndef FIRMWARE_UPDATE_H
+#define FIRMWARE_UPDATE_H
+
+/*
+
+# Firmware update of the CAN nodes
+
+The master serves one firmware image to many nodes at once, following the
+UAVCAN firmware update procedure: each node is sent a
+uavcan.protocol.file.BeginFirmwareUpdate request naming the master as file
+server, then reboots into its bootloader which reads the image by chunks of
+FIRMWARE_UPDATE_CHUNK_LEN bytes with uavcan.protocol.file.Read. A chunk
+shorter than that marks the end of the file.
+
+Transfers cannot be delayed once a node asks for a chunk, so pacing happens
+when starting nodes: nodes begin their update one per rate window, while
+fewer than max_concurrent nodes are updating and as long as one more node
+reading at the average speed keeps the image under budget bytes per second.
+
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define FIRMWARE_UPDATE_MAX_NODES           128
+#define FIRMWARE_UPDATE_CHUNK_LEN           256
+#define FIRMWARE_UPDATE_IMAGE_PATH          "firmware.bin"
+
+/* A node which did not answer BeginFirmwareUpdate is asked that many times. */
+#define FIRMWARE_UPDATE_BEGIN_ATTEMPTS      3
+/* A node which stops reading the image for that long failed. */
+#define FIRMWARE_UPDATE_READ_TIMEOUT_US     5000000
+#define FIRMWARE_UPDATE_RATE_WINDOW_US      100000
+
+typedef enum {
+    FIRMWARE_UPDATE_IDLE = 0,
+    FIRMWARE_UPDATE_PENDING,    /**< Waiting for its turn. */
+    FIRMWARE_UPDATE_BEGINNING,  /**< BeginFirmwareUpdate was sent. */
+    FIRMWARE_UPDATE_READING,    /**< Reading the image. */
+    FIRMWARE_UPDATE_DONE,       /**< Read the whole image. */
+    FIRMWARE_UPDATE_FAILED,
+} firmware_update_state_t;
+
+typedef struct {
+    uint32_t progress;          /**< End of the furthest chunk served [bytes]. */
+    uint32_t last_activity_us;
+    uint8_t state;
+    uint8_t attempts;           /**< BeginFirmwareUpdate requests sent. */
+    uint8_t error;              /**< Last BeginFirmwareUpdate error code. */
+} firmware_update_node_t;
+
+typedef struct {
+    firmware_update_node_t nodes[FIRMWARE_UPDATE_MAX_NODES];
+    const uint8_t *image;
+    uint32_t image_size;
+    uint32_t max_concurrent;
+    uint32_t budget;            /**< Image bytes served per second. */
+    uint32_t window_start_us;
+    uint32_t window_bytes;
+    uint32_t rate;              /**< Bytes per second, over the last full window. */
+    uint32_t last_start_us;
+} firmware_update_t;
+
+void firmware_update_init(firmware_update_t *u);
+
+/** Sets the image to serve.
+ *
+ * @return false if an update is running, the image is then not changed.
+ */
+bool firmware_update_set_image(firmware_update_t *u, const uint8_t *image, uint32_t size);
+
+/** Queues the update of nodes. Nodes which are already being updated are
+ * left alone.
+ *
+ * @return false if there is no image.
+ */
+bool firmware_update_start(firmware_update_t *u, const uint8_t *node_ids, int nb_nodes,
+                           uint32_t max_concurrent, uint32_t budget, uint32_t now_us);
+
+/** Handles timeouts and tells which node should be sent BeginFirmwareUpdate.
+ *
+ * @param may_start Lets the caller hold new nodes back, for example when the
+ * bus is busy.
+ * @return The node ID, 0 if there is none.
+ */
+uint8_t firmware_update_poll(firmware_update_t *u, uint32_t now_us, bool may_start);
+
+/** Reports the result of a BeginFirmwareUpdate call.
+ *
+ * @param responded false if the call timed out.
+ * @param error The error code of the response, 0 is success.
+ */
+void firmware_update_begin_result(firmware_update_t *u, uint8_t node_id, bool responded,
+                                  uint8_t error, uint32_t now_us);
+
+/** Serves a chunk of the image to a node.
+ *
+ * @param [out] data Buffer of FIRMWARE_UPDATE_CHUNK_LEN bytes.
+ * @return The length of the chunk, or -1 if the node is not being updated.
+ */
+int firmware_update_read(firmware_update_t *u, uint8_t node_id, uint32_t offset,
+                         uint8_t *data, uint32_t now_us);
+
+/** Tells whether some nodes are still being updated or waiting for it. */
+bool firmware_update_is_running(const firmware_update_t *u);
+
+/** Counts the nodes in a given state. */
+int firmware_update_count(const firmware_update_t *u, firmware_update_state_t state);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* FIRMWARE_UPDATE_H */
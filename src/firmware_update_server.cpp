@@ -0,0 +1,375 @@
+#include <uavcan/uavcan.hpp>
+#include <uavcan/protocol/file/BeginFirmwareUpdate.hpp>
+#include <uavcan/protocol/file/Read.hpp>
+#include <uavcan/protocol/file/GetInfo.hpp>
+#include <ch.h>
+#include <string.h>
+#include <lwip/api.h>
+#include <crc/crc32.h>
+#include "uavcan_node_private.hpp"
+#include "timestamp/timestamp.h"
+#include "parameter/parameter.h"
+#include "config.h"
+#include "priorities.h"
+#include "flash.h"
+#include "main.h"
+#include "log.h"
+#include "firmware_update_server.h"
+
+#define IMAGE_SERVER_STACKSIZE      1024
+#define IMAGE_FLASH_SECTOR          10
+/* The image is preceded by its size and CRC, written once it was received. */
+#define IMAGE_HEADER_LEN            8
+#define IMAGE_BLOCK_LEN             1024
+
+extern "C" uint8_t __firmware_image_start__[];
+extern "C" uint8_t __firmware_image_size__[];
+
+using uavcan::protocol::file::BeginFirmwareUpdate;
+using uavcan::protocol::file::Read;
+using uavcan::protocol::file::GetInfo;
+
+static firmware_update_t firmware_update;
+static mutex_t firmware_update_lock;
+// lets the UAVCAN thread skip the polling when there is nothing to update
+static volatile bool update_running = false;
+
+static uavcan::ServiceClient<BeginFirmwareUpdate> *begin_client;
+
+static uint32_t read_u32(const uint8_t *p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static uint8_t *image_data(void)
+{
+    return &__firmware_image_start__[IMAGE_HEADER_LEN];
+}
+
+static uint32_t image_max_size(void)
+{
+    return (size_t)__firmware_image_size__ - IMAGE_HEADER_LEN;
+}
+
+/* Serves the image left in flash by a previous upload, if it is valid. */
+static void load_image(void)
+{
+    uint32_t size = read_u32(&__firmware_image_start__[0]);
+    uint32_t crc = read_u32(&__firmware_image_start__[4]);
+
+    if (size == 0 || size > image_max_size()) {
+        return;
+    }
+    if (crc32(0, image_data(), size) != crc) {
+        return;
+    }
+    chMtxLock(&firmware_update_lock);
+    firmware_update_set_image(&firmware_update, image_data(), size);
+    chMtxUnlock(&firmware_update_lock);
+}
+
+static void unlock_actuators(motor_driver_t *drv_list, uint16_t len)
+{
+    for (uint16_t i = 0; i < len; i++) {
+        motor_driver_unlock(&drv_list[i]);
+    }
+}
+
+/* The sector erase stalls the CPU, setpoints would not reach the actuators
+ * in time. Locks the first len drivers, so that none of them changes mode
+ * until unlock_actuators, and returns false with nothing locked if one of
+ * them is enabled. */
+static bool lock_disabled_actuators(motor_driver_t *drv_list, uint16_t len)
+{
+    for (uint16_t i = 0; i < len; i++) {
+        motor_driver_lock(&drv_list[i]);
+        if (motor_driver_get_control_mode(&drv_list[i]) != MOTOR_CONTROL_MODE_DISABLED) {
+            unlock_actuators(drv_list, i + 1);
+            return false;
+        }
+    }
+    return true;
+}
+
+/* Erases the image sector, refused while an actuator is enabled or an
+ * update is running. */
+static bool erase_image(void)
+{
+    motor_driver_t *drv_list;
+    uint16_t drv_list_len, len;
+
+    motor_manager_get_list(&motor_manager, &drv_list, &drv_list_len);
+    if (!lock_disabled_actuators(drv_list, drv_list_len)) {
+        return false;
+    }
+
+    // a driver created meanwhile is not locked
+    motor_manager_get_list(&motor_manager, &drv_list, &len);
+    bool erased = len == drv_list_len;
+    if (erased) {
+        chMtxLock(&firmware_update_lock);
+        erased = firmware_update_set_image(&firmware_update, NULL, 0);
+        chMtxUnlock(&firmware_update_lock);
+    }
+    if (erased) {
+        flash_sector_erase(IMAGE_FLASH_SECTOR);
+    }
+
+    unlock_actuators(drv_list, drv_list_len);
+    return erased;
+}
+
+static uint8_t receive_image(struct netconn *client)
+{
+    // flash is programmed by words
+    static uint32_t block_words[IMAGE_BLOCK_LEN / 4];
+    uint32_t header_words[IMAGE_HEADER_LEN / 4];
+    uint8_t *block = (uint8_t *)block_words;
+    uint8_t *header = (uint8_t *)header_words;
+    size_t header_len = 0, block_len = 0;
+    uint32_t size = 0, crc = 0, received = 0;
+    struct netbuf *buf;
+    uint8_t *data;
+    u16_t len;
+
+    while (header_len < IMAGE_HEADER_LEN || received < size) {
+        if (netconn_recv(client, &buf) != ERR_OK) {
+            return FIRMWARE_IMAGE_TRUNCATED;
+        }
+        do {
+            netbuf_data(buf, (void **)&data, &len);
+            while (len > 0) {
+                size_t n;
+                if (header_len < IMAGE_HEADER_LEN) {
+                    n = IMAGE_HEADER_LEN - header_len;
+                    n = n < len ? n : len;
+                    memcpy(&header[header_len], data, n);
+                    header_len += n;
+                    if (header_len == IMAGE_HEADER_LEN) {
+                        size = read_u32(&header[0]);
+                        crc = read_u32(&header[4]);
+                        if (size == 0 || size > image_max_size()) {
+                            netbuf_delete(buf);
+                            return FIRMWARE_IMAGE_TOO_LARGE;
+                        }
+                        if (!erase_image()) {
+                            netbuf_delete(buf);
+                            return FIRMWARE_IMAGE_BUSY;
+                        }
+                    }
+                } else {
+                    n = IMAGE_BLOCK_LEN - block_len;
+                    n = n < len ? n : len;
+                    n = n < size - received ? n : size - received;
+                    memcpy(&block[block_len], data, n);
+                    block_len += n;
+                    received += n;
+                    if (block_len == IMAGE_BLOCK_LEN || received == size) {
+                        uint32_t block_start = received - block_len;
+                        // pads the last block to whole words
+                        while (block_len % 4) {
+                            block[block_len++] = 0xff;
+                        }
+                        flash_write(&image_data()[block_start], block, block_len);
+                        block_len = 0;
+                    }
+                    if (n == 0) {
+                        // trailing bytes after the image are ignored
+                        n = len;
+                    }
+                }
+                data += n;
+                len -= n;
+            }
+        } while (netbuf_next(buf) >= 0);
+        netbuf_delete(buf);
+    }
+
+    if (crc32(0, image_data(), size) != crc) {
+        return FIRMWARE_IMAGE_BAD_CRC;
+    }
+    flash_write(&__firmware_image_start__[0], header, IMAGE_HEADER_LEN);
+
+    chMtxLock(&firmware_update_lock);
+    firmware_update_set_image(&firmware_update, image_data(), size);
+    chMtxUnlock(&firmware_update_lock);
+    log_message("firmware image of %d bytes received", (int)size);
+
+    return FIRMWARE_IMAGE_OK;
+}
+
+static THD_WORKING_AREA(image_server_wa, IMAGE_SERVER_STACKSIZE);
+static void image_server_thread(void *p)
+{
+    struct netconn *conn, *client;
+    (void) p;
+
+    chRegSetThreadName("firmware_image");
+
+    conn = netconn_new(NETCONN_TCP);
+    if (conn == NULL) {
+        chSysHalt("Cannot create firmware image server connection (out of memory).");
+    }
+    netconn_bind(conn, IP_ADDR_ANY, FIRMWARE_UPDATE_PORT);
+    netconn_listen(conn);
+
+    while (1) {
+        if (netconn_accept(conn, &client) != ERR_OK) {
+            continue;
+        }
+        uint8_t status = receive_image(client);
+        netconn_write(client, &status, 1, NETCONN_COPY);
+        netconn_close(client);
+        netconn_delete(client);
+    }
+}
+
+void firmware_update_server_init(void)
+{
+    chMtxObjectInit(&firmware_update_lock);
+    firmware_update_init(&firmware_update);
+    load_image();
+
+    chThdCreateStatic(image_server_wa, sizeof(image_server_wa),
+                      FIRMWARE_IMAGE_SERVER_PRIO, image_server_thread, NULL);
+}
+
+void firmware_update_server_uavcan_init(void)
+{
+    Node& node = uavcan_node::getNode();
+    static uavcan::ServiceClient<BeginFirmwareUpdate> client(node);
+    static uavcan::ServiceServer<Read> read_server(node);
+    static uavcan::ServiceServer<GetInfo> info_server(node);
+    int res;
+
+    // several nodes are asked to begin their update at the same time
+    res = client.init();
+    if (res < 0) {
+        chSysHalt("uavcan::protocol::file::BeginFirmwareUpdate client");
+    }
+    client.setCallback(
+        [](const uavcan::ServiceCallResult<BeginFirmwareUpdate>& r)
+        {
+            uint8_t id = r.getCallID().server_node_id.get();
+            uint8_t error = r.getResponse().error;
+            // already reading the image, for example after a lost response
+            if (error == BeginFirmwareUpdate::Response::ERROR_IN_PROGRESS) {
+                error = BeginFirmwareUpdate::Response::ERROR_OK;
+            }
+            chMtxLock(&firmware_update_lock);
+            firmware_update_begin_result(&firmware_update, id, r.isSuccessful(), error, timestamp_get());
+            chMtxUnlock(&firmware_update_lock);
+            if (!r.isSuccessful() || error != BeginFirmwareUpdate::Response::ERROR_OK) {
+                log_message("node %d did not begin its firmware update", id);
+            }
+        }
+    );
+
+    res = read_server.start(
+        [](const uavcan::ReceivedDataStructure<Read::Request>& req, Read::Response& resp)
+        {
+            static uint8_t chunk[FIRMWARE_UPDATE_CHUNK_LEN];
+            if (!(req.path.path == FIRMWARE_UPDATE_IMAGE_PATH)) {
+                resp.error.value = uavcan::protocol::file::Error::NOT_FOUND;
+                return;
+            }
+            uint32_t offset = req.offset > UINT32_MAX ? UINT32_MAX : req.offset;
+            chMtxLock(&firmware_update_lock);
+            int len = firmware_update_read(&firmware_update, req.getSrcNodeID().get(),
+                                           offset, chunk, timestamp_get());
+            chMtxUnlock(&firmware_update_lock);
+            if (len < 0) {
+                resp.error.value = uavcan::protocol::file::Error::ACCESS_DENIED;
+                return;
+            }
+            for (int i = 0; i < len; i++) {
+                resp.data.push_back(chunk[i]);
+            }
+        }
+    );
+    if (res < 0) {
+        chSysHalt("uavcan::protocol::file::Read server");
+    }
+
+    res = info_server.start(
+        [](const uavcan::ReceivedDataStructure<GetInfo::Request>& req, GetInfo::Response& resp)
+        {
+            uint32_t size = firmware_update_server_image_size();
+            if (!(req.path.path == FIRMWARE_UPDATE_IMAGE_PATH) || size == 0) {
+                resp.error.value = uavcan::protocol::file::Error::NOT_FOUND;
+                return;
+            }
+            resp.size = size;
+            resp.entry_type.flags = uavcan::protocol::file::EntryType::FLAG_FILE
+                                    | uavcan::protocol::file::EntryType::FLAG_READABLE;
+        }
+    );
+    if (res < 0) {
+        chSysHalt("uavcan::protocol::file::GetInfo server");
+    }
+
+    begin_client = &client;
+}
+
+void firmware_update_server_poll(bool bus_busy)
+{
+    if (!update_running) {
+        return;
+    }
+
+    chMtxLock(&firmware_update_lock);
+    uint8_t id = firmware_update_poll(&firmware_update, timestamp_get(), !bus_busy);
+    update_running = firmware_update_is_running(&firmware_update);
+    chMtxUnlock(&firmware_update_lock);
+
+    if (id == 0) {
+        return;
+    }
+
+    BeginFirmwareUpdate::Request request;
+    request.source_node_id = uavcan_node::getNode().getNodeID().get();
+    request.image_file_remote_path.path = FIRMWARE_UPDATE_IMAGE_PATH;
+    if (begin_client->call(id, request) < 0) {
+        chMtxLock(&firmware_update_lock);
+        firmware_update_begin_result(&firmware_update, id, false, 0, timestamp_get());
+        chMtxUnlock(&firmware_update_lock);
+    }
+}
+
+bool firmware_update_server_start(const uint8_t *node_ids, int nb_nodes)
+{
+    parameter_t *max_concurrent = parameter_find(&global_config, "/master/firmware_update/max_concurrent");
+    parameter_t *rate = parameter_find(&global_config, "/master/firmware_update/rate");
+
+    chMtxLock(&firmware_update_lock);
+    bool started = firmware_update_start(&firmware_update, node_ids, nb_nodes,
+                                         parameter_integer_get(max_concurrent),
+                                         parameter_scalar_get(rate), timestamp_get());
+    if (started) {
+        update_running = true;
+    }
+    chMtxUnlock(&firmware_update_lock);
+
+    return started;
+}
+
+bool firmware_update_server_get_status(uint8_t node_id, firmware_update_node_t *status)
+{
+    if (node_id >= FIRMWARE_UPDATE_MAX_NODES) {
+        return false;
+    }
+    chMtxLock(&firmware_update_lock);
+    *status = firmware_update.nodes[node_id];
+    chMtxUnlock(&firmware_update_lock);
+
+    return status->state != FIRMWARE_UPDATE_IDLE;
+}
+
+uint32_t firmware_update_server_image_size(void)
+{
+    chMtxLock(&firmware_update_lock);
+    uint32_t size = firmware_update.image != NULL ? firmware_update.image_size : 0;
+    chMtxUnlock(&firmware_update_lock);
+
+    return size;
+}
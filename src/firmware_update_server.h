@@ -0,0 +1,77 @@
+#ifndef FIRMWARE_UPDATE_SERVER_H
+#define FIRMWARE_UPDATE_SERVER_H
+
+/*
+
+# Firmware update server
+
+Updates the firmware of CAN nodes through the master, see firmware_update.h.
+
+The image is uploaded with a TCP connection on FIRMWARE_UPDATE_PORT:
+
+    uint32 size, uint32 crc32, image[size]
+
+all little endian. The master answers with one byte, a
+firmware_image_status_t, and closes the connection. The image is kept in
+flash and served again after a reboot.
+
+@warning Writing the image erases a flash sector, which stalls the CPU and
+masks interrupts for 1 to 2 s: no setpoint, CAN frame or Ethernet packet is
+handled meanwhile. Uploads are therefore refused with FIRMWARE_IMAGE_BUSY
+unless every actuator is disabled, and the drivers are locked from that check
+until the end of the erase, so that no actuator is enabled meanwhile.
+
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "firmware_update.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define FIRMWARE_UPDATE_PORT 20005
+
+typedef enum {
+    FIRMWARE_IMAGE_OK = 0,
+    FIRMWARE_IMAGE_TOO_LARGE,
+    FIRMWARE_IMAGE_BAD_CRC,
+    FIRMWARE_IMAGE_BUSY,        /**< An update is running or an actuator is enabled. */
+    FIRMWARE_IMAGE_TRUNCATED,   /**< Connection closed before the end. */
+} firmware_image_status_t;
+
+/** Starts the TCP server receiving firmware images. */
+void firmware_update_server_init(void);
+
+/** Sets up the UAVCAN file server and loads the image kept in flash.
+ * Called from the UAVCAN thread. */
+void firmware_update_server_uavcan_init(void);
+
+/** Starts the updates which are due. Called from the UAVCAN thread.
+ *
+ * @param bus_busy Holds new nodes back.
+ */
+void firmware_update_server_poll(bool bus_busy);
+
+/** Updates the firmware of the given nodes with the image in flash, with the
+ * limits set in /master/firmware_update.
+ *
+ * @return false if there is no valid image.
+ */
+bool firmware_update_server_start(const uint8_t *node_ids, int nb_nodes);
+
+/** Copies the update status of a node.
+ *
+ * @return false if its update was never started.
+ */
+bool firmware_update_server_get_status(uint8_t node_id, firmware_update_node_t *status);
+
+/** @return Size of the image, 0 if there is no valid one. */
+uint32_t firmware_update_server_image_size(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* FIRMWARE_UPDATE_SERVER_H */
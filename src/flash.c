@@ -0,0 +1,87 @@
+#include <ch.h>
+#include <hal.h>
+#include "flash.h"
+
+#define FLASH_KEY1 0x45670123
+#define FLASH_KEY2 0xCDEF89AB
+
+/* A word takes up to 100 us to program, this bounds the time spent with
+ * interrupts masked to about 1.6 ms. */
+#define FLASH_WRITE_WORDS_PER_LOCK 16
+
+static void flash_wait_for_last_operation(void)
+{
+    while (FLASH->SR & FLASH_SR_BSY);
+}
+
+static void flash_unlock(void)
+{
+    if (FLASH->CR & FLASH_CR_LOCK) {
+        FLASH->KEYR = FLASH_KEY1;
+        FLASH->KEYR = FLASH_KEY2;
+    }
+}
+
+static void flash_lock(void)
+{
+    FLASH->CR |= FLASH_CR_LOCK;
+}
+
+static void flash_clear_errors(void)
+{
+    FLASH->SR = FLASH_SR_EOP | FLASH_SR_OPERR | FLASH_SR_WRPERR |
+                FLASH_SR_PGAERR | FLASH_SR_PGPERR | FLASH_SR_PGSERR;
+}
+
+void flash_sector_erase(uint8_t sector)
+{
+    chSysLock();
+    flash_unlock();
+    flash_wait_for_last_operation();
+    flash_clear_errors();
+
+    /* 32-bit parallelism, valid for 2.7 V to 3.6 V */
+    FLASH->CR = FLASH_CR_PSIZE_1 | FLASH_CR_SER | (sector * FLASH_CR_SNB_0);
+    FLASH->CR |= FLASH_CR_STRT;
+    flash_wait_for_last_operation();
+    FLASH->CR &= ~FLASH_CR_SER;
+
+    /* The data cache may hold the previous content of the sector. */
+    FLASH->ACR &= ~FLASH_ACR_DCEN;
+    FLASH->ACR |= FLASH_ACR_DCRST;
+    FLASH->ACR &= ~FLASH_ACR_DCRST;
+    FLASH->ACR |= FLASH_ACR_DCEN;
+
+    flash_lock();
+    chSysUnlock();
+}
+
+void flash_write(void *dst, const void *src, size_t len)
+{
+    volatile uint32_t *d = (volatile uint32_t *)dst;
+    const uint32_t *s = (const uint32_t *)src;
+    size_t words = len / sizeof(uint32_t);
+    size_t i = 0;
+
+    while (i < words) {
+        size_t end = i + FLASH_WRITE_WORDS_PER_LOCK;
+        if (end > words) {
+            end = words;
+        }
+
+        chSysLock();
+        flash_unlock();
+        flash_wait_for_last_operation();
+        flash_clear_errors();
+
+        FLASH->CR = FLASH_CR_PSIZE_1 | FLASH_CR_PG;
+        for (; i < end; i++) {
+            d[i] = s[i];
+            flash_wait_for_last_operation();
+        }
+        FLASH->CR &= ~FLASH_CR_PG;
+
+        flash_lock();
+        chSysUnlock();
+    }
+}
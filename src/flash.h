@@ -0,0 +1,29 @@
+#ifndef FLASH_H
+#define FLASH_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Erases one sector of the internal flash.
+ *
+ * @warning The CPU stalls on any flash access while the sector is erased,
+ * which takes up to 2 s for a 128 KB sector.
+ */
+void flash_sector_erase(uint8_t sector);
+
+/** Programs len bytes at dst, both word aligned, from src.
+ *
+ * Interrupts are masked while programming, so the words are written a few
+ * at a time and other threads run in between.
+ */
+void flash_write(void *dst, const void *src, size_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* FLASH_H */
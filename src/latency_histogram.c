@@ -0,0 +1,47 @@
+#include <string.h>
+#include "latency_histogram.h"
+
+void latency_histogram_init(latency_histogram_t *h)
+{
+    memset(h, 0, sizeof(*h));
+}
+
+void latency_histogram_record(latency_histogram_t *h, uint32_t latency_us)
+{
+    int bin = 0;
+    while (bin < LATENCY_HISTOGRAM_NB_BINS - 1 && latency_us >= latency_histogram_bin_limit(bin)) {
+        bin++;
+    }
+    h->bins[bin]++;
+    h->count++;
+    if (latency_us > h->max_us) {
+        h->max_us = latency_us;
+    }
+}
+
+uint32_t latency_histogram_bin_limit(int bin)
+{
+    return 2u << bin;
+}
+
+uint32_t latency_histogram_percentile(const latency_histogram_t *h, uint32_t percent)
+{
+    uint64_t threshold = ((uint64_t)h->count * percent + 99) / 100;
+    uint32_t seen = 0;
+    int bin;
+
+    if (h->count == 0) {
+        return 0;
+    }
+    for (bin = 0; bin < LATENCY_HISTOGRAM_NB_BINS - 1; bin++) {
+        seen += h->bins[bin];
+        if (seen >= threshold) {
+            break;
+        }
+    }
+    uint32_t limit = latency_histogram_bin_limit(bin);
+    if (bin == LATENCY_HISTOGRAM_NB_BINS - 1 || h->max_us < limit) {
+        return h->max_us;
+    }
+    return limit;
+}
@@ -0,0 +1,47 @@
+#ifndef LATENCY_HISTOGRAM_H
+#define LATENCY_HISTOGRAM_H
+
+/*
+
+# Latency histogram
+
+Counts latencies in bins growing by powers of two: bin 0 holds latencies
+below 2 us, bin i those in [2^i, 2^(i + 1)) us, and the last bin everything
+above. No locking is done.
+
+ */
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define LATENCY_HISTOGRAM_NB_BINS 16
+
+typedef struct {
+    uint32_t bins[LATENCY_HISTOGRAM_NB_BINS];
+    uint32_t count;
+    uint32_t max_us;
+} latency_histogram_t;
+
+void latency_histogram_init(latency_histogram_t *h);
+
+void latency_histogram_record(latency_histogram_t *h, uint32_t latency_us);
+
+/** Upper bound of bin, in microseconds. */
+uint32_t latency_histogram_bin_limit(int bin);
+
+/** Gives an upper bound of the given percentile of the latencies.
+ *
+ * @param percent Between 0 and 100.
+ * @return The upper bound of the bin it falls in, or the maximum if that is
+ * lower. 0 if nothing was recorded.
+ */
+uint32_t latency_histogram_percentile(const latency_histogram_t *h, uint32_t percent);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LATENCY_HISTOGRAM_H */
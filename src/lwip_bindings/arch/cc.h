@@ -31,6 +31,28 @@ typedef intptr_t mem_ptr_t;
 #define S32_F "d"
 #define X32_F "x"
 
+/* Relocates the lwIP heap and memory pools to CCM, as documented in memp.c.
+ * Pool names come from lwip/memp_std.h. */
+#if LWIP_STATIC_POOLS
+#define LWIP_CCM __attribute__((section(".ccm")))
+extern u8_t LWIP_CCM ram_heap[];
+extern u8_t LWIP_CCM memp_memory_RAW_PCB_base[];
+extern u8_t LWIP_CCM memp_memory_UDP_PCB_base[];
+extern u8_t LWIP_CCM memp_memory_TCP_PCB_base[];
+extern u8_t LWIP_CCM memp_memory_TCP_PCB_LISTEN_base[];
+extern u8_t LWIP_CCM memp_memory_TCP_SEG_base[];
+extern u8_t LWIP_CCM memp_memory_REASSDATA_base[];
+extern u8_t LWIP_CCM memp_memory_FRAG_PBUF_base[];
+extern u8_t LWIP_CCM memp_memory_NETBUF_base[];
+extern u8_t LWIP_CCM memp_memory_NETCONN_base[];
+extern u8_t LWIP_CCM memp_memory_TCPIP_MSG_API_base[];
+extern u8_t LWIP_CCM memp_memory_TCPIP_MSG_INPKT_base[];
+extern u8_t LWIP_CCM memp_memory_ARP_QUEUE_base[];
+extern u8_t LWIP_CCM memp_memory_SYS_TIMEOUT_base[];
+extern u8_t LWIP_CCM memp_memory_PBUF_base[];
+extern u8_t LWIP_CCM memp_memory_PBUF_POOL_base[];
+#endif
+
 /* Diagnostic macros. */
 #define LWIP_PLATFORM_ASSERT(msg) chSysHalt(msg)
 
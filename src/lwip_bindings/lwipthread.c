@@ -55,6 +55,8 @@ limitations under the License.
  * @{
  */
 
+#include <string.h>
+
 #include "hal.h"
 #include "evtimer.h"
 
@@ -71,12 +73,77 @@ limitations under the License.
 #include <lwip/tcpip.h>
 #include "netif/etharp.h"
 #include "netif/ppp/pppoe.h"
+#include "timestamp/timestamp.h"
 
 #define PERIODIC_TIMER_ID       1
 #define FRAME_RECEIVED_ID       2
 
+#if LWIP_ETH_ZERO_COPY_RX
+#if !MAC_USE_ZERO_COPY
+#error "LWIP_ETH_ZERO_COPY_RX requires MAC_USE_ZERO_COPY in halconf.h"
+#endif
+#if !LWIP_SUPPORT_CUSTOM_PBUF
+#error "LWIP_ETH_ZERO_COPY_RX requires LWIP_SUPPORT_CUSTOM_PBUF in lwipopts.h"
+#endif
+#if ETH_PAD_SIZE
+#error "LWIP_ETH_ZERO_COPY_RX does not support ETH_PAD_SIZE"
+#endif
+#endif
+
 static sys_sem_t lwip_init_done;
 
+static eth_stats_t eth_stats;
+static volatile timestamp_t last_rx_timestamp;
+
+#if LWIP_ETH_ZERO_COPY_RX
+/* Receive DMA buffer lent to lwIP. The descriptor is handed back to the MAC
+ * when the stack frees the pbuf. */
+struct rx_pbuf {
+    struct pbuf_custom p;
+    MACReceiveDescriptor rd;
+};
+
+/* At least one descriptor always stays owned by the DMA, otherwise reception
+ * stalls until the application frees its pbufs. */
+#define RX_PBUF_POOL_SIZE       (STM32_MAC_RECEIVE_BUFFERS - 1)
+
+static struct rx_pbuf rx_pbuf_buffer[RX_PBUF_POOL_SIZE];
+static memory_pool_t rx_pbuf_pool;
+
+static void rx_pbuf_free(struct pbuf *p)
+{
+    struct rx_pbuf *rx = (struct rx_pbuf *)p;
+
+    macReleaseReceiveDescriptor(&rx->rd);
+    chPoolFree(&rx_pbuf_pool, rx);
+}
+
+/* Wraps the frame in place, returns NULL if no wrapper is left. */
+static struct pbuf *rx_pbuf_wrap(MACReceiveDescriptor *rd)
+{
+    struct rx_pbuf *rx;
+    const uint8_t *payload;
+    size_t size;
+    struct pbuf *p;
+
+    rx = chPoolAlloc(&rx_pbuf_pool);
+    if (rx == NULL) {
+        return NULL;
+    }
+
+    rx->rd = *rd;
+    rx->p.custom_free_function = rx_pbuf_free;
+    payload = macGetNextReceiveBuffer(&rx->rd, &size);
+
+    p = pbuf_alloced_custom(PBUF_RAW, (u16_t)size, PBUF_REF, &rx->p,
+                            (void *)payload, (u16_t)size);
+    if (p == NULL) {
+        chPoolFree(&rx_pbuf_pool, rx);
+    }
+    return p;
+}
+#endif
+
 
 /*
  * Initialization.
@@ -101,12 +168,15 @@ static void low_level_init(struct netif *netif) {
 static err_t low_level_output(struct netif *netif, struct pbuf *p) {
     struct pbuf *q;
     MACTransmitDescriptor td;
+    rtcnt_t start;
 
     (void)netif;
     if (macWaitTransmitDescriptor(&ETHD1, &td, MS2ST(LWIP_SEND_TIMEOUT)) != MSG_OK) {
         return ERR_TIMEOUT;
     }
 
+    start = chSysGetRealtimeCounterX();
+
 #if ETH_PAD_SIZE
     pbuf_header(p, -ETH_PAD_SIZE);        /* drop the padding word */
 #endif
@@ -121,6 +191,12 @@ static err_t low_level_output(struct netif *netif, struct pbuf *p) {
     pbuf_header(p, ETH_PAD_SIZE);         /* reclaim the padding word */
 #endif
 
+    chSysLock();
+    eth_stats.tx_frames++;
+    eth_stats.tx_bytes += p->tot_len;
+    eth_stats.tx_cycles += chSysGetRealtimeCounterX() - start;
+    chSysUnlock();
+
     LINK_STATS_INC(link.xmit);
 
     return ERR_OK;
@@ -133,11 +209,29 @@ static struct pbuf *low_level_input(struct netif *netif) {
     MACReceiveDescriptor rd;
     struct pbuf *p, *q;
     u16_t len;
+    rtcnt_t start;
 
     (void)netif;
     if (macWaitReceiveDescriptor(&ETHD1, &rd, TIME_IMMEDIATE) == MSG_OK) {
+        start = chSysGetRealtimeCounterX();
+        last_rx_timestamp = timestamp_get();
         len = (u16_t)rd.size;
 
+#if LWIP_ETH_ZERO_COPY_RX
+        p = rx_pbuf_wrap(&rd);
+        if (p != NULL) {
+            LINK_STATS_INC(link.recv);
+            chSysLock();
+            eth_stats.rx_frames++;
+            eth_stats.rx_zero_copy++;
+            eth_stats.rx_bytes += len;
+            eth_stats.rx_cycles += chSysGetRealtimeCounterX() - start;
+            chSysUnlock();
+            return p;
+        }
+        /* All wrappers are held by the stack, fall back to copying. */
+#endif
+
 #if ETH_PAD_SIZE
         len += ETH_PAD_SIZE;        /* allow room for Ethernet padding */
 #endif
@@ -162,6 +256,11 @@ static struct pbuf *low_level_input(struct netif *netif) {
 #endif
 
             LINK_STATS_INC(link.recv);
+            chSysLock();
+            eth_stats.rx_frames++;
+            eth_stats.rx_bytes += p->tot_len;
+            eth_stats.rx_cycles += chSysGetRealtimeCounterX() - start;
+            chSysUnlock();
         }
         else {
             macReleaseReceiveDescriptor(&rd);
@@ -228,6 +327,11 @@ void lwip_thread(void *p) {
 
     chRegSetThreadName("lwip");
 
+#if LWIP_ETH_ZERO_COPY_RX
+    chPoolObjectInit(&rx_pbuf_pool, sizeof(struct rx_pbuf), NULL);
+    chPoolLoadArray(&rx_pbuf_pool, rx_pbuf_buffer, RX_PBUF_POOL_SIZE);
+#endif
+
     sys_sem_new(&lwip_init_done, 0);
 
     /* Initializes the thing.*/
@@ -300,6 +404,25 @@ void lwip_thread(void *p) {
     }
 }
 
+void eth_stats_get(eth_stats_t *stats)
+{
+    chSysLock();
+    *stats = eth_stats;
+    chSysUnlock();
+}
+
+timestamp_t eth_last_rx_timestamp(void)
+{
+    return last_rx_timestamp;
+}
+
+void eth_stats_reset(void)
+{
+    chSysLock();
+    memset(&eth_stats, 0, sizeof(eth_stats));
+    chSysUnlock();
+}
+
 void ip_thread_init(void)
 {
     static THD_WORKING_AREA(wa_lwip_thread, LWIP_THREAD_STACK_SIZE);
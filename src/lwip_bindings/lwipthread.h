@@ -24,7 +24,9 @@
 #ifndef _LWIPTHREAD_H_
 #define _LWIPTHREAD_H_
 
+#include <stdint.h>
 #include <lwip/opt.h>
+#include "timestamp/timestamp.h"
 
 /** @brief MAC thread priority.*/
 #ifndef LWIP_THREAD_PRIORITY
@@ -61,6 +63,15 @@
 #define LWIP_SEND_TIMEOUT                   50
 #endif
 
+/** @brief Hands the MAC receive buffers to lwIP instead of copying them.
+ *
+ * Requires MAC_USE_ZERO_COPY in halconf.h and LWIP_SUPPORT_CUSTOM_PBUF in
+ * lwipopts.h. Transmission always copies, because the MAC driver owns the
+ * transmit buffers. */
+#if !defined(LWIP_ETH_ZERO_COPY_RX) || defined(__DOXYGEN__)
+#define LWIP_ETH_ZERO_COPY_RX               FALSE
+#endif
+
 /** @brief Link speed. */
 #if !defined(LWIP_LINK_SPEED) || defined(__DOXYGEN__)
 #define LWIP_LINK_SPEED                     100000000
@@ -111,8 +122,28 @@
 extern "C" {
 #endif
 
+/** @brief Ethernet driver counters, used to compare the receive paths. */
+typedef struct {
+    uint32_t rx_frames;
+    uint32_t rx_zero_copy;      /**< Frames passed to lwIP without a copy. */
+    uint32_t rx_bytes;
+    uint32_t rx_cycles;         /**< CPU cycles spent in low_level_input. */
+    uint32_t tx_frames;
+    uint32_t tx_bytes;
+    uint32_t tx_cycles;         /**< CPU cycles spent in low_level_output. */
+} eth_stats_t;
+
 void ip_thread_init(void);
 
+/** @brief Copies the Ethernet driver counters. */
+void eth_stats_get(eth_stats_t *stats);
+
+/** @brief Clears the Ethernet driver counters. */
+void eth_stats_reset(void);
+
+/** @brief Time at which the last frame was taken from the MAC. */
+timestamp_t eth_last_rx_timestamp(void);
+
 #ifdef __cplusplus
 }
 #endif
@@ -29,6 +29,10 @@
 #define DEFAULT_TCP_RECVMBOX_SIZE       4
 #define DEFAULT_ACCEPTMBOX_SIZE         4
 
+/* Lets the Ethernet driver lend receive DMA buffers to the stack, see
+ * LWIP_ETH_ZERO_COPY_RX in lwipthread.h. */
+#define LWIP_SUPPORT_CUSTOM_PBUF        1
+
 #define LWIP_IPADDR(p)  IP4_ADDR(p, 192, 168, 3, 20)
 #define LWIP_GATEWAY(p) IP4_ADDR(p, 192, 168, 3, 1)
 #define LWIP_NETMASK(p) IP4_ADDR(p, 255, 255, 255, 0)
@@ -52,10 +56,50 @@
 #define SNTP_RETRY_TIMEOUT_EXP  0
 #define SNTP_RETRY_TIMEOUT      3000
 
-/** Use newlib malloc() instead of memory pools. */
 #include <stdlib.h>
+
+/** Use dedicated lwIP memory pools instead of newlib malloc(). Network
+ * allocations then never take the malloc lock. The pools are placed in CCM
+ * (see arch/cc.h), which is fine as long as the Ethernet DMA only touches the
+ * MAC driver's own buffers. */
+#define LWIP_STATIC_POOLS               1
+
+#if LWIP_STATIC_POOLS
+#define MEM_LIBC_MALLOC                 0
+#define MEMP_MEM_MALLOC                 0
+#define MEMP_SEPARATE_POOLS             1
+
+/* Heap for PBUF_RAM (outgoing TCP and copied UDP data). */
+#define MEM_SIZE                        (8 * 1024)
+
+/* The message queues take up to 13 pool pbufs, see rpc_server.c. */
+#define PBUF_POOL_SIZE                  17
+#define MEMP_NUM_PBUF                   16
+#define MEMP_NUM_RAW_PCB                2
+/* Every message_transmit() call creates its own UDP netconn. */
+#define MEMP_NUM_UDP_PCB                12
+#define MEMP_NUM_TCP_PCB                6
+#define MEMP_NUM_TCP_PCB_LISTEN         2
+#define MEMP_NUM_TCP_SEG                16
+#define MEMP_NUM_REASSDATA              2
+#define MEMP_NUM_FRAG_PBUF              4
+#define MEMP_NUM_ARP_QUEUE              8
+#define MEMP_NUM_NETBUF                 12
+#define MEMP_NUM_NETCONN                16
+#define MEMP_NUM_TCPIP_MSG_API          16
+#define MEMP_NUM_TCPIP_MSG_INPKT        16
+/* TCP, IP reassembly, ARP, 2x DHCP and SNTP. */
+#define MEMP_NUM_SYS_TIMEOUT            8
+#else
+/** Use newlib malloc() instead of memory pools. */
 #define MEM_LIBC_MALLOC 1
 #define MEMP_MEM_MALLOC 1
+#endif
+
+/* Usage and high-water mark of each pool, see the lwip_pools command. */
+#define LWIP_STATS                      1
+#define MEM_STATS                       1
+#define MEMP_STATS                      1
 
 
 #define ODOMETRY_PUBLISHER_PORT 20042
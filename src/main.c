@@ -17,12 +17,16 @@
 #include "blocking_uart_driver.h"
 #include "rpc_server.h"
 #include "uavcan_node.h"
+#include "can_bridge_server.h"
+#include "can_capture.h"
+#include "firmware_update_server.h"
 #include "timestamp/timestamp_stm32.h"
 #include "config.h"
 #include "interface_panel.h"
 #include "robot_pose.h"
 #include "robot_parameters.h"
 #include "odometry_publisher.h"
+#include "wheel_odometry.h"
 #include "motor_manager.h"
 #include "differential_base.h"
 #include "stream.h"
@@ -130,7 +134,9 @@ int main(void) {
 
     /* Initialize global objects. */
     config_init();
-    chMtxObjectInit(&robot_pose_lock);
+
+    static __attribute__((section(".ccm"))) pose_history_entry_t pose_history_buffer[POSE_HISTORY_LEN];
+    robot_pose_history_init(pose_history_buffer, POSE_HISTORY_LEN);
 
 
     /* Initialise timestamp module */
@@ -178,9 +184,14 @@ int main(void) {
     }
 
     sntp_init();
+    wheel_odometry_init();
+    can_bridge_server_init();
+    can_capture_init();
+    firmware_update_server_init();
     uavcan_node_start(10);
     rpc_server_init();
     message_server_init();
+    rt_message_server_init();
     interface_panel_init();
     odometry_publisher_init();
     imu_init();
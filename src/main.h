@@ -11,6 +11,7 @@ extern "C" {
 #define MAX_NB_TRAJECTORY_BUFFERS       15
 #define MAX_NB_MOTOR_DRIVERS            20
 #define MAX_NB_BUS_ENUMERATOR_ENTRIES   21
+#define POSE_HISTORY_LEN                256
 
 #include "motor_manager.h"
 
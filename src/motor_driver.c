@@ -3,6 +3,7 @@
 #include "motor_driver.h"
 
 #include "log.h"
+#include "can_capture.h"
 #include "timestamp/timestamp.h"
 
 #define MOTOR_CONTROL_UPDATE_PERIOD_POSITION    0.05f // [s]
@@ -43,6 +44,7 @@ void motor_driver_init(motor_driver_t *d,
 
     d->control_mode = MOTOR_CONTROL_MODE_DISABLED;
     d->update_period = 1;
+    d->trajectory_version = 0;
 
     d->can_driver = NULL;
 
@@ -55,6 +57,9 @@ void motor_driver_init(motor_driver_t *d,
     parameter_scalar_declare_with_default(&d->config.velocity_limit, &d->config.control, "velocity_limit", 0);
     parameter_scalar_declare_with_default(&d->config.acceleration_limit, &d->config.control, "acceleration_limit", 0);
     parameter_scalar_declare_with_default(&d->config.low_batt_th, &d->config.control, "low_batt_th", 12);
+    parameter_integer_declare_with_default(&d->config.trajectory_segment_len, &d->config.control, "trajectory_segment_len", 0);
+    parameter_scalar_declare_with_default(&d->config.setpoint_deadband, &d->config.control, "setpoint_deadband", 0);
+    parameter_scalar_declare_with_default(&d->config.setpoint_keepalive, &d->config.control, "setpoint_keepalive", 0);
 
     parameter_namespace_declare(&d->config.thermal, &d->config.root, "thermal");
     parameter_scalar_declare(&d->config.thermal_capacity, &d->config.thermal, "capacity");
@@ -167,6 +172,7 @@ void motor_driver_update_trajectory(motor_driver_t *d, trajectory_chunk_t *traj)
             // chSysHalt("TRAJECTORY_ERROR_CHUNK_OUT_OF_ORER");
             break;
     }
+    d->trajectory_version++;
     d->update_period = MOTOR_CONTROL_UPDATE_PERIOD_TRAJECTORY;
     chBSemSignal(&d->lock);
 }
@@ -202,6 +208,11 @@ void motor_driver_unlock(motor_driver_t *d)
 }
 
 
+float motor_driver_get_update_period(motor_driver_t *d)
+{
+    return d->update_period;
+}
+
 int motor_driver_get_control_mode(motor_driver_t *d)
 {
     return d->control_mode;
@@ -253,6 +264,7 @@ void motor_driver_get_trajectory_point(motor_driver_t *d,
     if (t == NULL) {
         // chSysHalt("control error"); // todo
         log_message("trajectory read: %d failed", timestamp_get());
+        can_capture_trigger(CAN_RECORDER_TRIGGER_TRAJECTORY_UNDERRUN);
         *position = 0;
         *velocity = 0;
         *acceleration = 0;
@@ -265,6 +277,48 @@ void motor_driver_get_trajectory_point(motor_driver_t *d,
     *torque = t[3];
 }
 
+int motor_driver_get_trajectory_segment(motor_driver_t *d,
+                                        int64_t from_us,
+                                        int max_points,
+                                        float *points,
+                                        int64_t *start_us)
+{
+    if (d->control_mode != MOTOR_CONTROL_MODE_TRAJECTORY) {
+        chSysHalt("motor driver get trajectory wrong setpt mode");
+    }
+    trajectory_t *traj = d->setpt.trajectory;
+    int64_t dt = traj->sampling_time_us;
+
+    if (from_us < traj->read_time_us) {
+        from_us = traj->read_time_us;
+    }
+    int64_t t = traj->read_time_us + (from_us - traj->read_time_us) / dt * dt;
+    *start_us = t;
+
+    int n;
+    for (n = 0; n < max_points; n++, t += dt) {
+        float *p = trajectory_peek(traj, t);
+        if (p == NULL) {
+            break;
+        }
+        memcpy(&points[4 * n], p, 4 * sizeof(float));
+    }
+    return n;
+}
+
+int64_t motor_driver_get_trajectory_sampling_time(motor_driver_t *d)
+{
+    if (d->control_mode != MOTOR_CONTROL_MODE_TRAJECTORY) {
+        chSysHalt("motor driver get trajectory wrong setpt mode");
+    }
+    return d->setpt.trajectory->sampling_time_us;
+}
+
+uint32_t motor_driver_get_trajectory_version(motor_driver_t *d)
+{
+    return d->trajectory_version;
+}
+
 void motor_driver_set_stream_value(motor_driver_t *d, uint32_t stream, float value)
 {
 
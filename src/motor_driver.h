@@ -55,6 +55,7 @@ typedef struct {
         float voltage;
         trajectory_t *trajectory;
     } setpt;
+    uint32_t trajectory_version; // incremented on every applied chunk
 
     struct {
         parameter_namespace_t root;
@@ -66,6 +67,9 @@ typedef struct {
         parameter_t velocity_limit;
         parameter_t acceleration_limit;
         parameter_t low_batt_th;
+        parameter_t trajectory_segment_len; // points per segment, 0 sends single points
+        parameter_t setpoint_deadband; // smallest setpoint change sent
+        parameter_t setpoint_keepalive; // [s] repeat period of unchanged setpoints, 0 always sends
 
         parameter_namespace_t thermal;
         parameter_t thermal_capacity;
@@ -134,6 +138,9 @@ void motor_driver_disable(motor_driver_t *d);
 int motor_driver_get_can_id(motor_driver_t *d);
 void motor_driver_set_can_id(motor_driver_t *d, int can_id);
 
+// time between two setpoint transmissions for the current control mode [s]
+float motor_driver_get_update_period(motor_driver_t *d);
+
 void motor_driver_lock(motor_driver_t *d);
 void motor_driver_unlock(motor_driver_t *d);
 
@@ -151,6 +158,18 @@ void motor_driver_get_trajectory_point(motor_driver_t *d,
                                        float *velocity,
                                        float *acceleration,
                                        float *torque);
+// copies up to max_points upcoming points of the trajectory, starting at the
+// sample at or before from_us, without consuming them.
+// points must hold 4 * max_points floats ([position, velocity, acceleration,
+// torque] each), start_us is set to the time of the first point.
+// returns the number of points copied
+int motor_driver_get_trajectory_segment(motor_driver_t *d,
+                                        int64_t from_us,
+                                        int max_points,
+                                        float *points,
+                                        int64_t *start_us);
+int64_t motor_driver_get_trajectory_sampling_time(motor_driver_t *d);
+uint32_t motor_driver_get_trajectory_version(motor_driver_t *d);
 
 void motor_driver_set_stream_value(motor_driver_t *d, uint32_t stream, float value);
 uint32_t motor_driver_get_stream_change_status(motor_driver_t *d);
@@ -1,4 +1,3 @@
-
 #include <uavcan/uavcan.hpp>
 #include <uavcan/protocol/NodeStatus.hpp>
 #include <cvra/motor/config/VelocityPID.hpp>
@@ -12,20 +11,48 @@
 #include <cvra/motor/control/Torque.hpp>
 #include <cvra/motor/control/Voltage.hpp>
 #include <cvra/motor/control/Trajectory.hpp>
+#include <cvra/TrajectorySegment.hpp>
 #include "uavcan_node.h"
 #include "motor_driver.h"
 #include "motor_driver_uavcan.h"
 #include "uavcan_node_private.hpp"
 #include "timestamp/timestamp.h"
+#include "setpoint_filter.h"
+#include "config_queue.h"
+#include "can_capture.h"
+#include "log.h"
 
 using namespace uavcan_node;
 
-void speed_pid_client_cb(const uavcan::ServiceCallResult<cvra::motor::config::VelocityPID>& call_result);
-void position_pid_client_cb(const uavcan::ServiceCallResult<cvra::motor::config::PositionPID>& call_result);
-void current_pid_client_cb(const uavcan::ServiceCallResult<cvra::motor::config::CurrentPID>& call_result);
-void config_client_cb(const uavcan::ServiceCallResult<cvra::motor::config::LoadConfiguration>& call_result);
-void enable_client_cb(const uavcan::ServiceCallResult<cvra::motor::config::EnableMotor>& call_result);
-void feedback_stream_pub_cb(const uavcan::ServiceCallResult<cvra::motor::config::FeedbackStream>& call_result);
+/* Service calls in progress on the whole bus, so that a config change on
+ * all actuators does not flood it. */
+#define CONFIG_MAX_CALLS_IN_FLIGHT  4
+
+#define NB_FEEDBACK_STREAMS         7
+
+/* Items of the per-node config queue, sent lowest bit first. EnableMotor
+ * comes first so that a disable does not wait behind other config. A
+ * LoadConfiguration contains the PIDs, so it makes pending PID calls
+ * redundant. */
+#define CONFIG_ITEM_ENABLE          (1 << 0)
+#define CONFIG_ITEM_FULL            (1 << 1)
+#define CONFIG_ITEM_POSITION_PID    (1 << 2)
+#define CONFIG_ITEM_VELOCITY_PID    (1 << 3)
+#define CONFIG_ITEM_CURRENT_PID     (1 << 4)
+#define CONFIG_ITEM_STREAM(i)       (1 << (5 + (i)))
+#define CONFIG_ITEM_ALL_STREAMS     (((1 << NB_FEEDBACK_STREAMS) - 1) << 5)
+
+static const uint8_t feedback_streams[NB_FEEDBACK_STREAMS] = {
+    cvra::motor::config::FeedbackStream::Request::STREAM_CURRENT_PID,
+    cvra::motor::config::FeedbackStream::Request::STREAM_VELOCITY_PID,
+    cvra::motor::config::FeedbackStream::Request::STREAM_POSITION_PID,
+    cvra::motor::config::FeedbackStream::Request::STREAM_INDEX,
+    cvra::motor::config::FeedbackStream::Request::STREAM_MOTOR_ENCODER,
+    cvra::motor::config::FeedbackStream::Request::STREAM_MOTOR_POSITION,
+    cvra::motor::config::FeedbackStream::Request::STREAM_MOTOR_TORQUE,
+};
+
+static int config_calls_in_flight = 0;
 
 struct can_driver_s {
     uavcan::ServiceClient<cvra::motor::config::VelocityPID> speed_pid_client;
@@ -39,8 +66,44 @@ struct can_driver_s {
     uavcan::Publisher<cvra::motor::control::Torque> torque_pub;
     uavcan::Publisher<cvra::motor::control::Voltage> voltage_pub;
     uavcan::Publisher<cvra::motor::control::Trajectory> trajectory_pub;
+    uavcan::Publisher<cvra::TrajectorySegment> trajectory_segment_pub;
     bool enabled; // state of the motor board
-    timestamp_t last_setpoint_update;
+    int segment_len; // trajectory points per segment, 0 if disabled
+    uint32_t segment_version; // trajectory version of the last segment sent
+    int64_t segment_end_us; // time of the last point sent
+    float stream_scale; // stream frequencies are divided by it to limit bus load
+    setpoint_filter_t setpoint_filter;
+    float setpoint_deadband;
+    uint32_t setpoint_keepalive_us;
+    uint32_t first_setpoint_ms; // time since boot, 0 until a setpoint was sent
+
+    // config waiting to be sent, as read from the parameters when they changed
+    config_queue_t config_queue;
+    cvra::motor::config::LoadConfiguration::Request config_msg;
+    cvra::motor::config::PositionPID::Request position_pid_msg;
+    cvra::motor::config::VelocityPID::Request velocity_pid_msg;
+    cvra::motor::config::CurrentPID::Request current_pid_msg;
+    float stream_frequency[NB_FEEDBACK_STREAMS];
+
+    template <typename DataType>
+    void call_done(const uavcan::ServiceCallResult<DataType>& call_result)
+    {
+        if (config_queue.in_flight == 0) {
+            return;
+        }
+        if (!call_result.isSuccessful()) {
+            log_message("config call to node %d failed, retrying",
+                        call_result.getCallID().server_node_id.get());
+            can_capture_trigger(CAN_RECORDER_TRIGGER_SERVICE_TIMEOUT);
+        }
+        // setpoints sent before the board was enabled were ignored
+        if (config_queue.in_flight == CONFIG_ITEM_ENABLE && call_result.isSuccessful()) {
+            setpoint_filter.valid = false;
+        }
+        config_queue_complete(&config_queue, call_result.isSuccessful(), timestamp_get());
+        config_calls_in_flight--;
+    }
+
     can_driver_s():
         speed_pid_client(getNode()),
         position_pid_client(getNode()),
@@ -52,26 +115,83 @@ struct can_driver_s {
         position_pub(getNode()),
         torque_pub(getNode()),
         voltage_pub(getNode()),
-        trajectory_pub(getNode())
+        trajectory_pub(getNode()),
+        trajectory_segment_pub(getNode())
     {
         speed_pid_client.init();
-        speed_pid_client.setCallback(speed_pid_client_cb);
+        speed_pid_client.setCallback(
+            [this](const uavcan::ServiceCallResult<cvra::motor::config::VelocityPID>& r) { call_done(r); });
         position_pid_client.init();
-        position_pid_client.setCallback(position_pid_client_cb);
+        position_pid_client.setCallback(
+            [this](const uavcan::ServiceCallResult<cvra::motor::config::PositionPID>& r) { call_done(r); });
         current_pid_client.init();
-        current_pid_client.setCallback(current_pid_client_cb);
+        current_pid_client.setCallback(
+            [this](const uavcan::ServiceCallResult<cvra::motor::config::CurrentPID>& r) { call_done(r); });
         config_client.init();
-        config_client.setCallback(config_client_cb);
+        config_client.setCallback(
+            [this](const uavcan::ServiceCallResult<cvra::motor::config::LoadConfiguration>& r) { call_done(r); });
         enable_client.init();
-        enable_client.setCallback(enable_client_cb);
+        enable_client.setCallback(
+            [this](const uavcan::ServiceCallResult<cvra::motor::config::EnableMotor>& r) { call_done(r); });
         feedback_stream_pub.init();
-        feedback_stream_pub.setCallback(feedback_stream_pub_cb);
+        feedback_stream_pub.setCallback(
+            [this](const uavcan::ServiceCallResult<cvra::motor::config::FeedbackStream>& r) { call_done(r); });
+
+        // setpoints go before config, see can_priority.h
+        velocity_pub.setPriority(transferPriority(CAN_PRIORITY_SETPOINT));
+        position_pub.setPriority(transferPriority(CAN_PRIORITY_SETPOINT));
+        torque_pub.setPriority(transferPriority(CAN_PRIORITY_SETPOINT));
+        voltage_pub.setPriority(transferPriority(CAN_PRIORITY_SETPOINT));
+        trajectory_pub.setPriority(transferPriority(CAN_PRIORITY_SETPOINT));
+        trajectory_segment_pub.setPriority(transferPriority(CAN_PRIORITY_SETPOINT));
+        enable_client.setPriority(transferPriority(CAN_PRIORITY_FEEDBACK_CONFIG));
+        feedback_stream_pub.setPriority(transferPriority(CAN_PRIORITY_FEEDBACK_CONFIG));
+        speed_pid_client.setPriority(transferPriority(CAN_PRIORITY_BULK_CONFIG));
+        position_pid_client.setPriority(transferPriority(CAN_PRIORITY_BULK_CONFIG));
+        current_pid_client.setPriority(transferPriority(CAN_PRIORITY_BULK_CONFIG));
+        config_client.setPriority(transferPriority(CAN_PRIORITY_BULK_CONFIG));
+
         enabled = false;
-        last_setpoint_update = timestamp_get();
+        segment_len = 0;
+        segment_version = 0;
+        segment_end_us = 0;
+        stream_scale = 1;
+        setpoint_filter_init(&setpoint_filter);
+        setpoint_deadband = 0;
+        setpoint_keepalive_us = 0;
+        first_setpoint_ms = 0;
+        config_queue_init(&config_queue, CONFIG_ITEM_FULL,
+                          CONFIG_ITEM_POSITION_PID | CONFIG_ITEM_VELOCITY_PID | CONFIG_ITEM_CURRENT_PID);
+        for (int i = 0; i < NB_FEEDBACK_STREAMS; i++) {
+            stream_frequency[i] = 0;
+        }
     }
 };
 
 
+/* Hands a transfer to the node, accounting for it in its priority class. */
+template <typename Publisher, typename Message>
+static int broadcast(can_priority_class_t c, Publisher& pub, const Message& msg)
+{
+    transferSubmitted(c);
+    int res = pub.broadcast(msg);
+    if (res < 0) {
+        transferCancelled(c);
+    }
+    return res;
+}
+
+template <typename Client, typename Request>
+static int call(can_priority_class_t c, Client& client, int node_id, const Request& request)
+{
+    transferSubmitted(c);
+    int res = client.call(node_id, request);
+    if (res < 0) {
+        transferCancelled(c);
+    }
+    return res;
+}
+
 static void driver_allocation(motor_driver_t *d)
 {
     if (d->can_driver == NULL) {
@@ -95,47 +215,36 @@ static void update_motor_can_id(motor_driver_t *d)
     }
 }
 
-static void send_stream_config(struct can_driver_s *can_drv, int node_id, uint8_t stream, float frequency)
+static parameter_t *stream_parameter(motor_driver_t *d, int stream_index)
 {
-    cvra::motor::config::FeedbackStream::Request feedback_stream_config;
-
-    feedback_stream_config.stream = stream;
-    if (frequency == 0) {
-        feedback_stream_config.enabled = false;
-    } else {
-        feedback_stream_config.enabled = true;
-    }
-    feedback_stream_config.frequency = frequency;
-
-   can_drv->feedback_stream_pub.call(node_id, feedback_stream_config);
+    parameter_t *streams[NB_FEEDBACK_STREAMS] = {
+        &d->config.current_pid_stream,
+        &d->config.velocity_pid_stream,
+        &d->config.position_pid_stream,
+        &d->config.index_stream,
+        &d->config.encoder_pos_stream,
+        &d->config.motor_pos_stream,
+        &d->config.motor_torque_stream,
+    };
+    return streams[stream_index];
 }
 
-
-extern "C"
-void motor_driver_send_initial_config(motor_driver_t *d)
+template <typename PIDMessage>
+static void read_pid(struct pid_parameter_s *pid, PIDMessage &msg)
 {
-    cvra::motor::config::LoadConfiguration::Request config_msg;
+    msg.kp = parameter_scalar_get(&pid->kp);
+    msg.ki = parameter_scalar_get(&pid->ki);
+    msg.kd = parameter_scalar_get(&pid->kd);
+    msg.ilimit = parameter_scalar_get(&pid->ilimit);
+}
 
-    update_motor_can_id(d);
-    int node_id = motor_driver_get_can_id(d);
-    if (node_id == CAN_ID_NOT_SET) {
-        return;
-    }
-    driver_allocation(d);
-    struct can_driver_s *can_drv = (struct can_driver_s*)d->can_driver;
+static void read_full_config(motor_driver_t *d, struct can_driver_s *can_drv)
+{
+    cvra::motor::config::LoadConfiguration::Request &config_msg = can_drv->config_msg;
 
-    config_msg.position_pid.kp = parameter_scalar_get(&d->config.position_pid.kp);
-    config_msg.position_pid.ki = parameter_scalar_get(&d->config.position_pid.ki);
-    config_msg.position_pid.kd = parameter_scalar_get(&d->config.position_pid.kd);
-    config_msg.position_pid.ilimit = parameter_scalar_get(&d->config.position_pid.ilimit);
-    config_msg.velocity_pid.kp = parameter_scalar_get(&d->config.velocity_pid.kp);
-    config_msg.velocity_pid.ki = parameter_scalar_get(&d->config.velocity_pid.ki);
-    config_msg.velocity_pid.kd = parameter_scalar_get(&d->config.velocity_pid.kd);
-    config_msg.velocity_pid.ilimit = parameter_scalar_get(&d->config.velocity_pid.ilimit);
-    config_msg.current_pid.kp = parameter_scalar_get(&d->config.current_pid.kp);
-    config_msg.current_pid.ki = parameter_scalar_get(&d->config.current_pid.ki);
-    config_msg.current_pid.kd = parameter_scalar_get(&d->config.current_pid.kd);
-    config_msg.current_pid.ilimit = parameter_scalar_get(&d->config.current_pid.ilimit);
+    read_pid(&d->config.position_pid, config_msg.position_pid);
+    read_pid(&d->config.velocity_pid, config_msg.velocity_pid);
+    read_pid(&d->config.current_pid, config_msg.current_pid);
 
     config_msg.torque_limit = parameter_scalar_get(&d->config.torque_limit);
     config_msg.velocity_limit = parameter_scalar_get(&d->config.velocity_limit);
@@ -156,10 +265,76 @@ void motor_driver_send_initial_config(motor_driver_t *d)
 
     config_msg.mode = parameter_integer_get(&d->config.mode); // todo !
 
-    can_drv->config_client.call(node_id, config_msg);
+    can_drv->segment_len = parameter_integer_get(&d->config.trajectory_segment_len);
+    can_drv->setpoint_deadband = parameter_scalar_get(&d->config.setpoint_deadband);
+    can_drv->setpoint_keepalive_us = parameter_scalar_get(&d->config.setpoint_keepalive) * 1e6f;
+}
+
+static int send_config_item(struct can_driver_s *can_drv, int node_id, uint32_t item)
+{
+    if (item == CONFIG_ITEM_FULL) {
+        return call(CAN_PRIORITY_BULK_CONFIG, can_drv->config_client, node_id, can_drv->config_msg);
+    } else if (item == CONFIG_ITEM_POSITION_PID) {
+        return call(CAN_PRIORITY_BULK_CONFIG, can_drv->position_pid_client, node_id, can_drv->position_pid_msg);
+    } else if (item == CONFIG_ITEM_VELOCITY_PID) {
+        return call(CAN_PRIORITY_BULK_CONFIG, can_drv->speed_pid_client, node_id, can_drv->velocity_pid_msg);
+    } else if (item == CONFIG_ITEM_CURRENT_PID) {
+        return call(CAN_PRIORITY_BULK_CONFIG, can_drv->current_pid_client, node_id, can_drv->current_pid_msg);
+    } else if (item == CONFIG_ITEM_ENABLE) {
+        cvra::motor::config::EnableMotor::Request enable_msg;
+        enable_msg.enable = can_drv->enabled;
+        return call(CAN_PRIORITY_FEEDBACK_CONFIG, can_drv->enable_client, node_id, enable_msg);
+    }
+
+    for (int i = 0; i < NB_FEEDBACK_STREAMS; i++) {
+        if (item == CONFIG_ITEM_STREAM(i)) {
+            cvra::motor::config::FeedbackStream::Request feedback_stream_config;
+            float frequency = can_drv->stream_frequency[i];
+            feedback_stream_config.stream = feedback_streams[i];
+            feedback_stream_config.enabled = frequency != 0;
+            feedback_stream_config.frequency = frequency / can_drv->stream_scale;
+            return call(CAN_PRIORITY_FEEDBACK_CONFIG, can_drv->feedback_stream_pub, node_id,
+                        feedback_stream_config);
+        }
+    }
+    return -1;
+}
+
+
+extern "C"
+void motor_driver_send_initial_config(motor_driver_t *d)
+{
+    update_motor_can_id(d);
+    int node_id = motor_driver_get_can_id(d);
+    if (node_id == CAN_ID_NOT_SET) {
+        return;
+    }
+    driver_allocation(d);
+    struct can_driver_s *can_drv = (struct can_driver_s*)d->can_driver;
+
+    read_full_config(d, can_drv);
+    config_queue_request(&can_drv->config_queue, CONFIG_ITEM_FULL);
 
     can_drv->enabled = false;
+    // the board may have been replaced, it needs the current setpoint
+    can_drv->setpoint_filter.valid = false;
+}
+
+extern "C"
+void motor_driver_uavcan_node_rebooted(motor_driver_t *d)
+{
+    motor_driver_send_initial_config(d);
+    if (d->can_driver == NULL) {
+        return;
+    }
+    struct can_driver_s *can_drv = (struct can_driver_s*)d->can_driver;
 
+    for (int i = 0; i < NB_FEEDBACK_STREAMS; i++) {
+        if (can_drv->stream_frequency[i] != 0) {
+            config_queue_request(&can_drv->config_queue, CONFIG_ITEM_STREAM(i));
+        }
+    }
+    can_drv->segment_version = 0;
 }
 
 extern "C"
@@ -174,104 +349,207 @@ void motor_driver_uavcan_update_config(motor_driver_t *d)
     driver_allocation(d);
     struct can_driver_s *can_drv = (struct can_driver_s*)d->can_driver;
 
+    /* The gains also go in the full config, which drops the PID calls when
+     * it is pending or retried, see config_queue.h. */
     if (parameter_namespace_contains_changed(&d->config.control)) {
         if (parameter_namespace_contains_changed(&d->config.position_pid.root)) {
-            cvra::motor::config::PositionPID::Request request;
-            request.pid.kp = parameter_scalar_get(&d->config.position_pid.kp);
-            request.pid.ki = parameter_scalar_get(&d->config.position_pid.ki);
-            request.pid.kd = parameter_scalar_get(&d->config.position_pid.kd);
-            request.pid.ilimit = parameter_scalar_get(&d->config.position_pid.ilimit);
-
-            can_drv->position_pid_client.call(node_id, request);
+            read_pid(&d->config.position_pid, can_drv->position_pid_msg.pid);
+            read_pid(&d->config.position_pid, can_drv->config_msg.position_pid);
+            config_queue_request(&can_drv->config_queue, CONFIG_ITEM_POSITION_PID);
         }
 
         if (parameter_namespace_contains_changed(&d->config.velocity_pid.root)) {
-            cvra::motor::config::VelocityPID::Request request;
-            request.pid.kp = parameter_scalar_get(&d->config.velocity_pid.kp);
-            request.pid.ki = parameter_scalar_get(&d->config.velocity_pid.ki);
-            request.pid.kd = parameter_scalar_get(&d->config.velocity_pid.kd);
-            request.pid.ilimit = parameter_scalar_get(&d->config.velocity_pid.ilimit);
-
-            can_drv->speed_pid_client.call(node_id, request);
+            read_pid(&d->config.velocity_pid, can_drv->velocity_pid_msg.pid);
+            read_pid(&d->config.velocity_pid, can_drv->config_msg.velocity_pid);
+            config_queue_request(&can_drv->config_queue, CONFIG_ITEM_VELOCITY_PID);
         }
 
         if (parameter_namespace_contains_changed(&d->config.current_pid.root)) {
-            cvra::motor::config::CurrentPID::Request request;
-            request.pid.kp = parameter_scalar_get(&d->config.current_pid.kp);
-            request.pid.ki = parameter_scalar_get(&d->config.current_pid.ki);
-            request.pid.kd = parameter_scalar_get(&d->config.current_pid.kd);
-            request.pid.ilimit = parameter_scalar_get(&d->config.current_pid.ilimit);
-
-            can_drv->current_pid_client.call(node_id, request);
+            read_pid(&d->config.current_pid, can_drv->current_pid_msg.pid);
+            read_pid(&d->config.current_pid, can_drv->config_msg.current_pid);
+            config_queue_request(&can_drv->config_queue, CONFIG_ITEM_CURRENT_PID);
         }
     }
     if (parameter_namespace_contains_changed(&d->config.stream)) {
-        if (parameter_changed(&d->config.current_pid_stream)) {
-            send_stream_config(can_drv,
-                               node_id,
-                               cvra::motor::config::FeedbackStream::Request::STREAM_CURRENT_PID,
-                               parameter_scalar_get(&d->config.current_pid_stream));
-        }
-        if (parameter_changed(&d->config.velocity_pid_stream)) {
-            send_stream_config(can_drv,
-                               node_id,
-                               cvra::motor::config::FeedbackStream::Request::STREAM_VELOCITY_PID,
-                               parameter_scalar_get(&d->config.velocity_pid_stream));
-        }
-        if (parameter_changed(&d->config.position_pid_stream)) {
-            send_stream_config(can_drv,
-                               node_id,
-                               cvra::motor::config::FeedbackStream::Request::STREAM_POSITION_PID,
-                               parameter_scalar_get(&d->config.position_pid_stream));
-        }
-        if (parameter_changed(&d->config.index_stream)) {
-            send_stream_config(can_drv,
-                               node_id,
-                               cvra::motor::config::FeedbackStream::Request::STREAM_INDEX,
-                               parameter_scalar_get(&d->config.index_stream));
-        }
-        if (parameter_changed(&d->config.encoder_pos_stream)) {
-            send_stream_config(can_drv,
-                               node_id,
-                               cvra::motor::config::FeedbackStream::Request::STREAM_MOTOR_ENCODER,
-                               parameter_scalar_get(&d->config.encoder_pos_stream));
-        }
-        if (parameter_changed(&d->config.motor_pos_stream)) {
-            send_stream_config(can_drv,
-                               node_id,
-                               cvra::motor::config::FeedbackStream::Request::STREAM_MOTOR_POSITION,
-                               parameter_scalar_get(&d->config.motor_pos_stream));
-        }
-        if (parameter_changed(&d->config.motor_torque_stream)) {
-            send_stream_config(can_drv,
-                               node_id,
-                               cvra::motor::config::FeedbackStream::Request::STREAM_MOTOR_TORQUE,
-                               parameter_scalar_get(&d->config.motor_torque_stream));
+        for (int i = 0; i < NB_FEEDBACK_STREAMS; i++) {
+            if (parameter_changed(stream_parameter(d, i))) {
+                can_drv->stream_frequency[i] = parameter_scalar_get(stream_parameter(d, i));
+                config_queue_request(&can_drv->config_queue, CONFIG_ITEM_STREAM(i));
+            }
         }
     }
+    if (parameter_changed(&d->config.trajectory_segment_len)) {
+        can_drv->segment_len = parameter_integer_get(&d->config.trajectory_segment_len);
+        can_drv->segment_version = 0;
+    }
+    if (parameter_changed(&d->config.setpoint_deadband)) {
+        can_drv->setpoint_deadband = parameter_scalar_get(&d->config.setpoint_deadband);
+    }
+    if (parameter_changed(&d->config.setpoint_keepalive)) {
+        can_drv->setpoint_keepalive_us = parameter_scalar_get(&d->config.setpoint_keepalive) * 1e6f;
+    }
     if (parameter_namespace_contains_changed(&d->config.root)) {
         // still some changed parameters: need to resend full config
         motor_driver_send_initial_config(d);
     }
 }
 
-void motor_enable(can_driver_s *d, int node_id)
+extern "C"
+void motor_driver_uavcan_process_config(motor_driver_t *d)
+{
+    if (d->can_driver == NULL) {
+        return;
+    }
+    int node_id = motor_driver_get_can_id(d);
+    if (node_id == CAN_ID_NOT_SET) {
+        return;
+    }
+    struct can_driver_s *can_drv = (struct can_driver_s*)d->can_driver;
+
+    // enabling or disabling a motor is not held back by other nodes' config
+    if (config_calls_in_flight >= CONFIG_MAX_CALLS_IN_FLIGHT
+        && !(can_drv->config_queue.pending & CONFIG_ITEM_ENABLE)) {
+        return;
+    }
+
+    uint32_t item = config_queue_next(&can_drv->config_queue, timestamp_get());
+    if (item == 0) {
+        return;
+    }
+    if (send_config_item(can_drv, node_id, item) < 0) {
+        config_queue_complete(&can_drv->config_queue, false, timestamp_get());
+        return;
+    }
+    config_calls_in_flight++;
+}
+
+extern "C"
+bool motor_driver_uavcan_config_is_done(motor_driver_t *d)
+{
+    if (d->can_driver == NULL || motor_driver_get_can_id(d) == CAN_ID_NOT_SET) {
+        return false;
+    }
+    can_driver_s *can_drv = (can_driver_s*)d->can_driver;
+    return config_queue_is_idle(&can_drv->config_queue);
+}
+
+extern "C"
+void motor_driver_uavcan_get_config_stats(motor_driver_t *d, uint32_t *pending, uint32_t *sent, uint32_t *failed)
+{
+    *pending = 0;
+    *sent = 0;
+    *failed = 0;
+    if (d->can_driver != NULL) {
+        can_driver_s *can_drv = (can_driver_s*)d->can_driver;
+        *pending = can_drv->config_queue.pending | can_drv->config_queue.in_flight;
+        *sent = can_drv->config_queue.sent;
+        *failed = can_drv->config_queue.failed;
+    }
+}
+
+extern "C"
+void motor_driver_uavcan_set_stream_scale(motor_driver_t *d, float scale)
+{
+    update_motor_can_id(d);
+    int node_id = motor_driver_get_can_id(d);
+    if (node_id == CAN_ID_NOT_SET) {
+        return;
+    }
+    driver_allocation(d);
+    struct can_driver_s *can_drv = (struct can_driver_s*)d->can_driver;
+
+    if (scale == can_drv->stream_scale) {
+        return;
+    }
+    can_drv->stream_scale = scale;
+    config_queue_request(&can_drv->config_queue, CONFIG_ITEM_ALL_STREAMS);
+}
+
+void motor_enable(can_driver_s *d)
 {
-    cvra::motor::config::EnableMotor::Request enable_msg;
     if (!d->enabled) {
         d->enabled = true;
-        enable_msg.enable = true;
-        d->enable_client.call(node_id, enable_msg);
+        config_queue_request(&d->config_queue, CONFIG_ITEM_ENABLE);
     }
 }
 
-void motor_disable(can_driver_s *d, int node_id)
+void motor_disable(can_driver_s *d)
 {
-    cvra::motor::config::EnableMotor::Request enable_msg;
     if (d->enabled) {
         d->enabled = false;
-        enable_msg.enable = false;
-        d->enable_client.call(node_id, enable_msg);
+        config_queue_request_urgent(&d->config_queue, CONFIG_ITEM_ENABLE);
+    }
+}
+
+/* Sends the upcoming points of the trajectory in a single transfer, once half
+ * of the previous segment is consumed or when a new chunk was applied. */
+static void send_trajectory_segment(motor_driver_t *d, can_driver_s *can_drv, int node_id)
+{
+    cvra::TrajectorySegment segment;
+    float points[cvra::TrajectorySegment::FieldTypes::position::MaxSize][4];
+    int max_points = can_drv->segment_len;
+    if (max_points > (int)cvra::TrajectorySegment::FieldTypes::position::MaxSize) {
+        max_points = cvra::TrajectorySegment::FieldTypes::position::MaxSize;
+    }
+
+    int64_t now = timestamp_get();
+    int64_t dt = motor_driver_get_trajectory_sampling_time(d);
+    uint32_t version = motor_driver_get_trajectory_version(d);
+
+    /* Only advance the read pointer, the board interpolates by itself. */
+    float position, velocity, acceleration, torque;
+    motor_driver_get_trajectory_point(d, now, &position, &velocity, &acceleration, &torque);
+
+    int64_t from_us;
+    if (version != can_drv->segment_version || can_drv->segment_end_us < now) {
+        from_us = now;
+    } else if (now + max_points * dt / 2 >= can_drv->segment_end_us) {
+        /* Overlap by one point so the board interpolates across segments. */
+        from_us = can_drv->segment_end_us;
+    } else {
+        return;
+    }
+
+    int64_t start_us;
+    int n = motor_driver_get_trajectory_segment(d, from_us, max_points, &points[0][0], &start_us);
+    if (n == 0) {
+        return;
+    }
+
+    uavcan::UtcTime start = getSystemClock().getUtc() + uavcan::UtcDuration::fromUSec(start_us - now);
+    segment.node_id = node_id;
+    segment.start.usec = start.toUSec();
+    segment.delta_t = dt;
+    for (int i = 0; i < n; i++) {
+        segment.position.push_back(points[i][0]);
+        segment.velocity.push_back(points[i][1]);
+        segment.torque.push_back(points[i][3]);
+    }
+    broadcast(CAN_PRIORITY_SETPOINT, can_drv->trajectory_segment_pub, segment);
+
+    can_drv->segment_version = version;
+    can_drv->segment_end_us = start_us + (n - 1) * dt;
+}
+
+/* Returns false if the setpoint did not change enough to be worth a frame,
+ * see setpoint_filter.h. Mode changes and keepalives always go through. */
+static bool setpoint_changed(can_driver_s *can_drv, int mode, float value)
+{
+    return setpoint_filter_should_send(&can_drv->setpoint_filter, mode, value,
+                                       timestamp_get(),
+                                       can_drv->setpoint_deadband,
+                                       can_drv->setpoint_keepalive_us);
+}
+
+extern "C"
+void motor_driver_uavcan_get_setpoint_stats(motor_driver_t *d, uint32_t *sent, uint32_t *suppressed)
+{
+    *sent = 0;
+    *suppressed = 0;
+    if (d->can_driver != NULL) {
+        can_driver_s *can_drv = (can_driver_s*)d->can_driver;
+        *sent = can_drv->setpoint_filter.sent;
+        *suppressed = can_drv->setpoint_filter.suppressed;
     }
 }
 
@@ -292,43 +570,58 @@ void motor_driver_uavcan_send_setpoint(motor_driver_t *d)
     driver_allocation(d);
     can_driver_s *can_drv = (can_driver_s*)d->can_driver;
 
-    timestamp_t now = timestamp_get();
-    if (timestamp_duration_s(can_drv->last_setpoint_update, now) < d->update_period) {
-        return;
-    }
-
     motor_driver_lock(d);
     switch(d->control_mode) {
         case MOTOR_CONTROL_MODE_VELOCITY: {
-            motor_enable(can_drv, node_id);
+            motor_enable(can_drv);
             velocity_setpoint.velocity = motor_driver_get_velocity_setpt(d);
+            if (!setpoint_changed(can_drv, d->control_mode, velocity_setpoint.velocity)) {
+                break;
+            }
             velocity_setpoint.node_id = node_id;
-            can_drv->velocity_pub.broadcast(velocity_setpoint);
+            broadcast(CAN_PRIORITY_SETPOINT, can_drv->velocity_pub, velocity_setpoint);
         } break;
 
         case MOTOR_CONTROL_MODE_POSITION: {
-            motor_enable(can_drv, node_id);
+            motor_enable(can_drv);
             position_setpoint.position = motor_driver_get_position_setpt(d);
+            if (!setpoint_changed(can_drv, d->control_mode, position_setpoint.position)) {
+                break;
+            }
             position_setpoint.node_id = node_id;
-            can_drv->position_pub.broadcast(position_setpoint);
+            broadcast(CAN_PRIORITY_SETPOINT, can_drv->position_pub, position_setpoint);
         } break;
 
         case MOTOR_CONTROL_MODE_TORQUE: {
-            motor_enable(can_drv, node_id);
+            motor_enable(can_drv);
             torque_setpoint.torque = motor_driver_get_torque_setpt(d);
+            if (!setpoint_changed(can_drv, d->control_mode, torque_setpoint.torque)) {
+                break;
+            }
             torque_setpoint.node_id = node_id;
-            can_drv->torque_pub.broadcast(torque_setpoint);
+            broadcast(CAN_PRIORITY_SETPOINT, can_drv->torque_pub, torque_setpoint);
         } break;
 
         case MOTOR_CONTROL_MODE_VOLTAGE: {
-            motor_enable(can_drv, node_id);
+            motor_enable(can_drv);
             voltage_setpoint.voltage = motor_driver_get_voltage_setpt(d);
+            if (!setpoint_changed(can_drv, d->control_mode, voltage_setpoint.voltage)) {
+                break;
+            }
             voltage_setpoint.node_id = node_id;
-            can_drv->voltage_pub.broadcast(voltage_setpoint);
+            broadcast(CAN_PRIORITY_SETPOINT, can_drv->voltage_pub, voltage_setpoint);
         } break;
 
         case MOTOR_CONTROL_MODE_TRAJECTORY: {
-            motor_enable(can_drv, node_id);
+            motor_enable(can_drv);
+            // not filtered, the next setpoint of another mode must go through
+            can_drv->setpoint_filter.valid = false;
+            // a segment cannot carry a sampling time above 65.535 ms
+            if (can_drv->segment_len > 0
+                && trajectory_segment_sampling_time_ok(motor_driver_get_trajectory_sampling_time(d))) {
+                send_trajectory_segment(d, can_drv, node_id);
+                break;
+            }
             uint64_t timestamp_us = timestamp_get();
             float position, velocity, acceleration, torque;
             motor_driver_get_trajectory_point(d,
@@ -342,60 +635,29 @@ void motor_driver_uavcan_send_setpoint(motor_driver_t *d)
             trajectory_setpoint.acceleration = acceleration;
             trajectory_setpoint.torque = torque;
             trajectory_setpoint.node_id = node_id;
-            can_drv->trajectory_pub.broadcast(trajectory_setpoint);
+            broadcast(CAN_PRIORITY_SETPOINT, can_drv->trajectory_pub, trajectory_setpoint);
         } break;
 
         case MOTOR_CONTROL_MODE_DISABLED: {
-            motor_disable(can_drv, node_id);
+            motor_disable(can_drv);
+            can_drv->setpoint_filter.valid = false;
         } break;
 
         default:
             /* TODO */
             break;
     }
-    can_drv->last_setpoint_update = timestamp_get();
-    motor_driver_unlock(d);
-}
-
-void speed_pid_client_cb(const uavcan::ServiceCallResult<cvra::motor::config::VelocityPID>& call_result)
-{
-    if (!call_result.isSuccessful()) {
-        chSysHalt("uavcan service call timeout");
-    }
-}
-
-void position_pid_client_cb(const uavcan::ServiceCallResult<cvra::motor::config::PositionPID>& call_result)
-{
-    if (!call_result.isSuccessful()) {
-        chSysHalt("uavcan service call timeout");
-    }
-}
-
-void current_pid_client_cb(const uavcan::ServiceCallResult<cvra::motor::config::CurrentPID>& call_result)
-{
-    if (!call_result.isSuccessful()) {
-        chSysHalt("uavcan service call timeout");
-    }
-}
-
-void config_client_cb(const uavcan::ServiceCallResult<cvra::motor::config::LoadConfiguration>& call_result)
-{
-    if (!call_result.isSuccessful()) {
-        chSysHalt("uavcan service call timeout");
-    }
-}
-
-void enable_client_cb(const uavcan::ServiceCallResult<cvra::motor::config::EnableMotor>& call_result)
-{
-    if (!call_result.isSuccessful()) {
-        chSysHalt("uavcan service call timeout");
+    if (d->control_mode != MOTOR_CONTROL_MODE_DISABLED && can_drv->first_setpoint_ms == 0) {
+        can_drv->first_setpoint_ms = timestamp_get() / 1000 + 1;
     }
+    motor_driver_unlock(d);
 }
 
-void feedback_stream_pub_cb(const uavcan::ServiceCallResult<cvra::motor::config::FeedbackStream>& call_result)
+extern "C"
+uint32_t motor_driver_uavcan_get_first_setpoint_time(motor_driver_t *d)
 {
-    if (!call_result.isSuccessful()) {
-        chSysHalt("uavcan service call timeout");
+    if (d->can_driver == NULL) {
+        return 0;
     }
+    return ((can_driver_s*)d->can_driver)->first_setpoint_ms;
 }
-
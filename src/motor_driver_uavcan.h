@@ -9,10 +9,39 @@ extern "C" {
 
 void motor_driver_send_initial_config(motor_driver_t *d);
 
+// queues the whole config again, including the enabled feedback streams,
+// after the board lost it in a reboot
+void motor_driver_uavcan_node_rebooted(motor_driver_t *d);
+
+// queues the parameters which changed since the last call, to be sent by
+// motor_driver_uavcan_process_config
 void motor_driver_uavcan_update_config(motor_driver_t *d);
 
+// sends the next queued config item, if no call to this node is in progress
+// and the bus-wide limit of calls in flight is not reached. Failed calls are
+// retried with a backoff.
+void motor_driver_uavcan_process_config(motor_driver_t *d);
+
+// true once the board was identified and all its config items were sent
+bool motor_driver_uavcan_config_is_done(motor_driver_t *d);
+
+// pending: mask of the config items queued or in flight, sent: calls made,
+// failed: calls which timed out or could not be sent
+void motor_driver_uavcan_get_config_stats(motor_driver_t *d, uint32_t *pending, uint32_t *sent, uint32_t *failed);
+
 void motor_driver_uavcan_send_setpoint(motor_driver_t *d);
 
+// divides the frequencies of the feedback streams by scale, resending the
+// stream configuration if it changed
+void motor_driver_uavcan_set_stream_scale(motor_driver_t *d, float scale);
+
+// number of setpoints sent and suppressed because they did not change
+void motor_driver_uavcan_get_setpoint_stats(motor_driver_t *d, uint32_t *sent, uint32_t *suppressed);
+
+// milliseconds from boot to the first setpoint sent to the board, rounded
+// up, 0 if none was sent yet
+uint32_t motor_driver_uavcan_get_first_setpoint_time(motor_driver_t *d);
+
 
 #ifdef __cplusplus
 }
@@ -14,9 +14,14 @@
 #include "differential_base.h"
 #include "odometry/robot_base.h"
 #include "waypoints.h"
+#include "rpc_dispatch.h"
 
 #define TRAJ_CHUNK_BUFFER_LEN   100
 
+/* Trajectory chunks are decoded into static buffers, and may arrive through
+ * both message servers. */
+static MUTEX_DECL(chunk_buffer_lock);
+
 void message_cb(void *p, cmp_ctx_t *input)
 {
     (void) p;
@@ -134,9 +139,11 @@ void message_actuator_trajectory_callback(void *p, cmp_ctx_t *input)
     if (point_count > TRAJ_CHUNK_BUFFER_LEN) {
         return;
     }
+    chMtxLock(&chunk_buffer_lock);
     for (i = 0; i < point_count; i++) {
         cmp_read_array(input, &point_dimension);
         if (point_dimension != ACTUATOR_TRAJECTORY_POINT_DIMENSION) {
+            chMtxUnlock(&chunk_buffer_lock);
             return;
         }
         for (j = 0; j < ACTUATOR_TRAJECTORY_POINT_DIMENSION; j++) {
@@ -148,10 +155,8 @@ void message_actuator_trajectory_callback(void *p, cmp_ctx_t *input)
     trajectory_chunk_init(&chunk, (float*)chunk_buffer,
                           point_count, ACTUATOR_TRAJECTORY_POINT_DIMENSION,
                           start_time, delta_t);
-
-    log_message("traj chunk start: %d end: %d cur: %d",
-                start_time, start_time + point_count * delta_t, timestamp_get());
     motor_manager_execute_trajecory(&motor_manager, actuator_id, &chunk);
+    chMtxUnlock(&chunk_buffer_lock);
 }
 
 void wheelbase_trajectory_callback(void *p, cmp_ctx_t *input)
@@ -179,9 +184,11 @@ void wheelbase_trajectory_callback(void *p, cmp_ctx_t *input)
     if (point_count > TRAJ_CHUNK_BUFFER_LEN) {
         return;
     }
+    chMtxLock(&chunk_buffer_lock);
     for (i = 0; i < point_count; ++i) {
         cmp_read_array(input, &point_dimension);
         if (point_dimension != DIFF_BASE_TRAJ_POINT_DIM) {
+            chMtxUnlock(&chunk_buffer_lock);
             return;
         }
         for (j = 0; j < point_dimension; ++j) {
@@ -197,6 +204,7 @@ void wheelbase_trajectory_callback(void *p, cmp_ctx_t *input)
     chMtxLock(&diff_base_trajectory_lock);
         int ret = trajectory_apply_chunk(&diff_base_trajectory, &chunk);
     chMtxUnlock(&diff_base_trajectory_lock);
+    chMtxUnlock(&chunk_buffer_lock);
 
     if (ret == 0) {
         palTogglePad(GPIOF, GPIOF_LED_READY);
@@ -236,6 +244,7 @@ void wheelbase_waypoint_callback(void *p, cmp_ctx_t *input)
 
 
 
+/* The position in this array is the numeric method ID, only append. */
 struct message_method_s message_callbacks[] = {
     {.name = "test", .cb = message_cb},
     {.name = "actuator_voltage", .cb = message_actuator_voltage_callback},
@@ -247,4 +256,22 @@ struct message_method_s message_callbacks[] = {
     {.name = "wheelbase_waypoint", .cb = wheelbase_waypoint_callback},
 };
 
+RPC_DISPATCH_CHECK_SIZE(message_callbacks);
+
 int message_callbacks_len = sizeof message_callbacks / sizeof(message_callbacks[0]);
+
+/* Same order as message_callbacks. */
+const msg_class_t message_callbacks_class[] = {
+    MSG_CLASS_OTHER,
+    MSG_CLASS_SETPOINT,
+    MSG_CLASS_SETPOINT,
+    MSG_CLASS_SETPOINT,
+    MSG_CLASS_SETPOINT,
+    MSG_CLASS_TRAJECTORY,
+    MSG_CLASS_TRAJECTORY,
+    MSG_CLASS_OTHER,
+};
+
+_Static_assert(sizeof(message_callbacks_class) / sizeof(message_callbacks_class[0])
+               == sizeof(message_callbacks) / sizeof(message_callbacks[0]),
+               "message_callbacks_class must have one entry per message callback");
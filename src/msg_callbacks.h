@@ -4,7 +4,18 @@
 #include <rpc_callbacks.h>
 #include <simplerpc/message.h>
 
+typedef enum {
+    MSG_CLASS_SETPOINT = 0,
+    MSG_CLASS_TRAJECTORY,
+    MSG_CLASS_OTHER,
+    MSG_CLASS_COUNT,
+} msg_class_t;
+
 extern struct message_method_s message_callbacks[];
 extern int message_callbacks_len;
 
+/* Ingress queue of each entry of message_callbacks. The real-time message
+ * server accepts all of them but MSG_CLASS_OTHER. */
+extern const msg_class_t message_callbacks_class[];
+
 #endif
@@ -0,0 +1,66 @@
+#include "msg_queue.h"
+
+int msg_queue_init(msg_queue_t *q, size_t depth, size_t max_cost, msg_queue_policy_t policy)
+{
+    if (depth == 0 || depth > MSG_QUEUE_MAX_DEPTH) {
+        return -1;
+    }
+
+    q->depth = depth;
+    q->head = 0;
+    q->count = 0;
+    q->max_cost = max_cost;
+    q->cost = 0;
+    q->policy = policy;
+    q->received = 0;
+    q->dropped = 0;
+
+    return 0;
+}
+
+bool msg_queue_push(msg_queue_t *q, void *item, size_t cost, void **dropped)
+{
+    bool full = q->count == q->depth;
+    size_t evicted_cost = 0;
+
+    *dropped = NULL;
+    q->received++;
+
+    if (full && q->policy == MSG_QUEUE_DROP_OLDEST) {
+        evicted_cost = q->costs[q->head];
+    }
+    if ((full && q->policy == MSG_QUEUE_REJECT)
+        || q->cost - evicted_cost + cost > q->max_cost) {
+        q->dropped++;
+        *dropped = item;
+        return false;
+    }
+
+    if (full) {
+        q->dropped++;
+        *dropped = msg_queue_pop(q);
+    }
+
+    q->items[(q->head + q->count) % q->depth] = item;
+    q->costs[(q->head + q->count) % q->depth] = cost;
+    q->count++;
+    q->cost += cost;
+
+    return true;
+}
+
+void *msg_queue_pop(msg_queue_t *q)
+{
+    void *item;
+
+    if (q->count == 0) {
+        return NULL;
+    }
+
+    item = q->items[q->head];
+    q->cost -= q->costs[q->head];
+    q->head = (q->head + 1) % q->depth;
+    q->count--;
+
+    return item;
+}
@@ -0,0 +1,75 @@
+#ifndef MSG_QUEUE_H
+#define MSG_QUEUE_H
+
+/*
+
+# Message queue
+
+Bounded FIFO of pointers with a policy for when it is full. Used to buffer
+incoming datagrams per message class, so that a burst of one class cannot
+starve the others or exhaust the network buffers.
+
+Besides the number of items, the queue bounds the sum of their costs, for
+example the network buffers each datagram holds. An item which does not
+fit that bound is refused whatever the policy, so that one large item
+cannot flush the queue.
+
+The queue does no locking and does not own the items: every item which is
+rejected or evicted is handed back to the caller to be freed.
+
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define MSG_QUEUE_MAX_DEPTH 8
+
+typedef enum {
+    MSG_QUEUE_DROP_OLDEST, /**< Evict the oldest item to make room. */
+    MSG_QUEUE_REJECT,      /**< Refuse the new item. */
+} msg_queue_policy_t;
+
+typedef struct {
+    void *items[MSG_QUEUE_MAX_DEPTH];
+    size_t costs[MSG_QUEUE_MAX_DEPTH];
+    size_t depth;
+    size_t head;
+    size_t count;
+    size_t max_cost;
+    size_t cost;    /**< Sum of the costs of the queued items. */
+    msg_queue_policy_t policy;
+    uint32_t received;
+    uint32_t dropped;
+} msg_queue_t;
+
+/** Initializes an empty queue.
+ *
+ * @param max_cost Bound on the sum of the costs of the queued items.
+ * @return 0 on success, -1 if depth is zero or above MSG_QUEUE_MAX_DEPTH.
+ */
+int msg_queue_init(msg_queue_t *q, size_t depth, size_t max_cost, msg_queue_policy_t policy);
+
+/** Appends an item to the queue.
+ *
+ * @param cost What the item accounts for in max_cost.
+ * @param [out] dropped Set to the item which was dropped because the queue
+ * was full (the oldest one or item itself, depending on the policy), NULL
+ * otherwise.
+ *
+ * @return true if item was queued.
+ */
+bool msg_queue_push(msg_queue_t *q, void *item, size_t cost, void **dropped);
+
+/** @return The oldest item or NULL if the queue is empty. */
+void *msg_queue_pop(msg_queue_t *q);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MSG_QUEUE_H */
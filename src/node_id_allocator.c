@@ -0,0 +1,196 @@
+#include <string.h>
+#include "node_id_allocator.h"
+
+static bool is_online(const node_id_allocator_t *a, uint8_t node_id)
+{
+    return a->online[node_id / 32] & (1u << (node_id % 32));
+}
+
+static int index_by_unique_id(const node_id_allocator_t *a, const uint8_t *unique_id)
+{
+    int i;
+    for (i = 0; i < a->nb_allocations; i++) {
+        if (memcmp(a->table[i].unique_id, unique_id, NODE_ID_ALLOCATOR_UNIQUE_ID_LEN) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static int index_by_node_id(const node_id_allocator_t *a, uint8_t node_id)
+{
+    int i;
+    for (i = 0; i < a->nb_allocations; i++) {
+        if (a->table[i].node_id == node_id) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static bool is_free(const node_id_allocator_t *a, uint8_t node_id)
+{
+    return !is_online(a, node_id) && index_by_node_id(a, node_id) < 0;
+}
+
+/* Takes the preferred node ID if possible, else the closest free one above
+ * it, else the closest free one below it. */
+static uint8_t find_free_node_id(const node_id_allocator_t *a, uint8_t preferred)
+{
+    int id;
+    if (preferred == NODE_ID_ALLOCATOR_NONE || preferred > NODE_ID_ALLOCATOR_MAX_NODE_ID) {
+        preferred = NODE_ID_ALLOCATOR_MAX_NODE_ID;
+    }
+    for (id = preferred; id <= NODE_ID_ALLOCATOR_MAX_NODE_ID; id++) {
+        if (is_free(a, id)) {
+            return id;
+        }
+    }
+    for (id = preferred - 1; id > 0; id--) {
+        if (is_free(a, id)) {
+            return id;
+        }
+    }
+    return NODE_ID_ALLOCATOR_NONE;
+}
+
+static void remove_entry(node_id_allocator_t *a, int index)
+{
+    memmove(&a->table[index], &a->table[index + 1],
+            (a->nb_allocations - index - 1) * sizeof(node_id_allocation_t));
+    a->nb_allocations--;
+}
+
+static void set_entry(node_id_allocator_t *a, const uint8_t *unique_id, uint8_t node_id)
+{
+    int index = index_by_unique_id(a, unique_id);
+    if (index < 0) {
+        if (a->nb_allocations == a->table_len) {
+            return;
+        }
+        index = a->nb_allocations++;
+        memcpy(a->table[index].unique_id, unique_id, NODE_ID_ALLOCATOR_UNIQUE_ID_LEN);
+    }
+    a->table[index].node_id = node_id;
+}
+
+void node_id_allocator_init(node_id_allocator_t *a,
+                            node_id_allocation_t *table, uint16_t table_len,
+                            uint8_t own_node_id,
+                            node_id_allocator_persist_t persist, void *persist_arg)
+{
+    memset(a, 0, sizeof(node_id_allocator_t));
+    a->table = table;
+    a->table_len = table_len;
+    a->persist = persist;
+    a->persist_arg = persist_arg;
+    node_id_allocator_node_seen(a, own_node_id);
+}
+
+void node_id_allocator_restore(node_id_allocator_t *a, const uint8_t *unique_id, uint8_t node_id)
+{
+    if (node_id == NODE_ID_ALLOCATOR_NONE) {
+        int index = index_by_unique_id(a, unique_id);
+        if (index >= 0) {
+            remove_entry(a, index);
+        }
+        return;
+    }
+
+    // the newest allocation of a node ID wins
+    int index = index_by_node_id(a, node_id);
+    if (index >= 0) {
+        remove_entry(a, index);
+    }
+    set_entry(a, unique_id, node_id);
+}
+
+void node_id_allocator_node_seen(node_id_allocator_t *a, uint8_t node_id)
+{
+    if (node_id <= NODE_ID_ALLOCATOR_MAX_NODE_ID) {
+        a->online[node_id / 32] |= 1u << (node_id % 32);
+    }
+}
+
+static uint8_t allocate(node_id_allocator_t *a, const uint8_t *unique_id, uint8_t preferred)
+{
+    uint8_t node_id = node_id_allocator_get_node_id(a, unique_id);
+    if (node_id != NODE_ID_ALLOCATOR_NONE) {
+        return node_id;
+    }
+    if (a->nb_allocations == a->table_len) {
+        return NODE_ID_ALLOCATOR_NONE;
+    }
+    node_id = find_free_node_id(a, preferred);
+    if (node_id != NODE_ID_ALLOCATOR_NONE) {
+        set_entry(a, unique_id, node_id);
+        if (a->persist != NULL) {
+            a->persist(unique_id, node_id, a->persist_arg);
+        }
+    }
+    return node_id;
+}
+
+bool node_id_allocator_handle_request(node_id_allocator_t *a,
+                                      const node_id_allocator_msg_t *request,
+                                      uint32_t now_us,
+                                      node_id_allocator_msg_t *response)
+{
+    if (a->unique_id_len > 0 &&
+        now_us - a->last_request_us > NODE_ID_ALLOCATOR_FOLLOWUP_TIMEOUT_US) {
+        a->unique_id_len = 0;
+    }
+
+    if (request->first_part_of_unique_id) {
+        a->unique_id_len = 0;
+    } else if (a->unique_id_len == 0) {
+        // follow-up of a request we did not see
+        return false;
+    }
+
+    if (request->unique_id_len == 0 ||
+        request->unique_id_len > NODE_ID_ALLOCATOR_MAX_PART_LEN ||
+        a->unique_id_len + request->unique_id_len > NODE_ID_ALLOCATOR_UNIQUE_ID_LEN) {
+        a->unique_id_len = 0;
+        return false;
+    }
+
+    memcpy(&a->unique_id[a->unique_id_len], request->unique_id, request->unique_id_len);
+    a->unique_id_len += request->unique_id_len;
+    a->last_request_us = now_us;
+
+    response->first_part_of_unique_id = false;
+    response->node_id = NODE_ID_ALLOCATOR_NONE;
+    memcpy(response->unique_id, a->unique_id, a->unique_id_len);
+    response->unique_id_len = a->unique_id_len;
+
+    if (a->unique_id_len < NODE_ID_ALLOCATOR_UNIQUE_ID_LEN) {
+        return true;
+    }
+
+    a->unique_id_len = 0;
+    response->node_id = allocate(a, response->unique_id, request->node_id);
+    return response->node_id != NODE_ID_ALLOCATOR_NONE;
+}
+
+uint8_t node_id_allocator_get_node_id(const node_id_allocator_t *a, const uint8_t *unique_id)
+{
+    int index = index_by_unique_id(a, unique_id);
+    if (index < 0) {
+        return NODE_ID_ALLOCATOR_NONE;
+    }
+    return a->table[index].node_id;
+}
+
+int node_id_allocator_release(node_id_allocator_t *a, uint8_t node_id)
+{
+    int index = index_by_node_id(a, node_id);
+    if (index < 0) {
+        return -1;
+    }
+    if (a->persist != NULL) {
+        a->persist(a->table[index].unique_id, NODE_ID_ALLOCATOR_NONE, a->persist_arg);
+    }
+    remove_entry(a, index);
+    return 0;
+}
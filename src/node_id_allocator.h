@@ -0,0 +1,109 @@
+#ifndef NODE_ID_ALLOCATOR_H
+#define NODE_ID_ALLOCATOR_H
+
+/*
+
+# Node ID allocator
+
+Server side of the UAVCAN dynamic node ID allocation protocol
+(uavcan.protocol.dynamic_node_id.Allocation), in its centralized form.
+
+A board without node ID broadcasts anonymous requests carrying its 16 byte
+unique ID, 6 bytes at a time. Each request is answered with the part of the
+unique ID collected so far, which the board checks before sending the next
+part. Once the whole unique ID is known the answer carries the allocated
+node ID.
+
+A unique ID keeps its node ID as long as it is in the table. The table is
+persisted by the caller, through the callback given at init.
+
+The module knows nothing about CAN: requests and responses are plain
+structs, so that it can be run against a simulated bus.
+
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define NODE_ID_ALLOCATOR_UNIQUE_ID_LEN     16
+#define NODE_ID_ALLOCATOR_MAX_PART_LEN      6
+#define NODE_ID_ALLOCATOR_MAX_NODE_ID       125
+#define NODE_ID_ALLOCATOR_NONE              0
+/* Requests following up on an earlier one after that are ignored. */
+#define NODE_ID_ALLOCATOR_FOLLOWUP_TIMEOUT_US 500000
+
+/** Content of an Allocation message. */
+typedef struct {
+    uint8_t node_id;
+    bool first_part_of_unique_id;
+    uint8_t unique_id[NODE_ID_ALLOCATOR_UNIQUE_ID_LEN];
+    uint8_t unique_id_len;
+} node_id_allocator_msg_t;
+
+typedef struct {
+    uint8_t unique_id[NODE_ID_ALLOCATOR_UNIQUE_ID_LEN];
+    uint8_t node_id;
+} node_id_allocation_t;
+
+/** Called when an allocation is made, or released with node ID
+ * NODE_ID_ALLOCATOR_NONE. */
+typedef void (*node_id_allocator_persist_t)(const uint8_t *unique_id, uint8_t node_id, void *arg);
+
+typedef struct {
+    node_id_allocation_t *table;
+    uint16_t table_len;
+    uint16_t nb_allocations;
+    uint32_t online[4]; /**< Bitmap of the node IDs seen on the bus. */
+
+    // unique ID of the request in progress
+    uint8_t unique_id[NODE_ID_ALLOCATOR_UNIQUE_ID_LEN];
+    uint8_t unique_id_len;
+    uint32_t last_request_us;
+
+    node_id_allocator_persist_t persist;
+    void *persist_arg;
+} node_id_allocator_t;
+
+/** Starts with an empty table, own_node_id is never allocated. */
+void node_id_allocator_init(node_id_allocator_t *a,
+                            node_id_allocation_t *table, uint16_t table_len,
+                            uint8_t own_node_id,
+                            node_id_allocator_persist_t persist, void *persist_arg);
+
+/** Loads an allocation from persistent storage, without persisting it.
+ *
+ * NODE_ID_ALLOCATOR_NONE removes the allocation of unique_id.
+ */
+void node_id_allocator_restore(node_id_allocator_t *a, const uint8_t *unique_id, uint8_t node_id);
+
+/** Marks a node ID as used, for example by a board with a static ID. */
+void node_id_allocator_node_seen(node_id_allocator_t *a, uint8_t node_id);
+
+/** Processes an anonymous Allocation request.
+ *
+ * @return true if response was filled and must be broadcast.
+ */
+bool node_id_allocator_handle_request(node_id_allocator_t *a,
+                                      const node_id_allocator_msg_t *request,
+                                      uint32_t now_us,
+                                      node_id_allocator_msg_t *response);
+
+/** @return The node ID of unique_id or NODE_ID_ALLOCATOR_NONE. */
+uint8_t node_id_allocator_get_node_id(const node_id_allocator_t *a, const uint8_t *unique_id);
+
+/** Frees the node ID allocated to another unique ID, for example when the
+ * board holding it was replaced.
+ *
+ * @return 0 on success, -1 if the node ID was not allocated.
+ */
+int node_id_allocator_release(node_id_allocator_t *a, uint8_t node_id);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* NODE_ID_ALLOCATOR_H */
@@ -0,0 +1,182 @@
+#include <string.h>
+#include "node_id_cache.h"
+
+#define RECORD_MAGIC 0x4e49
+
+static uint32_t checksum(const node_id_cache_record_t *r)
+{
+    /* FNV-1a over everything but the checksum itself. */
+    const uint8_t *p = (const uint8_t *)r;
+    uint32_t hash = 2166136261u;
+    size_t i;
+    for (i = 0; i < offsetof(node_id_cache_record_t, checksum); i++) {
+        hash = (hash ^ p[i]) * 16777619u;
+    }
+    return hash;
+}
+
+static bool is_erased(const node_id_cache_record_t *r)
+{
+    const uint8_t *p = (const uint8_t *)r;
+    size_t i;
+    for (i = 0; i < sizeof(node_id_cache_record_t); i++) {
+        if (p[i] != 0xff) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool is_valid(const node_id_cache_record_t *r)
+{
+    return r->magic == RECORD_MAGIC && r->checksum == checksum(r);
+}
+
+static bool key_equal(const node_id_cache_record_t *r, uint8_t type, const uint8_t *key)
+{
+    return r->type == type && memcmp(r->key, key, NODE_ID_CACHE_STR_ID_LEN) == 0;
+}
+
+/* Keys are compared on their full length, so unused bytes must be zero. */
+static void str_id_key(uint8_t *key, const char *str_id)
+{
+    strncpy((char *)key, str_id, NODE_ID_CACHE_STR_ID_LEN);
+}
+
+static void unique_id_key(uint8_t *key, const uint8_t *unique_id)
+{
+    memset(key, 0, NODE_ID_CACHE_STR_ID_LEN);
+    memcpy(key, unique_id, NODE_ID_CACHE_UNIQUE_ID_LEN);
+}
+
+void node_id_cache_init(node_id_cache_t *c, const void *base, size_t size,
+                        node_id_cache_program_t program,
+                        node_id_cache_erase_t erase)
+{
+    c->records = (const node_id_cache_record_t *)base;
+    c->capacity = size / sizeof(node_id_cache_record_t);
+    c->program = program;
+    c->erase = erase;
+
+    c->nb_written = 0;
+    while (c->nb_written < c->capacity && !is_erased(&c->records[c->nb_written])) {
+        c->nb_written++;
+    }
+}
+
+static uint8_t lookup(const node_id_cache_t *c, uint8_t type, const uint8_t *key)
+{
+    uint32_t i = c->nb_written;
+    while (i-- > 0) {
+        if (is_valid(&c->records[i]) && key_equal(&c->records[i], type, key)) {
+            return c->records[i].can_id;
+        }
+    }
+    return NODE_ID_CACHE_NOT_FOUND;
+}
+
+uint8_t node_id_cache_lookup(const node_id_cache_t *c, const char *str_id)
+{
+    uint8_t key[NODE_ID_CACHE_STR_ID_LEN];
+    str_id_key(key, str_id);
+    return lookup(c, NODE_ID_CACHE_STR_ID, key);
+}
+
+uint8_t node_id_cache_lookup_unique_id(const node_id_cache_t *c, const uint8_t *unique_id)
+{
+    uint8_t key[NODE_ID_CACHE_STR_ID_LEN];
+    unique_id_key(key, unique_id);
+    return lookup(c, NODE_ID_CACHE_UNIQUE_ID, key);
+}
+
+static void append(node_id_cache_t *c, const node_id_cache_record_t *r)
+{
+    c->program((void *)&c->records[c->nb_written], r, sizeof(node_id_cache_record_t));
+    c->nb_written++;
+}
+
+static int store(node_id_cache_t *c, uint8_t type, const uint8_t *key, uint8_t can_id)
+{
+    if (lookup(c, type, key) == can_id) {
+        return 0;
+    }
+    if (c->nb_written == c->capacity) {
+        return -1;
+    }
+
+    node_id_cache_record_t r;
+    memset(&r, 0, sizeof(r));
+    r.magic = RECORD_MAGIC;
+    r.can_id = can_id;
+    r.type = type;
+    memcpy(r.key, key, NODE_ID_CACHE_STR_ID_LEN);
+    r.checksum = checksum(&r);
+
+    append(c, &r);
+    return 0;
+}
+
+int node_id_cache_store(node_id_cache_t *c, const char *str_id, uint8_t can_id)
+{
+    uint8_t key[NODE_ID_CACHE_STR_ID_LEN];
+    str_id_key(key, str_id);
+    return store(c, NODE_ID_CACHE_STR_ID, key, can_id);
+}
+
+int node_id_cache_store_unique_id(node_id_cache_t *c, const uint8_t *unique_id, uint8_t can_id)
+{
+    uint8_t key[NODE_ID_CACHE_STR_ID_LEN];
+    unique_id_key(key, unique_id);
+    return store(c, NODE_ID_CACHE_UNIQUE_ID, key, can_id);
+}
+
+void node_id_cache_foreach(const node_id_cache_t *c, uint8_t type,
+                           node_id_cache_visitor_t visitor, void *arg)
+{
+    uint32_t i;
+    for (i = 0; i < c->nb_written; i++) {
+        const node_id_cache_record_t *r = &c->records[i];
+        if (is_valid(r) && r->type == type) {
+            visitor(r->key, r->can_id, arg);
+        }
+    }
+}
+
+uint32_t node_id_cache_free_slots(const node_id_cache_t *c)
+{
+    return c->capacity - c->nb_written;
+}
+
+uint32_t node_id_cache_compact(node_id_cache_t *c,
+                               node_id_cache_record_t *scratch,
+                               uint32_t scratch_len)
+{
+    uint32_t nb_kept = 0;
+    uint32_t i = c->nb_written;
+
+    while (i-- > 0 && nb_kept < scratch_len) {
+        const node_id_cache_record_t *r = &c->records[i];
+        if (!is_valid(r)) {
+            continue;
+        }
+        uint32_t j;
+        for (j = 0; j < nb_kept; j++) {
+            if (key_equal(&scratch[j], r->type, r->key)) {
+                break;
+            }
+        }
+        if (j == nb_kept) {
+            scratch[nb_kept++] = *r;
+        }
+    }
+
+    c->erase();
+    c->nb_written = 0;
+
+    // oldest first, so that the log order is kept
+    for (i = nb_kept; i-- > 0;) {
+        append(c, &scratch[i]);
+    }
+
+    return nb_kept;
+}
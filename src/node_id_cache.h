@@ -0,0 +1,116 @@
+#ifndef NODE_ID_CACHE_H
+#define NODE_ID_CACHE_H
+
+/*
+
+# Node ID cache
+
+Remembers which CAN ID each string ID had, in a region of flash, so that
+actuators can be addressed after a reboot before their board broadcasts its
+string ID again. It also holds the node IDs given by the dynamic node ID
+allocator to each unique ID.
+
+The region is an append-only log of fixed size records: a changed mapping
+is written as a new record and the newest record of a key wins. Erased
+flash reads as 0xff, so the first slot full of 0xff is the end of the log.
+A record interrupted by a reset fails its checksum and is skipped.
+
+When the log is full it must be compacted, which erases the region: this
+stalls the CPU for seconds on the STM32F4 and should only be done at boot.
+
+Writing and erasing go through the callbacks given at init, to keep this
+module independent of the flash controller.
+
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define NODE_ID_CACHE_STR_ID_LEN    24
+#define NODE_ID_CACHE_UNIQUE_ID_LEN 16
+#define NODE_ID_CACHE_NOT_FOUND     0xff
+
+/** Kind of key of a record. */
+enum {
+    NODE_ID_CACHE_STR_ID = 0,
+    NODE_ID_CACHE_UNIQUE_ID,
+};
+
+typedef struct {
+    uint16_t magic;
+    uint8_t can_id;
+    uint8_t type;
+    /** String ID, not terminated if 24 chars long, or unique ID padded with
+     * zeros. */
+    uint8_t key[NODE_ID_CACHE_STR_ID_LEN];
+    uint32_t checksum;
+} node_id_cache_record_t;
+
+/** Called for each record of a kind, oldest first. */
+typedef void (*node_id_cache_visitor_t)(const uint8_t *key, uint8_t can_id, void *arg);
+
+/** Programs len bytes from src to dst, which are word aligned. */
+typedef void (*node_id_cache_program_t)(void *dst, const void *src, size_t len);
+
+/** Erases the whole region. */
+typedef void (*node_id_cache_erase_t)(void);
+
+typedef struct {
+    const node_id_cache_record_t *records;
+    uint32_t capacity;
+    uint32_t nb_written;    /**< Slots used, including corrupted ones. */
+    node_id_cache_program_t program;
+    node_id_cache_erase_t erase;
+} node_id_cache_t;
+
+/** Opens the log stored in the size bytes at base. */
+void node_id_cache_init(node_id_cache_t *c, const void *base, size_t size,
+                        node_id_cache_program_t program,
+                        node_id_cache_erase_t erase);
+
+/** @return The newest CAN ID stored for str_id or NODE_ID_CACHE_NOT_FOUND. */
+uint8_t node_id_cache_lookup(const node_id_cache_t *c, const char *str_id);
+
+/** Records a mapping, unless it is already the newest one for str_id.
+ *
+ * @return 0 on success, -1 if the log is full.
+ */
+int node_id_cache_store(node_id_cache_t *c, const char *str_id, uint8_t can_id);
+
+/** @return The newest node ID allocated to unique_id or NODE_ID_CACHE_NOT_FOUND. */
+uint8_t node_id_cache_lookup_unique_id(const node_id_cache_t *c, const uint8_t *unique_id);
+
+/** Records a node ID allocation, NODE_ID_CACHE_NOT_FOUND when released.
+ *
+ * @return 0 on success, -1 if the log is full.
+ */
+int node_id_cache_store_unique_id(node_id_cache_t *c, const uint8_t *unique_id, uint8_t can_id);
+
+/** Visits the valid records of the given type, oldest first. */
+void node_id_cache_foreach(const node_id_cache_t *c, uint8_t type,
+                           node_id_cache_visitor_t visitor, void *arg);
+
+/** Free record slots left in the log. */
+uint32_t node_id_cache_free_slots(const node_id_cache_t *c);
+
+/** Rewrites the log with only the newest record of each key.
+ *
+ * The newest records are gathered in scratch first, at most scratch_len of
+ * them are kept.
+ *
+ * @return The number of records kept.
+ */
+uint32_t node_id_cache_compact(node_id_cache_t *c,
+                               node_id_cache_record_t *scratch,
+                               uint32_t scratch_len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* NODE_ID_CACHE_H */
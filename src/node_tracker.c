@@ -1,39 +1,44 @@
-#include <stdint.h>
-#include <ch.h>
+#include "node_tracker.h"
 
-MUTEX_DECL(node_tracker_mutex);
-
-uint64_t node_tracker_list[2] = {0,0};
-
-void node_tracker_set_id(uint8_t id)
+void node_tracker_init(node_tracker_t *t)
 {
-    chMtxLock(&node_tracker_mutex);
-    if (id < 64) {
-        node_tracker_list[0] |= (1ULL << id);
-    } else {
-        node_tracker_list[1] |= (1ULL << (id - 64));
+    int i;
+    for (i = 0; i < NODE_TRACKER_NB_NODES; i++) {
+        t->nodes[i].seen = false;
+        t->nodes[i].reboots = 0;
     }
-    chMtxUnlock(&node_tracker_mutex);
 }
 
-static void _node_tracker_get(uint64_t *lo, uint64_t *hi)
+bool node_tracker_update(node_tracker_t *t, uint8_t id, uint32_t now_us,
+                         uint32_t uptime_s, uint8_t health, uint8_t mode)
 {
-    *lo = node_tracker_list[0];
-    *hi = node_tracker_list[1];
-}
+    if (id >= NODE_TRACKER_NB_NODES) {
+        return false;
+    }
+    node_tracker_entry_t *n = &t->nodes[id];
+    bool rebooted = false;
 
-void node_tracker_get(uint64_t *lo, uint64_t *hi)
-{
-    chMtxLock(&node_tracker_mutex);
-    _node_tracker_get(lo, hi);
-    chMtxUnlock(&node_tracker_mutex);
+    if (n->seen) {
+        uint32_t expected_uptime_s = n->uptime_s + (now_us - n->last_seen_us) / 1000000;
+        if (uptime_s + NODE_TRACKER_UPTIME_TOLERANCE_S < expected_uptime_s) {
+            rebooted = true;
+            n->reboots++;
+        }
+    }
+
+    n->seen = true;
+    n->last_seen_us = now_us;
+    n->uptime_s = uptime_s;
+    n->health = health;
+    n->mode = mode;
+
+    return rebooted;
 }
 
-void node_tracker_get_and_clear(uint64_t *lo, uint64_t *hi)
+bool node_tracker_is_online(const node_tracker_t *t, uint8_t id, uint32_t now_us)
 {
-    chMtxLock(&node_tracker_mutex);
-    _node_tracker_get(lo, hi);
-    node_tracker_list[0] = 0;
-    node_tracker_list[1] = 0;
-    chMtxUnlock(&node_tracker_mutex);
+    if (id >= NODE_TRACKER_NB_NODES || !t->nodes[id].seen) {
+        return false;
+    }
+    return now_us - t->nodes[id].last_seen_us < NODE_TRACKER_OFFLINE_TIMEOUT_US;
 }
@@ -1,15 +1,57 @@
 #ifndef NODE_TRACKER_H
 #define NODE_TRACKER_H
 
+/*
+
+# Node tracker
+
+Health table of the nodes on the bus, updated from their NodeStatus
+messages. A node which stopped sending them for
+NODE_TRACKER_OFFLINE_TIMEOUT_US is considered offline.
+
+A node rebooted if its uptime is smaller than what it should be given the
+uptime it reported last time, which also catches reboots that happened while
+it was offline.
+
+ */
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
 #include <stdint.h>
+#include <stdbool.h>
+
+#define NODE_TRACKER_NB_NODES               128
+#define NODE_TRACKER_OFFLINE_TIMEOUT_US     3000000
+
+/* Uptime is reported in whole seconds, smaller drifts are not reboots. */
+#define NODE_TRACKER_UPTIME_TOLERANCE_S     2
+
+typedef struct {
+    uint32_t last_seen_us;  /**< Time of the last NodeStatus. */
+    uint32_t uptime_s;
+    uint16_t reboots;       /**< Reboots detected since the node was first seen. */
+    uint8_t health;         /**< uavcan.protocol.NodeStatus HEALTH_* */
+    uint8_t mode;           /**< uavcan.protocol.NodeStatus MODE_* */
+    bool seen;
+} node_tracker_entry_t;
+
+typedef struct {
+    node_tracker_entry_t nodes[NODE_TRACKER_NB_NODES];
+} node_tracker_t;
+
+void node_tracker_init(node_tracker_t *t);
+
+/** Records a NodeStatus of node id.
+ *
+ * @return true if the node rebooted since its previous NodeStatus.
+ */
+bool node_tracker_update(node_tracker_t *t, uint8_t id, uint32_t now_us,
+                         uint32_t uptime_s, uint8_t health, uint8_t mode);
 
-void node_tracker_set_id(uint8_t id);
-void node_tracker_get(uint64_t *lo, uint64_t *hi);
-void node_tracker_get_and_clear(uint64_t *lo, uint64_t *hi);
+/** Tells whether a node sent a NodeStatus recently. */
+bool node_tracker_is_online(const node_tracker_t *t, uint8_t id, uint32_t now_us);
 
 #ifdef __cplusplus
 }
@@ -8,9 +8,13 @@
 
 #include "priorities.h"
 #include "robot_pose.h"
+#include "config.h"
+#include "unix_timestamp.h"
+#include "timestamp/timestamp.h"
 #include "odometry_publisher.h"
 
 #define ODOMETRY_PUBLISHER_STACKSIZE 1024
+#define POSE_UPDATED_EVENT EVENT_MASK(0)
 
 THD_WORKING_AREA(wa_odometry_publisher, ODOMETRY_PUBLISHER_STACKSIZE);
 
@@ -20,6 +24,13 @@ static void odometry_publisher_thread(void *p)
     cmp_ctx_t ctx;
     cmp_mem_access_t mem;
     ip_addr_t server;
+    event_listener_t pose_listener;
+    parameter_t *publish_period;
+    struct robot_base_pose_2d_s pose;
+    timestamp_t pose_timestamp;
+    timestamp_t last_publish = 0;
+    uint32_t pose_sequence;
+    unix_timestamp_t unix_ts;
 
     (void) p;
 
@@ -27,21 +38,35 @@ static void odometry_publisher_thread(void *p)
 
     ODOMETRY_PUBLISHER_HOST(&server);
 
+    publish_period = parameter_find(&global_config, "/master/odometry/publish_period");
+    chEvtRegisterMask(&robot_pose_updated, &pose_listener, POSE_UPDATED_EVENT);
+
     while (1) {
-            message_write_header(&ctx, &mem, buffer, sizeof buffer,
-                                 "odometry_raw");
-            chMtxLock(&robot_pose_lock);
-                //odometry_base_get_pose(&robot_base, &robot_pose);
-                cmp_write_array(&ctx, 3);
-                cmp_write_float(&ctx, robot_pose.x);
-                cmp_write_float(&ctx, robot_pose.y);
-                cmp_write_float(&ctx, robot_pose.theta);
-            chMtxUnlock(&robot_pose_lock);
-
-            message_transmit(buffer, cmp_mem_access_get_pos(&mem),
-                             &server, ODOMETRY_PUBLISHER_PORT);
-
-            chThdSleepMilliseconds(ODOMETRY_PUBLISHER_TIMESTEP_MS);
+        chEvtWaitAny(POSE_UPDATED_EVENT);
+
+        robot_pose_get(&pose, &pose_timestamp, &pose_sequence);
+
+        if (last_publish != 0 &&
+            timestamp_duration_s(last_publish, pose_timestamp) < parameter_scalar_get(publish_period)) {
+            continue;
+        }
+        last_publish = pose_timestamp;
+
+        unix_ts = timestamp_local_us_to_unix(pose_timestamp);
+
+        message_write_header(&ctx, &mem, buffer, sizeof buffer,
+                             "odometry_raw");
+        cmp_write_array(&ctx, 7);
+        cmp_write_float(&ctx, pose.x);
+        cmp_write_float(&ctx, pose.y);
+        cmp_write_float(&ctx, pose.theta);
+        cmp_write_uint(&ctx, pose_sequence);
+        cmp_write_uint(&ctx, pose_timestamp);
+        cmp_write_sint(&ctx, unix_ts.s);
+        cmp_write_sint(&ctx, unix_ts.us);
+
+        message_transmit(buffer, cmp_mem_access_get_pos(&mem),
+                         &server, ODOMETRY_PUBLISHER_PORT);
     }
 }
 
@@ -5,8 +5,12 @@
 extern "C" {
 #endif
 
-#define ODOMETRY_PUBLISHER_TIMESTEP_MS 20
-
+/** Starts the odometry publisher.
+ *
+ * Each pose update is sent as an odometry_raw message containing
+ * [x, y, theta, sequence, local timestamp [us], unix seconds, unix us], at most
+ * once every /master/odometry/publish_period seconds.
+ */
 void odometry_publisher_init(void);
 
 #ifdef __cplusplus
@@ -0,0 +1,96 @@
+#include <math.h>
+#include "pose_history.h"
+
+static const pose_history_entry_t *entry(const pose_history_t *h, uint16_t i)
+{
+    return &h->buffer[(h->head + i) % h->buffer_len];
+}
+
+/* Time elapsed since the oldest sample, robust to wrap around. */
+static int32_t age(const pose_history_t *h, uint32_t timestamp)
+{
+    return (int32_t)(timestamp - entry(h, 0)->timestamp);
+}
+
+static float wrap_angle(float a)
+{
+    while (a > M_PI) {
+        a -= 2 * M_PI;
+    }
+    while (a < -M_PI) {
+        a += 2 * M_PI;
+    }
+    return a;
+}
+
+void pose_history_init(pose_history_t *h, pose_history_entry_t *buffer, uint16_t buffer_len)
+{
+    h->buffer = buffer;
+    h->buffer_len = buffer_len;
+    h->head = 0;
+    h->nb_entries = 0;
+}
+
+void pose_history_push(pose_history_t *h, uint32_t timestamp,
+                       const struct robot_base_pose_2d_s *pose)
+{
+    pose_history_entry_t *e;
+
+    if (h->nb_entries == h->buffer_len) {
+        h->head = (h->head + 1) % h->buffer_len;
+        h->nb_entries--;
+    }
+
+    e = &h->buffer[(h->head + h->nb_entries) % h->buffer_len];
+    e->timestamp = timestamp;
+    e->pose = *pose;
+    h->nb_entries++;
+}
+
+int pose_history_get(const pose_history_t *h, uint32_t timestamp,
+                     struct robot_base_pose_2d_s *pose)
+{
+    const pose_history_entry_t *a, *b;
+    int32_t t;
+    uint16_t low, high, mid;
+    float k;
+
+    if (h->nb_entries == 0) {
+        return POSE_HISTORY_TOO_RECENT;
+    }
+
+    t = age(h, timestamp);
+    if (t < 0) {
+        return POSE_HISTORY_TOO_OLD;
+    }
+    if (t > age(h, entry(h, h->nb_entries - 1)->timestamp)) {
+        return POSE_HISTORY_TOO_RECENT;
+    }
+
+    /* Find the last sample which is not after timestamp. */
+    low = 0;
+    high = h->nb_entries - 1;
+    while (low < high) {
+        mid = (low + high + 1) / 2;
+        if (age(h, entry(h, mid)->timestamp) <= t) {
+            low = mid;
+        } else {
+            high = mid - 1;
+        }
+    }
+
+    a = entry(h, low);
+    if (low == h->nb_entries - 1 || a->timestamp == timestamp) {
+        *pose = a->pose;
+        return POSE_HISTORY_OK;
+    }
+
+    b = entry(h, low + 1);
+    k = (float)(int32_t)(timestamp - a->timestamp) / (float)(int32_t)(b->timestamp - a->timestamp);
+
+    pose->x = a->pose.x + k * (b->pose.x - a->pose.x);
+    pose->y = a->pose.y + k * (b->pose.y - a->pose.y);
+    pose->theta = wrap_angle(a->pose.theta + k * wrap_angle(b->pose.theta - a->pose.theta));
+
+    return POSE_HISTORY_OK;
+}
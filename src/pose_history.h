@@ -0,0 +1,60 @@
+#ifndef POSE_HISTORY_H
+#define POSE_HISTORY_H
+
+/*
+
+# Pose history
+
+Ring buffer of timestamped robot poses, fed by the odometry. It answers
+"where was the robot at time t", interpolating between the two closest
+samples, so that measurements taken in the past can be fused with the pose
+the robot had at that moment.
+
+Timestamps are local microseconds and are expected to be pushed in
+increasing order. They may wrap around.
+
+ */
+
+#include <stdint.h>
+#include "odometry/robot_base.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define POSE_HISTORY_OK         0
+#define POSE_HISTORY_TOO_OLD    -1  /**< Requested time is before the oldest sample. */
+#define POSE_HISTORY_TOO_RECENT -2  /**< Requested time is after the latest sample. */
+
+typedef struct {
+    uint32_t timestamp;
+    struct robot_base_pose_2d_s pose;
+} pose_history_entry_t;
+
+typedef struct {
+    pose_history_entry_t *buffer;
+    uint16_t buffer_len;
+    uint16_t head; /**< Index of the oldest entry. */
+    uint16_t nb_entries;
+} pose_history_t;
+
+/** Initializes an empty history, using buffer to store buffer_len samples. */
+void pose_history_init(pose_history_t *h, pose_history_entry_t *buffer, uint16_t buffer_len);
+
+/** Appends a sample, overwriting the oldest one when full. */
+void pose_history_push(pose_history_t *h, uint32_t timestamp,
+                       const struct robot_base_pose_2d_s *pose);
+
+/** Computes the pose at the given time by linear interpolation.
+ *
+ * @return POSE_HISTORY_OK or one of the error codes above, in which case pose
+ * is left untouched.
+ */
+int pose_history_get(const pose_history_t *h, uint32_t timestamp,
+                     struct robot_base_pose_2d_s *pose);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* POSE_HISTORY_H */
@@ -3,8 +3,10 @@
 
 /* Higher number -> higher priority */
 
-/* lwip threads */
-#define TCPIP_THREAD_PRIO                       (LOWPRIO + 1)
+/* lwip threads, at the level of the message servers because real-time
+ * messages are decoded directly in the tcpip thread. */
+#define LWIP_THREAD_PRIORITY                    (NORMALPRIO - 1)
+#define TCPIP_THREAD_PRIO                       (NORMALPRIO - 1)
 #define DEFAULT_THREAD_PRIO                     (LOWPRIO + 1)
 
 #define USB_SHELL_PRIO                          (NORMALPRIO + 2)
@@ -12,8 +14,13 @@
 #define RPC_SERVER_PRIO                         (NORMALPRIO - 1)
 #define ODOMETRY_PUBLISHER_PRIO                 (NORMALPRIO - 1)
 #define DIFFERENTIAL_BASE_TRACKING_THREAD_PRIO  (NORMALPRIO - 1)
+#define WHEEL_ODOMETRY_PRIO                     (NORMALPRIO + 1)
 #define IMU_PRIO                                (NORMALPRIO - 2)
 #define STREAM_PRIO                             (NORMALPRIO - 3)
+#define FIRMWARE_IMAGE_SERVER_PRIO              (NORMALPRIO - 3)
+/* Setpoints preempt the handling of received frames. */
+#define UAVCAN_RX_PRIO                          NORMALPRIO
+#define UAVCAN_TX_PRIO                          (NORMALPRIO + 1)
 
 #define INTERFACE_PANEL_PRIO                    (NORMALPRIO + 2)
 
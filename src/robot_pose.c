@@ -1,5 +1,73 @@
 #include <ch.h>
+#include "seqlock.h"
 #include "robot_pose.h"
 
-struct robot_base_pose_2d_s robot_pose;
-mutex_t robot_pose_lock;
+static struct {
+    seqlock_t lock;
+    struct robot_base_pose_2d_s pose;
+    timestamp_t timestamp;
+} current;
+
+EVENTSOURCE_DECL(robot_pose_updated);
+
+/* Written with the current pose, under the same sequence lock. */
+static pose_history_t history;
+
+void robot_pose_set(const struct robot_base_pose_2d_s *pose, timestamp_t timestamp)
+{
+    /* Readers may have a higher priority than the odometry, they must not
+     * preempt it in the middle of an update. */
+    chSysLock();
+    seqlock_write_begin(&current.lock);
+    current.pose = *pose;
+    current.timestamp = timestamp;
+    pose_history_push(&history, timestamp, pose);
+    seqlock_write_end(&current.lock);
+    chSysUnlock();
+
+    chEvtBroadcast(&robot_pose_updated);
+}
+
+void robot_pose_get(struct robot_base_pose_2d_s *pose,
+                    timestamp_t *timestamp, uint32_t *sequence)
+{
+    uint32_t seq;
+    timestamp_t ts;
+
+    do {
+        seq = seqlock_read_begin(&current.lock);
+        *pose = current.pose;
+        ts = current.timestamp;
+    } while (seqlock_read_retry(&current.lock, seq));
+
+    if (timestamp != NULL) {
+        *timestamp = ts;
+    }
+    if (sequence != NULL) {
+        *sequence = seq / 2;
+    }
+}
+
+void robot_pose_history_init(pose_history_entry_t *buffer, uint16_t buffer_len)
+{
+    pose_history_init(&history, buffer, buffer_len);
+}
+
+int robot_pose_history_get(timestamp_t timestamp, struct robot_base_pose_2d_s *pose)
+{
+    struct robot_base_pose_2d_s p;
+    uint32_t seq;
+    int ret;
+
+    /* The search runs without any lock, a torn result is thrown away. */
+    do {
+        seq = seqlock_read_begin(&current.lock);
+        ret = pose_history_get(&history, timestamp, &p);
+    } while (seqlock_read_retry(&current.lock, seq));
+
+    if (ret == POSE_HISTORY_OK) {
+        *pose = p;
+    }
+
+    return ret;
+}
@@ -1,9 +1,46 @@
 #ifndef ROBOT_POSE_H
 #define ROBOT_POSE_H
 
+#include <ch.h>
+#include "timestamp/timestamp.h"
 #include "odometry/robot_base.h"
+#include "pose_history.h"
 
-extern struct robot_base_pose_2d_s robot_pose;
-extern mutex_t robot_pose_lock;
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Broadcast after each update of the robot pose. */
+extern event_source_t robot_pose_updated;
+
+/** Publishes the pose computed by the odometry from an encoder sample taken
+ * at the given time, records it in the history and signals
+ * robot_pose_updated.
+ *
+ * The pose and its history entry are published through a sequence lock:
+ * readers never block the writer, it only masks interrupts for the few
+ * stores of the update.
+ */
+void robot_pose_set(const struct robot_base_pose_2d_s *pose, timestamp_t timestamp);
+
+/** Copies the latest pose, without ever blocking.
+ *
+ * @param [out] timestamp Time of the encoder sample behind the pose, may be NULL.
+ * @param [out] sequence Number of updates so far, may be NULL.
+ */
+void robot_pose_get(struct robot_base_pose_2d_s *pose,
+                    timestamp_t *timestamp, uint32_t *sequence);
+
+/** Sets up the history of past poses, stored in buffer. */
+void robot_pose_history_init(pose_history_entry_t *buffer, uint16_t buffer_len);
+
+/** Gets the pose the robot had at the given time, see pose_history_get.
+ * Never blocks the writer, the search is restarted if a pose was pushed
+ * meanwhile. */
+int robot_pose_history_get(timestamp_t timestamp, struct robot_base_pose_2d_s *pose);
+
+#ifdef __cplusplus
+}
+#endif
 
 #endif
@@ -1,11 +1,19 @@
 #include <string.h>
 #include "rpc_callbacks.h"
 #include "config.h"
+#include "rpc_dispatch.h"
 #include <parameter/parameter_msgpack.h>
 #include "hal.h"
 #include "main.h"
 #include "motor_manager.h"
 #include "uavcan_node.h"
+#include "rpc_server.h"
+#include "robot_pose.h"
+#include "unix_timestamp.h"
+#include "timestamp/timestamp.h"
+#include "can_bridge_server.h"
+#include "can_capture.h"
+#include "firmware_update_server.h"
 
 const char *error_msg_bad_format = "Error: invalid argument format.";
 const char *error_msg_invalid_arg = "Error: invalid argument value.";
@@ -57,6 +65,7 @@ static bool config_update_cb(void *p, cmp_ctx_t *input, cmp_ctx_t *output)
     struct param_read_err_buf_s buf;
     buf.write_pos = 0;
     parameter_msgpack_read_cmp(&global_config, input, param_read_err_cb, (void *)&buf);
+    chEvtBroadcast(&config_updated);
     if (buf.write_pos == 0) {
         return true;
     } else {
@@ -144,13 +153,488 @@ static bool reboot_node(void *p, cmp_ctx_t *input, cmp_ctx_t *output)
     return true;
 }
 
+static bool message_server_stats_cb(void *p, cmp_ctx_t *input, cmp_ctx_t *output)
+{
+    message_server_stats_t stats;
+    (void) p;
+    (void) input;
+
+    message_server_get_stats(&stats);
+
+    cmp_write_map(output, 6);
+    cmp_write_str(output, "received", 8);
+    cmp_write_uint(output, stats.received);
+    cmp_write_str(output, "oversized", 9);
+    cmp_write_uint(output, stats.oversized);
+    cmp_write_str(output, "decode_error", 12);
+    cmp_write_uint(output, stats.decode_error);
+    cmp_write_str(output, "dropped_setpoint", 16);
+    cmp_write_uint(output, stats.dropped[MSG_CLASS_SETPOINT]);
+    cmp_write_str(output, "dropped_trajectory", 18);
+    cmp_write_uint(output, stats.dropped[MSG_CLASS_TRAJECTORY]);
+    cmp_write_str(output, "dropped_other", 13);
+    cmp_write_uint(output, stats.dropped[MSG_CLASS_OTHER]);
+
+    return true;
+}
+
+/* Returns the CAN bus load accounting, with per data type and per node
+ * [frames, bytes] counts. Nodes without traffic are omitted. */
+static bool can_bus_load_cb(void *p, cmp_ctx_t *input, cmp_ctx_t *output)
+{
+    static can_load_t load;
+    float scale;
+    int i;
+    (void) p;
+    (void) input;
+
+    uavcan_node_get_can_load(&load, &scale);
+
+    cmp_write_map(output, 7);
+    cmp_write_str(output, "utilization", 11);
+    cmp_write_float(output, load.utilization);
+    cmp_write_str(output, "rate_scale", 10);
+    cmp_write_float(output, scale);
+    cmp_write_str(output, "tx_frames", 9);
+    cmp_write_uint(output, load.tx_frames);
+    cmp_write_str(output, "rx_frames", 9);
+    cmp_write_uint(output, load.rx_frames);
+
+    cmp_write_str(output, "types", 5);
+    cmp_write_map(output, load.nb_types);
+    for (i = 0; i < load.nb_types; i++) {
+        cmp_write_uint(output, load.types[i].key);
+        cmp_write_array(output, 2);
+        cmp_write_uint(output, load.types[i].count.frames);
+        cmp_write_uint(output, load.types[i].count.bytes);
+    }
+
+    cmp_write_str(output, "other_types", 11);
+    cmp_write_array(output, 2);
+    cmp_write_uint(output, load.other_types.frames);
+    cmp_write_uint(output, load.other_types.bytes);
+
+    int nb_nodes = 0;
+    for (i = 0; i < CAN_LOAD_NB_NODES; i++) {
+        if (load.nodes[i].frames != 0) {
+            nb_nodes++;
+        }
+    }
+    cmp_write_str(output, "nodes", 5);
+    cmp_write_map(output, nb_nodes);
+    for (i = 0; i < CAN_LOAD_NB_NODES; i++) {
+        if (load.nodes[i].frames != 0) {
+            cmp_write_uint(output, i);
+            cmp_write_array(output, 2);
+            cmp_write_uint(output, load.nodes[i].frames);
+            cmp_write_uint(output, load.nodes[i].bytes);
+        }
+    }
+
+    return true;
+}
+
+/* Returns [ready, time to ready in ms], ready being true once every actuator
+ * was identified and configured after boot. Creating a driver clears it, and
+ * it is not set before /master/can/expected_actuators drivers exist. */
+static bool actuators_ready_cb(void *p, cmp_ctx_t *input, cmp_ctx_t *output)
+{
+    uint32_t time_to_ready_ms = 0;
+    (void) p;
+    (void) input;
+
+    bool ready = uavcan_node_actuators_ready(&time_to_ready_ms);
+
+    cmp_write_array(output, 2);
+    cmp_write_bool(output, ready);
+    cmp_write_uint(output, time_to_ready_ms);
+
+    return true;
+}
+
+/* Returns the health table of the UAVCAN nodes, as a map of node ID to
+ * [online, ms since last NodeStatus, uptime [s], health, mode, reboots]. */
+static bool uavcan_nodes_cb(void *p, cmp_ctx_t *input, cmp_ctx_t *output)
+{
+    static node_tracker_entry_t nodes[NODE_TRACKER_NB_NODES];
+    uint32_t nb_seen = 0;
+    uint32_t now = timestamp_get();
+    int id;
+    (void) p;
+    (void) input;
+
+    for (id = 0; id < NODE_TRACKER_NB_NODES; id++) {
+        if (uavcan_node_get_node_status(id, &nodes[id])) {
+            nb_seen++;
+        }
+    }
+
+    cmp_write_map(output, nb_seen);
+    for (id = 0; id < NODE_TRACKER_NB_NODES; id++) {
+        if (!nodes[id].seen) {
+            continue;
+        }
+        uint32_t age_us = now - nodes[id].last_seen_us;
+        cmp_write_uint(output, id);
+        cmp_write_array(output, 6);
+        cmp_write_bool(output, age_us < NODE_TRACKER_OFFLINE_TIMEOUT_US);
+        cmp_write_uint(output, age_us / 1000);
+        cmp_write_uint(output, nodes[id].uptime_s);
+        cmp_write_uint(output, nodes[id].health);
+        cmp_write_uint(output, nodes[id].mode);
+        cmp_write_uint(output, nodes[id].reboots);
+    }
+
+    return true;
+}
+
+static void write_latency_histogram(cmp_ctx_t *output, const latency_histogram_t *h)
+{
+    int i;
+
+    cmp_write_array(output, 5);
+    cmp_write_uint(output, h->count);
+    cmp_write_uint(output, latency_histogram_percentile(h, 50));
+    cmp_write_uint(output, latency_histogram_percentile(h, 99));
+    cmp_write_uint(output, h->max_us);
+    cmp_write_array(output, LATENCY_HISTOGRAM_NB_BINS);
+    for (i = 0; i < LATENCY_HISTOGRAM_NB_BINS; i++) {
+        cmp_write_uint(output, h->bins[i]);
+    }
+}
+
+/* Returns the latencies of the UAVCAN RX and TX threads since the last call,
+ * as {"rx": [count, p50, p99, max, bins], "tx": ...} in microseconds, bin i
+ * counting latencies below 2^(i + 1) us. */
+static bool uavcan_latency_cb(void *p, cmp_ctx_t *input, cmp_ctx_t *output)
+{
+    latency_histogram_t rx, tx;
+    (void) p;
+    (void) input;
+
+    uavcan_node_get_latency(&rx, &tx);
+
+    cmp_write_map(output, 2);
+    cmp_write_str(output, "rx", 2);
+    write_latency_histogram(output, &rx);
+    cmp_write_str(output, "tx", 2);
+    write_latency_histogram(output, &tx);
+
+    return true;
+}
+
+/* Returns the TX queue of each transfer priority class since the last call,
+ * as a map of class name to [depth, max depth, sent, expired, latency],
+ * latency being as in uavcan_latency. */
+static bool can_priority_stats_cb(void *p, cmp_ctx_t *input, cmp_ctx_t *output)
+{
+    static const char *class_names[CAN_PRIORITY_NB_CLASSES] = {
+        "emergency_stop", "setpoint", "feedback_config", "bulk_config",
+    };
+    static can_priority_stats_t stats;
+    int c;
+    (void) p;
+    (void) input;
+
+    uavcan_node_get_priority_stats(&stats);
+
+    cmp_write_map(output, CAN_PRIORITY_NB_CLASSES);
+    for (c = 0; c < CAN_PRIORITY_NB_CLASSES; c++) {
+        const can_priority_queue_t *q = &stats.classes[c];
+        cmp_write_str(output, class_names[c], strlen(class_names[c]));
+        cmp_write_array(output, 5);
+        cmp_write_uint(output, q->depth);
+        cmp_write_uint(output, q->max_depth);
+        cmp_write_uint(output, q->sent);
+        cmp_write_uint(output, q->expired);
+        write_latency_histogram(output, &q->latency);
+    }
+
+    return true;
+}
+
+/* Takes a number of filler frames per second to put on the bus, 0 to stop. */
+static bool uavcan_synthetic_load_cb(void *p, cmp_ctx_t *input, cmp_ctx_t *output)
+{
+    uint32_t rate;
+    (void) p;
+
+    if (!cmp_read_uint(input, &rate)) {
+        cmp_write_str(output, error_msg_bad_format, strlen(error_msg_bad_format));
+        return true;
+    }
+    uavcan_node_set_synthetic_load(rate);
+    cmp_write_bool(output, true);
+
+    return true;
+}
+
+/* Reads a list of [id, mask] CAN filters. */
+static bool read_can_filters(cmp_ctx_t *input, can_bridge_filter_t *filters, uint32_t *nb_filters)
+{
+    uint32_t pair_len = 0;
+    bool err = false;
+    uint32_t i;
+
+    err = err || !cmp_read_array(input, nb_filters);
+    err = err || *nb_filters > CAN_BRIDGE_MAX_FILTERS;
+    for (i = 0; i < *nb_filters && !err; i++) {
+        err = err || !cmp_read_array(input, &pair_len);
+        err = err || pair_len != 2;
+        err = err || !cmp_read_uint(input, &filters[i].id);
+        err = err || !cmp_read_uint(input, &filters[i].mask);
+    }
+
+    return !err;
+}
+
+/* Takes a list of [id, mask] and only forwards matching frames over the CAN
+ * bridge, an empty list forwards everything. */
+static bool can_bridge_filters_cb(void *p, cmp_ctx_t *input, cmp_ctx_t *output)
+{
+    can_bridge_filter_t filters[CAN_BRIDGE_MAX_FILTERS];
+    uint32_t nb_filters = 0;
+    (void) p;
+
+    if (!read_can_filters(input, filters, &nb_filters)) {
+        cmp_write_str(output, error_msg_bad_format, strlen(error_msg_bad_format));
+        return true;
+    }
+
+    can_bridge_set_filters(filters, nb_filters);
+    cmp_write_bool(output, true);
+
+    return true;
+}
+
+static bool can_bridge_stats_cb(void *p, cmp_ctx_t *input, cmp_ctx_t *output)
+{
+    can_bridge_stats_t stats;
+    (void) p;
+    (void) input;
+
+    can_bridge_get_stats(&stats);
+
+    cmp_write_map(output, 8);
+    cmp_write_str(output, "forwarded_frames", 16);
+    cmp_write_uint(output, stats.forwarded_frames);
+    cmp_write_str(output, "forwarded_bytes", 15);
+    cmp_write_uint(output, stats.forwarded_bytes);
+    cmp_write_str(output, "filtered", 8);
+    cmp_write_uint(output, stats.filtered);
+    cmp_write_str(output, "dropped", 7);
+    cmp_write_uint(output, stats.dropped);
+    cmp_write_str(output, "datagrams", 9);
+    cmp_write_uint(output, stats.datagrams);
+    cmp_write_str(output, "injected", 8);
+    cmp_write_uint(output, stats.injected);
+    cmp_write_str(output, "inject_dropped", 14);
+    cmp_write_uint(output, stats.inject_dropped);
+    cmp_write_str(output, "decode_errors", 13);
+    cmp_write_uint(output, stats.decode_errors);
+
+    return true;
+}
+
+/* Takes [post_trigger, [[id, mask], ...]], discards the CAN capture and
+ * records the frames matching the filters, all of them if there is none. */
+static bool can_recorder_arm_cb(void *p, cmp_ctx_t *input, cmp_ctx_t *output)
+{
+    can_bridge_filter_t filters[CAN_BRIDGE_MAX_FILTERS];
+    uint32_t nb_filters = 0, array_len = 0, post_trigger = 0;
+    bool err = false;
+    (void) p;
+
+    err = err || !cmp_read_array(input, &array_len);
+    err = err || array_len != 2;
+    err = err || !cmp_read_uint(input, &post_trigger);
+    err = err || !read_can_filters(input, filters, &nb_filters);
+
+    if (err) {
+        cmp_write_str(output, error_msg_bad_format, strlen(error_msg_bad_format));
+        return true;
+    }
+
+    can_capture_arm(post_trigger, filters, nb_filters);
+    cmp_write_bool(output, true);
+
+    return true;
+}
+
+static bool can_recorder_trigger_cb(void *p, cmp_ctx_t *input, cmp_ctx_t *output)
+{
+    (void) p;
+    (void) input;
+
+    can_capture_trigger(CAN_RECORDER_TRIGGER_RPC);
+    cmp_write_bool(output, true);
+
+    return true;
+}
+
+/* Takes the index of the first frame and returns a page of the CAN capture
+ * as [state, trigger reason, nb frames, trigger index, trigger timestamp,
+ * offset, frames], frames being a CAN bridge datagram. */
+static bool can_recorder_dump_cb(void *p, cmp_ctx_t *input, cmp_ctx_t *output)
+{
+    // leaves room for the rest of the reply in the RPC output buffer
+    static uint8_t page[900];
+    static can_bridge_frame_t frames[(sizeof(page) - CAN_BRIDGE_HEADER_LEN) / CAN_BRIDGE_FRAME_MAX_LEN];
+    can_capture_info_t info;
+    can_bridge_batch_t batch;
+    uint32_t offset = 0;
+    uint32_t i, n;
+    (void) p;
+
+    if (!cmp_read_uint(input, &offset)) {
+        cmp_write_str(output, error_msg_bad_format, strlen(error_msg_bad_format));
+        return true;
+    }
+
+    n = can_capture_read(offset, frames, sizeof(frames) / sizeof(frames[0]), &info);
+    can_bridge_batch_start(&batch, page, sizeof(page), offset, 0);
+    for (i = 0; i < n; i++) {
+        can_bridge_batch_append(&batch, &frames[i]);
+    }
+
+    cmp_write_array(output, 7);
+    cmp_write_uint(output, info.state);
+    cmp_write_uint(output, info.trigger_reason);
+    cmp_write_uint(output, info.nb_frames);
+    cmp_write_int(output, info.trigger_index);
+    cmp_write_uint(output, info.trigger_time_us);
+    cmp_write_uint(output, offset);
+    cmp_write_bin(output, page, can_bridge_batch_len(&batch));
+
+    return true;
+}
+
+/* Takes a list of node IDs and updates their firmware with the image
+ * uploaded on FIRMWARE_UPDATE_PORT. */
+static bool firmware_update_start_cb(void *p, cmp_ctx_t *input, cmp_ctx_t *output)
+{
+    const char *error_msg_no_image = "Error: no firmware image.";
+    uint8_t node_ids[FIRMWARE_UPDATE_MAX_NODES];
+    uint32_t nb_nodes = 0, id = 0;
+    bool err = false;
+    uint32_t i;
+    (void) p;
+
+    err = err || !cmp_read_array(input, &nb_nodes);
+    err = err || nb_nodes > FIRMWARE_UPDATE_MAX_NODES;
+    for (i = 0; i < nb_nodes && !err; i++) {
+        err = err || !cmp_read_uint(input, &id);
+        err = err || id >= FIRMWARE_UPDATE_MAX_NODES;
+        node_ids[i] = id;
+    }
+
+    if (err) {
+        cmp_write_str(output, error_msg_bad_format, strlen(error_msg_bad_format));
+        return true;
+    }
+
+    if (!firmware_update_server_start(node_ids, nb_nodes)) {
+        cmp_write_str(output, error_msg_no_image, strlen(error_msg_no_image));
+        return true;
+    }
+    cmp_write_bool(output, true);
+
+    return true;
+}
+
+/* Returns [image size, progress], progress being a map of node ID to
+ * [state, bytes read, BeginFirmwareUpdate attempts, error] for the nodes
+ * whose update was started. */
+static bool firmware_update_status_cb(void *p, cmp_ctx_t *input, cmp_ctx_t *output)
+{
+    static firmware_update_node_t nodes[FIRMWARE_UPDATE_MAX_NODES];
+    uint32_t nb_nodes = 0;
+    int id;
+    (void) p;
+    (void) input;
+
+    for (id = 0; id < FIRMWARE_UPDATE_MAX_NODES; id++) {
+        if (firmware_update_server_get_status(id, &nodes[id])) {
+            nb_nodes++;
+        }
+    }
+
+    cmp_write_array(output, 2);
+    cmp_write_uint(output, firmware_update_server_image_size());
+    cmp_write_map(output, nb_nodes);
+    for (id = 0; id < FIRMWARE_UPDATE_MAX_NODES; id++) {
+        if (nodes[id].state == FIRMWARE_UPDATE_IDLE) {
+            continue;
+        }
+        cmp_write_uint(output, id);
+        cmp_write_array(output, 4);
+        cmp_write_uint(output, nodes[id].state);
+        cmp_write_uint(output, nodes[id].progress);
+        cmp_write_uint(output, nodes[id].attempts);
+        cmp_write_uint(output, nodes[id].error);
+    }
+
+    return true;
+}
+
+/* Takes a unix timestamp [s, us] and returns the pose [x, y, theta] the
+ * robot had at that time. */
+static bool robot_pose_at_cb(void *p, cmp_ctx_t *input, cmp_ctx_t *output)
+{
+    const char *error_msg_no_pose = "Error: time is outside of pose history.";
+    unix_timestamp_t ts;
+    struct robot_base_pose_2d_s pose;
+    uint32_t array_len = 0;
+    bool err = false;
+    (void) p;
+
+    err = err || !cmp_read_array(input, &array_len);
+    err = err || array_len != 2;
+    err = err || !cmp_read_int(input, &ts.s);
+    err = err || !cmp_read_int(input, &ts.us);
+
+    if (err) {
+        cmp_write_str(output, error_msg_bad_format, strlen(error_msg_bad_format));
+        return true;
+    }
+
+    if (robot_pose_history_get(timestamp_unix_to_local_us(ts), &pose) != POSE_HISTORY_OK) {
+        cmp_write_str(output, error_msg_no_pose, strlen(error_msg_no_pose));
+        return true;
+    }
+
+    cmp_write_array(output, 3);
+    cmp_write_float(output, pose.x);
+    cmp_write_float(output, pose.y);
+    cmp_write_float(output, pose.theta);
+
+    return true;
+}
+
 struct service_call_method_s service_call_callbacks[] = {
     {.name="ping", .cb=ping_cb},
     {.name="config_update", .cb=config_update_cb},
     {.name="led_set", .cb=led_cb},
     {.name="actuator_create_driver", .cb=create_motor_driver},
     {.name="reboot_node", .cb=reboot_node},
+    {.name="message_server_stats", .cb=message_server_stats_cb},
+    {.name="robot_pose_at", .cb=robot_pose_at_cb},
+    {.name="can_bus_load", .cb=can_bus_load_cb},
+    {.name="actuators_ready", .cb=actuators_ready_cb},
+    {.name="uavcan_nodes", .cb=uavcan_nodes_cb},
+    {.name="uavcan_latency", .cb=uavcan_latency_cb},
+    {.name="uavcan_synthetic_load", .cb=uavcan_synthetic_load_cb},
+    {.name="can_priority_stats", .cb=can_priority_stats_cb},
+    {.name="can_bridge_filters", .cb=can_bridge_filters_cb},
+    {.name="can_bridge_stats", .cb=can_bridge_stats_cb},
+    {.name="can_recorder_arm", .cb=can_recorder_arm_cb},
+    {.name="can_recorder_trigger", .cb=can_recorder_trigger_cb},
+    {.name="can_recorder_dump", .cb=can_recorder_dump_cb},
+    {.name="firmware_update_start", .cb=firmware_update_start_cb},
+    {.name="firmware_update_status", .cb=firmware_update_status_cb},
 };
 
+RPC_DISPATCH_CHECK_SIZE(service_call_callbacks);
+
 const unsigned int service_call_callbacks_len =
     sizeof(service_call_callbacks) / sizeof(service_call_callbacks[0]);
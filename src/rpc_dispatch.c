@@ -0,0 +1,224 @@
+#include <string.h>
+#include <cmp/cmp.h>
+#include <cmp_mem_access/cmp_mem_access.h>
+#include "rpc_dispatch.h"
+
+#define TABLE_MASK  (RPC_DISPATCH_TABLE_SIZE - 1)
+#define EMPTY       -1
+
+uint32_t rpc_dispatch_hash(const char *name, size_t len)
+{
+    uint32_t hash = 2166136261u;
+    size_t i;
+
+    for (i = 0; i < len; i++) {
+        hash ^= (uint8_t)name[i];
+        hash *= 16777619u;
+    }
+
+    return hash;
+}
+
+void rpc_dispatch_table_init(rpc_dispatch_table_t *t)
+{
+    int i;
+
+    for (i = 0; i < RPC_DISPATCH_TABLE_SIZE; i++) {
+        t->index[i] = EMPTY;
+    }
+    t->nb_entries = 0;
+}
+
+int rpc_dispatch_table_add(rpc_dispatch_table_t *t, const char *name, int index)
+{
+    size_t len = strlen(name);
+    uint32_t hash;
+    int i;
+
+    // keep at least half of the slots free so that probe sequences stay short
+    if (2 * (t->nb_entries + 1) > RPC_DISPATCH_TABLE_SIZE) {
+        return -1;
+    }
+    if (rpc_dispatch_table_find(t, name, len) != RPC_DISPATCH_NOT_FOUND) {
+        return -1;
+    }
+
+    hash = rpc_dispatch_hash(name, len);
+    i = hash & TABLE_MASK;
+    while (t->index[i] != EMPTY) {
+        i = (i + 1) & TABLE_MASK;
+    }
+
+    t->name[i] = name;
+    t->hash[i] = hash;
+    t->index[i] = index;
+    t->nb_entries++;
+
+    return 0;
+}
+
+int rpc_dispatch_table_find(const rpc_dispatch_table_t *t, const char *name, size_t len)
+{
+    uint32_t hash = rpc_dispatch_hash(name, len);
+    int i = hash & TABLE_MASK;
+
+    while (t->index[i] != EMPTY) {
+        if (t->hash[i] == hash
+            && strncmp(t->name[i], name, len) == 0
+            && t->name[i][len] == '\0') {
+            return t->index[i];
+        }
+        i = (i + 1) & TABLE_MASK;
+    }
+
+    return RPC_DISPATCH_NOT_FOUND;
+}
+
+/* Reads the method name or ID following the array header.
+ * Returns the method index or RPC_DISPATCH_NOT_FOUND. */
+static int read_method(const rpc_dispatch_table_t *t, int callbacks_len, cmp_ctx_t *ctx)
+{
+    char name[RPC_DISPATCH_NAME_MAX_LEN];
+    uint32_t array_len;
+    cmp_object_t obj;
+
+    if (!cmp_read_array(ctx, &array_len) || !cmp_read_object(ctx, &obj)) {
+        return RPC_DISPATCH_NOT_FOUND;
+    }
+
+    switch (obj.type) {
+        case CMP_TYPE_POSITIVE_FIXNUM:
+        case CMP_TYPE_UINT8:
+            if (obj.as.u8 < callbacks_len) {
+                return obj.as.u8;
+            }
+            return RPC_DISPATCH_NOT_FOUND;
+
+        case CMP_TYPE_FIXSTR:
+        case CMP_TYPE_STR8:
+        case CMP_TYPE_STR16:
+        case CMP_TYPE_STR32:
+            if (obj.as.str_size >= sizeof(name)) {
+                return RPC_DISPATCH_NOT_FOUND;
+            }
+            if (!ctx->read(ctx, name, obj.as.str_size)) {
+                return RPC_DISPATCH_NOT_FOUND;
+            }
+            return rpc_dispatch_table_find(t, name, obj.as.str_size);
+
+        default:
+            return RPC_DISPATCH_NOT_FOUND;
+    }
+}
+
+int message_dispatcher_init(message_dispatcher_t *d,
+                            struct message_method_s *callbacks,
+                            int callbacks_len)
+{
+    return message_dispatcher_init_subset(d, callbacks, callbacks_len, NULL);
+}
+
+int message_dispatcher_init_subset(message_dispatcher_t *d,
+                                   struct message_method_s *callbacks,
+                                   int callbacks_len,
+                                   const bool *accepted)
+{
+    int i;
+
+    d->callbacks = callbacks;
+    d->callbacks_len = callbacks_len;
+    d->accepted = accepted;
+    rpc_dispatch_table_init(&d->table);
+
+    for (i = 0; i < callbacks_len; i++) {
+        if (accepted != NULL && !accepted[i]) {
+            continue;
+        }
+        if (rpc_dispatch_table_add(&d->table, callbacks[i].name, i) != 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/* Names of other callbacks are not in the table, but their IDs are. */
+static int read_message_method(message_dispatcher_t *d, cmp_ctx_t *ctx)
+{
+    int i = read_method(&d->table, d->callbacks_len, ctx);
+
+    if (i != RPC_DISPATCH_NOT_FOUND && d->accepted != NULL && !d->accepted[i]) {
+        return RPC_DISPATCH_NOT_FOUND;
+    }
+    return i;
+}
+
+int message_dispatcher_lookup(message_dispatcher_t *d, uint8_t *buffer, size_t len)
+{
+    cmp_ctx_t ctx;
+    cmp_mem_access_t mem;
+
+    cmp_mem_access_ro_init(&ctx, &mem, buffer, len);
+
+    return read_message_method(d, &ctx);
+}
+
+bool message_dispatcher_process(message_dispatcher_t *d, uint8_t *buffer, size_t len)
+{
+    cmp_ctx_t ctx;
+    cmp_mem_access_t mem;
+    int i;
+
+    cmp_mem_access_ro_init(&ctx, &mem, buffer, len);
+
+    i = read_message_method(d, &ctx);
+    if (i == RPC_DISPATCH_NOT_FOUND) {
+        return false;
+    }
+
+    d->callbacks[i].cb(d->callbacks[i].arg, &ctx);
+    return true;
+}
+
+int service_call_dispatcher_init(service_call_dispatcher_t *d,
+                                 struct service_call_method_s *callbacks,
+                                 int callbacks_len)
+{
+    int i;
+
+    d->callbacks = callbacks;
+    d->callbacks_len = callbacks_len;
+    rpc_dispatch_table_init(&d->table);
+
+    for (i = 0; i < callbacks_len; i++) {
+        if (rpc_dispatch_table_add(&d->table, callbacks[i].name, i) != 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+size_t service_call_dispatcher_process(service_call_dispatcher_t *d,
+                                       const void *input_buffer,
+                                       size_t input_buffer_size,
+                                       void *output_buffer,
+                                       size_t output_buffer_size)
+{
+    cmp_ctx_t ctx;
+    cmp_mem_access_t mem;
+    int i;
+
+    cmp_mem_access_ro_init(&ctx, &mem, (void *)input_buffer, input_buffer_size);
+    i = read_method(&d->table, 0, &ctx);
+
+    /* SimpleRPC does the actual decoding and the reply, we only narrow down
+     * the callback list. Unknown methods get the usual error reply. */
+    if (i == RPC_DISPATCH_NOT_FOUND) {
+        return service_call_process(input_buffer, input_buffer_size,
+                                    output_buffer, output_buffer_size,
+                                    d->callbacks, d->callbacks_len);
+    }
+
+    return service_call_process(input_buffer, input_buffer_size,
+                                output_buffer, output_buffer_size,
+                                &d->callbacks[i], 1);
+}
@@ -0,0 +1,129 @@
+#ifndef RPC_DISPATCH_H
+#define RPC_DISPATCH_H
+
+/*
+
+# RPC dispatch
+
+Constant time lookup of SimpleRPC message and service call handlers.
+
+The tables store indices into the existing callback arrays, keyed by a hash of
+the method name computed once when the table is built. A lookup hashes the
+incoming name, probes the table and confirms the match with a single strcmp.
+
+Messages can also carry a positive integer instead of the method name. The
+integer is the index of the method in message_callbacks[], which skips the
+string handling altogether. Callback arrays must therefore only be appended
+to. A dispatcher accepting only some of the callbacks keeps their index, so
+that an ID names the same method on every port.
+
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <simplerpc/message.h>
+#include <simplerpc/service_call.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Must be a power of two, at least twice the number of methods. */
+#define RPC_DISPATCH_TABLE_SIZE     64
+#define RPC_DISPATCH_NAME_MAX_LEN   64
+#define RPC_DISPATCH_NOT_FOUND      -1
+
+typedef struct {
+    const char *name[RPC_DISPATCH_TABLE_SIZE];
+    uint32_t hash[RPC_DISPATCH_TABLE_SIZE];
+    int16_t index[RPC_DISPATCH_TABLE_SIZE];
+    int nb_entries;
+} rpc_dispatch_table_t;
+
+typedef struct {
+    rpc_dispatch_table_t table;
+    struct message_method_s *callbacks;
+    int callbacks_len;
+    const bool *accepted; /**< Callbacks which are dispatched, NULL for all. */
+} message_dispatcher_t;
+
+typedef struct {
+    rpc_dispatch_table_t table;
+    struct service_call_method_s *callbacks;
+    int callbacks_len;
+} service_call_dispatcher_t;
+
+/** Fails the build if a callback array does not fit in a table, which
+ * would otherwise only be found when the dispatcher is built at boot. */
+#define RPC_DISPATCH_CHECK_SIZE(callbacks) \
+    _Static_assert(2 * (sizeof(callbacks) / sizeof((callbacks)[0])) <= RPC_DISPATCH_TABLE_SIZE, \
+                   "RPC_DISPATCH_TABLE_SIZE is too small for " #callbacks)
+
+/** FNV-1a hash of the first len characters of name. */
+uint32_t rpc_dispatch_hash(const char *name, size_t len);
+
+void rpc_dispatch_table_init(rpc_dispatch_table_t *t);
+
+/** Adds a method name to the table, only a reference of name is stored.
+ *
+ * @return 0 on success, -1 if the table is full or the name already exists.
+ */
+int rpc_dispatch_table_add(rpc_dispatch_table_t *t, const char *name, int index);
+
+/** @return The index associated with name or RPC_DISPATCH_NOT_FOUND. */
+int rpc_dispatch_table_find(const rpc_dispatch_table_t *t, const char *name, size_t len);
+
+/** Builds the lookup table for the given message callbacks.
+ *
+ * @return 0 on success, -1 if the table is too small or names are duplicated.
+ */
+int message_dispatcher_init(message_dispatcher_t *d,
+                            struct message_method_s *callbacks,
+                            int callbacks_len);
+
+/** Same as message_dispatcher_init, but only dispatches the callbacks whose
+ * entry in accepted is true. Their numeric ID is still their index in
+ * callbacks. Only a reference of accepted is stored.
+ */
+int message_dispatcher_init_subset(message_dispatcher_t *d,
+                                   struct message_method_s *callbacks,
+                                   int callbacks_len,
+                                   const bool *accepted);
+
+/** Decodes the message header without calling anything.
+ *
+ * @return The index of the message in the callback array or
+ * RPC_DISPATCH_NOT_FOUND.
+ */
+int message_dispatcher_lookup(message_dispatcher_t *d, uint8_t *buffer, size_t len);
+
+/** Decodes the message header and calls the matching callback.
+ *
+ * @return true if a callback was found for the message.
+ */
+bool message_dispatcher_process(message_dispatcher_t *d, uint8_t *buffer, size_t len);
+
+/** Builds the lookup table for the given service call callbacks.
+ *
+ * @return 0 on success, -1 if the table is too small or names are duplicated.
+ */
+int service_call_dispatcher_init(service_call_dispatcher_t *d,
+                                 struct service_call_method_s *callbacks,
+                                 int callbacks_len);
+
+/** Processes a service call, with the same semantics as service_call_process.
+ *
+ * @return The number of bytes written to output_buffer.
+ */
+size_t service_call_dispatcher_process(service_call_dispatcher_t *d,
+                                       const void *input_buffer,
+                                       size_t input_buffer_size,
+                                       void *output_buffer,
+                                       size_t output_buffer_size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* RPC_DISPATCH_H */
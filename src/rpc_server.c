@@ -1,20 +1,88 @@
+#include <string.h>
 #include <lwip/api.h>
+#include <lwip/udp.h>
+#include <lwip/tcpip.h>
+#include <lwipthread.h>
+#include "timestamp/timestamp.h"
 #include <simplerpc/service_call.h>
 #include <simplerpc/message.h>
 #include <serial-datagram/serial_datagram.h>
 #include "rpc_server.h"
 #include "rpc_callbacks.h"
 #include "msg_callbacks.h"
+#include "rpc_dispatch.h"
+#include "msg_queue.h"
 
 #define RPC_SERVER_STACKSIZE 2048
 #define RPC_SERVER_PORT 20001
 #define MSG_SERVER_PORT 20000
+#define MSG_BUFFER_SIZE 4096
+
+/* Enough to read the method name of a message: array marker, string marker
+ * and the name itself. */
+#define MSG_HEADER_MAX_LEN (RPC_DISPATCH_NAME_MAX_LEN + 8)
+
+#define MSG_QUEUE_SETPOINT_DEPTH    2
+#define MSG_QUEUE_TRAJECTORY_DEPTH  6
+#define MSG_QUEUE_OTHER_DEPTH       2
+
+/* Pool pbufs holding a datagram of MSG_BUFFER_SIZE in the worst case: it
+ * arrives as IP fragments in full Ethernet frames, each of them copied to a
+ * chain of pool pbufs. */
+#define MSG_ETH_MTU                 1500
+#define MSG_FRAGMENT_LEN            ((MSG_ETH_MTU - IP_HLEN) & ~7)
+#define MSG_MAX_FRAGMENTS           ((MSG_BUFFER_SIZE + UDP_HLEN + MSG_FRAGMENT_LEN - 1) \
+                                     / MSG_FRAGMENT_LEN)
+#define MSG_PBUFS_PER_FRAME         ((PBUF_LINK_HLEN + MSG_ETH_MTU + PBUF_POOL_BUFSIZE - 1) \
+                                     / PBUF_POOL_BUFSIZE)
+#define MSG_MAX_DATAGRAM_PBUFS      (MSG_MAX_FRAGMENTS * MSG_PBUFS_PER_FRAME)
+
+/* Queued datagrams hold pbufs until they are processed. The queues are
+ * bounded in pbufs so that some of the pool is left to receive everything
+ * else, the RPC and real-time servers included. Trajectory chunks can be
+ * as large as MSG_BUFFER_SIZE, setpoints and commands fit in one pbuf. A
+ * datagram above the budget of its class is counted as oversized. */
+#define MSG_QUEUE_SETPOINT_PBUFS    2
+#define MSG_QUEUE_TRAJECTORY_PBUFS  MSG_MAX_DATAGRAM_PBUFS
+#define MSG_QUEUE_OTHER_PBUFS       2
+#define MSG_QUEUE_SPARE_PBUFS       4
+
+_Static_assert(MSG_QUEUE_SETPOINT_PBUFS + MSG_QUEUE_TRAJECTORY_PBUFS + MSG_QUEUE_OTHER_PBUFS
+               + MSG_QUEUE_SPARE_PBUFS <= PBUF_POOL_SIZE,
+               "The message queues can hold too much of the pbuf pool.");
 
 THD_WORKING_AREA(wa_rpc_server, RPC_SERVER_STACKSIZE);
 
 static uint8_t input_buffer[1024];
 static uint8_t output_buffer[1024];
 
+static service_call_dispatcher_t service_call_dispatcher;
+static message_dispatcher_t message_dispatcher;
+static message_dispatcher_t rt_message_dispatcher;
+
+static msg_latency_t queued_latency;
+static msg_latency_t raw_latency;
+
+/* Only the latest setpoint matters, but trajectory chunks and commands must
+ * not be lost silently: the sender is expected to retry those. */
+static const struct {
+    size_t depth;
+    size_t pbufs;
+    msg_queue_policy_t policy;
+} message_queue_config[MSG_CLASS_COUNT] = {
+    [MSG_CLASS_SETPOINT] = {MSG_QUEUE_SETPOINT_DEPTH, MSG_QUEUE_SETPOINT_PBUFS, MSG_QUEUE_DROP_OLDEST},
+    [MSG_CLASS_TRAJECTORY] = {MSG_QUEUE_TRAJECTORY_DEPTH, MSG_QUEUE_TRAJECTORY_PBUFS, MSG_QUEUE_REJECT},
+    [MSG_CLASS_OTHER] = {MSG_QUEUE_OTHER_DEPTH, MSG_QUEUE_OTHER_PBUFS, MSG_QUEUE_REJECT},
+};
+
+static msg_queue_t message_queues[MSG_CLASS_COUNT];
+static BSEMAPHORE_DECL(message_queued, true);
+static struct {
+    uint32_t received;
+    uint32_t oversized;
+    uint32_t decode_error;
+} message_stats;
+
 static bool method_called;
 static size_t output_bytes_written;
 
@@ -34,10 +102,9 @@ static void serial_datagram_recv_cb(const void *data, size_t len, void *arg)
     (void) arg;
     method_called = true;
 
-    output_bytes_written = service_call_process(data, len, output_buffer,
-                                                sizeof output_buffer,
-                                                service_call_callbacks,
-                                                service_call_callbacks_len);
+    output_bytes_written = service_call_dispatcher_process(&service_call_dispatcher,
+                                                           data, len, output_buffer,
+                                                           sizeof output_buffer);
 
 }
 
@@ -112,6 +179,12 @@ void rpc_server_thread(void *p)
 
 void rpc_server_init(void)
 {
+    if (service_call_dispatcher_init(&service_call_dispatcher,
+                                     service_call_callbacks,
+                                     service_call_callbacks_len) != 0) {
+        chSysHalt("service call dispatch table too small");
+    }
+
     chThdCreateStatic(wa_rpc_server,
                       RPC_SERVER_STACKSIZE,
                       RPC_SERVER_PRIO,
@@ -184,38 +257,181 @@ fail:
     return -1;
 }
 
-void message_server_thread(void *arg)
+static void latency_record(msg_latency_t *l)
 {
-    struct netconn *conn;
-    struct netbuf *buf;
-    static uint8_t buffer[4096];
-    err_t err;
-    LWIP_UNUSED_ARG(arg);
+    uint32_t dt = timestamp_get() - eth_last_rx_timestamp();
 
-    chRegSetThreadName("rpc_message");
+    chSysLock();
+    l->count++;
+    l->total_us += dt;
+    if (dt > l->max_us) {
+        l->max_us = dt;
+    }
+    chSysUnlock();
+}
 
-    conn = netconn_new(NETCONN_UDP);
-    if (conn == NULL) {
-        chSysHalt("Cannot create SimpleRPC message server connection (out of memory).");
+void message_server_get_latency(msg_latency_t *queued, msg_latency_t *raw)
+{
+    chSysLock();
+    *queued = queued_latency;
+    *raw = raw_latency;
+    memset(&queued_latency, 0, sizeof(queued_latency));
+    memset(&raw_latency, 0, sizeof(raw_latency));
+    chSysUnlock();
+}
+
+void message_server_get_stats(message_server_stats_t *stats)
+{
+    int i;
+
+    chSysLock();
+    stats->received = message_stats.received;
+    stats->oversized = message_stats.oversized;
+    stats->decode_error = message_stats.decode_error;
+    for (i = 0; i < MSG_CLASS_COUNT; i++) {
+        stats->dropped[i] = message_queues[i].dropped;
+    }
+    chSysUnlock();
+}
+
+/* Checks the size and the header of a datagram, returning the index of its
+ * callback or RPC_DISPATCH_NOT_FOUND if it must be discarded. */
+static int message_check(message_dispatcher_t *d, struct pbuf *p)
+{
+    uint8_t header[MSG_HEADER_MAX_LEN];
+    u16_t header_len;
+    int method;
+
+    chSysLock();
+    message_stats.received++;
+    chSysUnlock();
+
+    if (p->tot_len > MSG_BUFFER_SIZE) {
+        chSysLock();
+        message_stats.oversized++;
+        chSysUnlock();
+        return RPC_DISPATCH_NOT_FOUND;
+    }
+
+    header_len = pbuf_copy_partial(p, header, sizeof(header), 0);
+    method = message_dispatcher_lookup(d, header, header_len);
+    if (method == RPC_DISPATCH_NOT_FOUND) {
+        chSysLock();
+        message_stats.decode_error++;
+        chSysUnlock();
     }
-    netconn_bind(conn, NULL, MSG_SERVER_PORT);
+
+    return method;
+}
+
+/* Called by the tcpip thread for each datagram on MSG_SERVER_PORT. */
+static void message_recv_cb(void *arg, struct udp_pcb *pcb, struct pbuf *p,
+                            ip_addr_t *addr, u16_t port)
+{
+    int method;
+    msg_class_t msg_class;
+    u8_t nb_pbufs;
+    void *dropped;
+    (void) arg;
+    (void) pcb;
+    (void) addr;
+    (void) port;
+
+    method = message_check(&message_dispatcher, p);
+    if (method == RPC_DISPATCH_NOT_FOUND) {
+        pbuf_free(p);
+        return;
+    }
+
+    msg_class = message_callbacks_class[method];
+    nb_pbufs = pbuf_clen(p);
+    if (nb_pbufs > message_queue_config[msg_class].pbufs) {
+        // would never be admitted, even by an empty queue
+        chSysLock();
+        message_stats.oversized++;
+        chSysUnlock();
+        pbuf_free(p);
+        return;
+    }
+
+    chSysLock();
+    msg_queue_push(&message_queues[msg_class], p, nb_pbufs, &dropped);
+    chBSemSignalI(&message_queued);
+    chSchRescheduleS();
+    chSysUnlock();
+
+    if (dropped != NULL) {
+        pbuf_free((struct pbuf *)dropped);
+    }
+}
+
+/* Returns the next datagram to process, setpoints first. */
+static struct pbuf *message_queue_next(void)
+{
+    struct pbuf *p = NULL;
+    int i;
+
+    chSysLock();
+    for (i = 0; i < MSG_CLASS_COUNT && p == NULL; i++) {
+        p = msg_queue_pop(&message_queues[i]);
+    }
+    chSysUnlock();
+
+    return p;
+}
+
+void message_server_thread(void *arg)
+{
+    static uint8_t buffer[MSG_BUFFER_SIZE];
+    struct pbuf *p;
+    (void) arg;
+
+    chRegSetThreadName("rpc_message");
 
     while (1) {
-        err = netconn_recv(conn, &buf);
+        chBSemWait(&message_queued);
 
-        if (err == ERR_OK) {
-            if (netbuf_copy(buf, buffer, buf->p->tot_len) == 0) {
-                chSysHalt("udp message buffer too small");
-            }
-            message_process(buffer, buf->p->tot_len, message_callbacks, message_callbacks_len);
+        while ((p = message_queue_next()) != NULL) {
+            pbuf_copy_partial(p, buffer, p->tot_len, 0);
+            message_dispatcher_process(&message_dispatcher, buffer, p->tot_len);
+            latency_record(&queued_latency);
+            pbuf_free(p);
         }
-        netbuf_delete(buf);
     }
 }
 
+static void message_server_start(void *arg)
+{
+    struct udp_pcb *pcb;
+    (void) arg;
+
+    pcb = udp_new();
+    if (pcb == NULL) {
+        chSysHalt("Cannot create SimpleRPC message server (out of memory).");
+    }
+    udp_bind(pcb, IP_ADDR_ANY, MSG_SERVER_PORT);
+    udp_recv(pcb, message_recv_cb, NULL);
+}
+
 void message_server_init(void)
 {
     static THD_WORKING_AREA(wa_msg_server, 2048);
+    int i;
+
+    if (message_dispatcher_init(&message_dispatcher,
+                                message_callbacks,
+                                message_callbacks_len) != 0) {
+        chSysHalt("message dispatch table too small");
+    }
+
+    for (i = 0; i < MSG_CLASS_COUNT; i++) {
+        if (msg_queue_init(&message_queues[i],
+                           message_queue_config[i].depth,
+                           message_queue_config[i].pbufs,
+                           message_queue_config[i].policy) != 0) {
+            chSysHalt("invalid message queue depth");
+        }
+    }
 
     chThdCreateStatic(wa_msg_server,
                       2048,
@@ -223,6 +439,66 @@ void message_server_init(void)
                       message_server_thread,
                       NULL);
 
+    /* The raw API may only be used from the tcpip thread. */
+    tcpip_callback_with_block(message_server_start, NULL, 1);
+}
+
+/* Called by the tcpip thread for each datagram on RT_MSG_SERVER_PORT. */
+static void rt_message_recv_cb(void *arg, struct udp_pcb *pcb, struct pbuf *p,
+                               ip_addr_t *addr, u16_t port)
+{
+    static uint8_t buffer[MSG_BUFFER_SIZE];
+    (void) arg;
+    (void) pcb;
+    (void) addr;
+    (void) port;
+
+    if (message_check(&rt_message_dispatcher, p) != RPC_DISPATCH_NOT_FOUND) {
+        if (p->len == p->tot_len) {
+            /* Single segment, decode in place. */
+            message_dispatcher_process(&rt_message_dispatcher, p->payload, p->len);
+        } else {
+            pbuf_copy_partial(p, buffer, p->tot_len, 0);
+            message_dispatcher_process(&rt_message_dispatcher, buffer, p->tot_len);
+        }
+        latency_record(&raw_latency);
+    }
+
+    pbuf_free(p);
+}
+
+static void rt_message_server_start(void *arg)
+{
+    struct udp_pcb *pcb;
+    (void) arg;
+
+    pcb = udp_new();
+    if (pcb == NULL) {
+        chSysHalt("Cannot create real-time message server (out of memory).");
+    }
+    udp_bind(pcb, IP_ADDR_ANY, RT_MSG_SERVER_PORT);
+    udp_recv(pcb, rt_message_recv_cb, NULL);
+}
+
+void rt_message_server_init(void)
+{
+    /* Fits message_callbacks, whose size is checked against the table. */
+    static bool accepted[RPC_DISPATCH_TABLE_SIZE / 2];
+    int i;
+
+    for (i = 0; i < message_callbacks_len; i++) {
+        accepted[i] = message_callbacks_class[i] != MSG_CLASS_OTHER;
+    }
+
+    if (message_dispatcher_init_subset(&rt_message_dispatcher,
+                                       message_callbacks,
+                                       message_callbacks_len,
+                                       accepted) != 0) {
+        chSysHalt("real-time message dispatch table too small");
+    }
+
+    /* The raw API may only be used from the tcpip thread. */
+    tcpip_callback_with_block(rt_message_server_start, NULL, 1);
 }
 
 void message_transmit(uint8_t *input_buffer, size_t input_buffer_size, ip_addr_t *addr, uint16_t port)
@@ -1,14 +1,32 @@
 #ifndef RPC_SERVER_H
 #define RPC_SERVER_H
 
+#include <stdint.h>
+#include "msg_callbacks.h"
 
 #define RPC_SERVER_PORT 20001
 #define MSG_SERVER_PORT 20000
+#define RT_MSG_SERVER_PORT 20003
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+/** Receive-to-apply latency of a message server, in microseconds. */
+typedef struct {
+    uint32_t count;
+    uint32_t total_us;
+    uint32_t max_us;
+} msg_latency_t;
+
+/** Datagram counters of the message servers. */
+typedef struct {
+    uint32_t received;
+    uint32_t oversized;
+    uint32_t decode_error;
+    uint32_t dropped[MSG_CLASS_COUNT]; /**< Queue overflows, per message class. */
+} message_server_stats_t;
+
 /** Starts the Remote Procedure Call server. */
 void rpc_server_init(void);
 
@@ -30,8 +48,34 @@ size_t rpc_transmit(uint8_t *input_buffer, size_t input_buffer_size,
 
 void message_transmit(uint8_t *input_buffer, size_t input_buffer_size, ip_addr_t *addr, uint16_t port);
 
+/** Starts the message server.
+ *
+ * Datagrams are sorted by message class into bounded queues, which are
+ * drained by the message thread, setpoints first. Oversized and undecodable
+ * datagrams are dropped and counted.
+ */
 void message_server_init(void);
 
+/** Starts the real-time message server.
+ *
+ * Messages on RT_MSG_SERVER_PORT are decoded by a raw UDP callback in the
+ * tcpip thread, straight from the received pbuf. Only setpoints and
+ * trajectories are accepted there, with the same method IDs as on
+ * MSG_SERVER_PORT, see message_callbacks_class.
+ */
+void rt_message_server_init(void);
+
+/** Copies and clears the latency figures of the queued message server and of
+ * the real-time one.
+ *
+ * Latency is measured from the moment the Ethernet driver took the last frame
+ * from the MAC, so it is only meaningful when messages are sent one by one.
+ */
+void message_server_get_latency(msg_latency_t *queued, msg_latency_t *raw);
+
+/** Copies the datagram counters of both message servers. */
+void message_server_get_stats(message_server_stats_t *stats);
+
 
 #ifdef __cplusplus
 }
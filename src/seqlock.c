@@ -0,0 +1,46 @@
+#include "seqlock.h"
+
+void seqlock_init(seqlock_t *l)
+{
+    __atomic_store_n(&l->seq, 0, __ATOMIC_RELAXED);
+}
+
+void seqlock_write_begin(seqlock_t *l)
+{
+    uint32_t seq = __atomic_load_n(&l->seq, __ATOMIC_RELAXED);
+
+    __atomic_store_n(&l->seq, seq + 1, __ATOMIC_RELAXED);
+    /* Keeps the data stores after the counter update. */
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+void seqlock_write_end(seqlock_t *l)
+{
+    uint32_t seq = __atomic_load_n(&l->seq, __ATOMIC_RELAXED);
+
+    __atomic_store_n(&l->seq, seq + 1, __ATOMIC_RELEASE);
+}
+
+uint32_t seqlock_read_begin(const seqlock_t *l)
+{
+    uint32_t seq;
+
+    do {
+        seq = __atomic_load_n(&l->seq, __ATOMIC_ACQUIRE);
+    } while (seq & 1);
+
+    return seq;
+}
+
+bool seqlock_read_retry(const seqlock_t *l, uint32_t start)
+{
+    /* Keeps the data loads before the counter check. */
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+
+    return __atomic_load_n(&l->seq, __ATOMIC_RELAXED) != start;
+}
+
+uint32_t seqlock_write_count(const seqlock_t *l)
+{
+    return __atomic_load_n(&l->seq, __ATOMIC_ACQUIRE) / 2;
+}
@@ -0,0 +1,53 @@
+#ifndef SEQLOCK_H
+#define SEQLOCK_H
+
+/*
+
+# Sequence lock
+
+Lets a single writer publish a small structure to any number of readers
+without ever waiting for them. The writer bumps a counter before and after
+updating the data, readers copy the data and retry if the counter was odd
+or changed meanwhile:
+
+    do {
+        seq = seqlock_read_begin(&lock);
+        copy = data;
+    } while (seqlock_read_retry(&lock, seq));
+
+On a single core, a reader which preempts the writer in the middle of an
+update would spin forever. Writers which can be preempted by readers must
+therefore update the data in a critical section.
+
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+    uint32_t seq;
+} seqlock_t;
+
+void seqlock_init(seqlock_t *l);
+
+void seqlock_write_begin(seqlock_t *l);
+void seqlock_write_end(seqlock_t *l);
+
+/** @return The counter value to pass to seqlock_read_retry. */
+uint32_t seqlock_read_begin(const seqlock_t *l);
+
+/** @return true if the data read since seqlock_read_begin may be torn. */
+bool seqlock_read_retry(const seqlock_t *l, uint32_t start);
+
+/** @return Number of completed writes. */
+uint32_t seqlock_write_count(const seqlock_t *l);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SEQLOCK_H */
@@ -0,0 +1,33 @@
+#include <math.h>
+#include "setpoint_filter.h"
+
+void setpoint_filter_init(setpoint_filter_t *f)
+{
+    f->valid = false;
+    f->mode = 0;
+    f->value = 0;
+    f->last_sent_us = 0;
+    f->sent = 0;
+    f->suppressed = 0;
+}
+
+bool setpoint_filter_should_send(setpoint_filter_t *f, int mode, float value,
+                                 uint32_t now_us, float deadband,
+                                 uint32_t keepalive_us)
+{
+    if (keepalive_us != 0
+        && f->valid
+        && f->mode == mode
+        && fabsf(value - f->value) <= deadband
+        && now_us - f->last_sent_us < keepalive_us) {
+        f->suppressed++;
+        return false;
+    }
+
+    f->valid = true;
+    f->mode = mode;
+    f->value = value;
+    f->last_sent_us = now_us;
+    f->sent++;
+    return true;
+}
@@ -0,0 +1,47 @@
+#ifndef SETPOINT_FILTER_H
+#define SETPOINT_FILTER_H
+
+/*
+
+# Setpoint filter
+
+Suppresses the transmission of setpoints which did not change by more than a
+deadband since the last one sent. The setpoint is still repeated every
+keepalive period, so that the motor board can detect a lost master with a
+timeout longer than that period.
+
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+    bool valid;            /**< False until a setpoint was sent. */
+    int mode;
+    float value;
+    uint32_t last_sent_us;
+    uint32_t sent;
+    uint32_t suppressed;
+} setpoint_filter_t;
+
+void setpoint_filter_init(setpoint_filter_t *f);
+
+/** Decides whether a setpoint must be sent, and counts the outcome.
+ *
+ * A setpoint is sent when the control mode changed, when it differs by more
+ * than deadband from the last sent value, or when keepalive_us elapsed since
+ * the last transmission. A keepalive of 0 disables the filter.
+ */
+bool setpoint_filter_should_send(setpoint_filter_t *f, int mode, float value,
+                                 uint32_t now_us, float deadband,
+                                 uint32_t keepalive_us);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SETPOINT_FILTER_H */
@@ -0,0 +1,92 @@
+#include "setpoint_scheduler.h"
+
+static bool is_before(uint32_t a, uint32_t b)
+{
+    return (int32_t)(a - b) < 0;
+}
+
+static void swap(setpoint_scheduler_entry_t *a, setpoint_scheduler_entry_t *b)
+{
+    setpoint_scheduler_entry_t tmp = *a;
+    *a = *b;
+    *b = tmp;
+}
+
+void setpoint_scheduler_init(setpoint_scheduler_t *s,
+                             setpoint_scheduler_entry_t *buffer,
+                             uint16_t len)
+{
+    s->heap = buffer;
+    s->len = len;
+    s->count = 0;
+}
+
+int setpoint_scheduler_add(setpoint_scheduler_t *s, uint16_t id, uint32_t due_us)
+{
+    if (s->count == s->len) {
+        return -1;
+    }
+
+    int i = s->count++;
+    s->heap[i].due_us = due_us;
+    s->heap[i].id = id;
+
+    while (i > 0) {
+        int parent = (i - 1) / 2;
+        if (!is_before(s->heap[i].due_us, s->heap[parent].due_us)) {
+            break;
+        }
+        swap(&s->heap[i], &s->heap[parent]);
+        i = parent;
+    }
+
+    return 0;
+}
+
+bool setpoint_scheduler_pop_due(setpoint_scheduler_t *s, uint32_t now_us, uint16_t *id)
+{
+    if (s->count == 0 || is_before(now_us, s->heap[0].due_us)) {
+        return false;
+    }
+
+    *id = s->heap[0].id;
+    s->heap[0] = s->heap[--s->count];
+
+    int i = 0;
+    while (1) {
+        int left = 2 * i + 1;
+        int right = left + 1;
+        int earliest = i;
+        if (left < s->count && is_before(s->heap[left].due_us, s->heap[earliest].due_us)) {
+            earliest = left;
+        }
+        if (right < s->count && is_before(s->heap[right].due_us, s->heap[earliest].due_us)) {
+            earliest = right;
+        }
+        if (earliest == i) {
+            break;
+        }
+        swap(&s->heap[i], &s->heap[earliest]);
+        i = earliest;
+    }
+
+    return true;
+}
+
+bool setpoint_scheduler_next_due(const setpoint_scheduler_t *s, uint32_t *due_us)
+{
+    if (s->count == 0) {
+        return false;
+    }
+    *due_us = s->heap[0].due_us;
+    return true;
+}
+
+uint32_t setpoint_scheduler_next_slot(uint32_t now_us, uint32_t period_us, uint32_t phase_us)
+{
+    if (period_us == 0) {
+        return now_us + 1;
+    }
+    uint32_t elapsed = (now_us - phase_us) % period_us;
+    return now_us - elapsed + period_us;
+}
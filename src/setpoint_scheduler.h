@@ -0,0 +1,72 @@
+#ifndef SETPOINT_SCHEDULER_H
+#define SETPOINT_SCHEDULER_H
+
+/*
+
+# Setpoint scheduler
+
+Priority queue of motor drivers keyed on the time their next setpoint is due,
+so that the UAVCAN loop only touches the drivers which have something to
+send.
+
+Every driver gets a fixed phase and is always scheduled on a multiple of its
+period shifted by that phase. Drivers sharing a period with different phases
+are therefore spread over the period instead of all transmitting in the same
+spin.
+
+Times are 32 bit microsecond timestamps and are compared wrap-safe, so all
+due times must be within 2^31 us of each other. No locking is done.
+
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+    uint32_t due_us;
+    uint16_t id;
+} setpoint_scheduler_entry_t;
+
+typedef struct {
+    setpoint_scheduler_entry_t *heap;
+    uint16_t len;
+    uint16_t count;
+} setpoint_scheduler_t;
+
+/** Initializes an empty scheduler using buffer to store up to len entries. */
+void setpoint_scheduler_init(setpoint_scheduler_t *s,
+                             setpoint_scheduler_entry_t *buffer,
+                             uint16_t len);
+
+/** Schedules id at the given time.
+ *
+ * @return 0 on success, -1 if the scheduler is full.
+ */
+int setpoint_scheduler_add(setpoint_scheduler_t *s, uint16_t id, uint32_t due_us);
+
+/** Removes the earliest entry if it is due at time now.
+ *
+ * @param [out] id Set to the id of the removed entry.
+ * @return true if an entry was due.
+ */
+bool setpoint_scheduler_pop_due(setpoint_scheduler_t *s, uint32_t now_us, uint16_t *id);
+
+/** Gets the due time of the earliest entry.
+ *
+ * @return false if the scheduler is empty.
+ */
+bool setpoint_scheduler_next_due(const setpoint_scheduler_t *s, uint32_t *due_us);
+
+/** Computes the first time strictly after now which is phase_us plus a
+ * multiple of period_us. */
+uint32_t setpoint_scheduler_next_slot(uint32_t now_us, uint32_t period_us, uint32_t phase_us);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SETPOINT_SCHEDULER_H */
@@ -0,0 +1,52 @@
+#include <string.h>
+#include "spsc_queue.h"
+
+static void *slot(spsc_queue_t *q, uint32_t count)
+{
+    return &q->buffer[(count & (q->len - 1)) * q->item_size];
+}
+
+int spsc_queue_init(spsc_queue_t *q, void *buffer, size_t item_size, uint32_t len)
+{
+    if (len == 0 || (len & (len - 1)) != 0) {
+        return -1;
+    }
+
+    q->buffer = buffer;
+    q->item_size = item_size;
+    q->len = len;
+    q->head = 0;
+    q->tail = 0;
+
+    return 0;
+}
+
+bool spsc_queue_push(spsc_queue_t *q, const void *item)
+{
+    uint32_t head = __atomic_load_n(&q->head, __ATOMIC_RELAXED);
+    uint32_t tail = __atomic_load_n(&q->tail, __ATOMIC_ACQUIRE);
+
+    if (head - tail == q->len) {
+        return false;
+    }
+
+    memcpy(slot(q, head), item, q->item_size);
+    __atomic_store_n(&q->head, head + 1, __ATOMIC_RELEASE);
+
+    return true;
+}
+
+bool spsc_queue_pop(spsc_queue_t *q, void *item)
+{
+    uint32_t tail = __atomic_load_n(&q->tail, __ATOMIC_RELAXED);
+    uint32_t head = __atomic_load_n(&q->head, __ATOMIC_ACQUIRE);
+
+    if (head == tail) {
+        return false;
+    }
+
+    memcpy(item, slot(q, tail), q->item_size);
+    __atomic_store_n(&q->tail, tail + 1, __ATOMIC_RELEASE);
+
+    return true;
+}
@@ -0,0 +1,54 @@
+#ifndef SPSC_QUEUE_H
+#define SPSC_QUEUE_H
+
+/*
+
+# Single producer, single consumer queue
+
+Lock-free FIFO of fixed size items, for handing data from one thread to
+another without either of them ever waiting for the other. Only one thread
+may push and only one thread may pop.
+
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+    uint8_t *buffer;
+    size_t item_size;
+    uint32_t len;
+    uint32_t head; /**< Number of pushed items, written by the producer only. */
+    uint32_t tail; /**< Number of popped items, written by the consumer only. */
+} spsc_queue_t;
+
+/** Initializes an empty queue storing up to len items of item_size bytes.
+ *
+ * @param [in] buffer Storage of len * item_size bytes.
+ *
+ * @return 0 on success, -1 if len is not a power of two.
+ */
+int spsc_queue_init(spsc_queue_t *q, void *buffer, size_t item_size, uint32_t len);
+
+/** Copies an item into the queue.
+ *
+ * @return false if the queue is full.
+ */
+bool spsc_queue_push(spsc_queue_t *q, const void *item);
+
+/** Copies the oldest item out of the queue.
+ *
+ * @return false if the queue is empty.
+ */
+bool spsc_queue_pop(spsc_queue_t *q, void *item);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SPSC_QUEUE_H */
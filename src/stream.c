@@ -12,12 +12,52 @@
 #include "motor_manager.h"
 #include "main.h"
 #include "priorities.h"
+#include "uavcan_node.h"
+#include "timestamp/timestamp.h"
 
 #define STREAM_STACKSIZE 1024
 #define TOPIC_NAME_LEN   40
 
+#define NODE_TABLE_PERIOD_MS 1000
+
 THD_WORKING_AREA(wa_stream, STREAM_STACKSIZE);
 
+/* Sends the nodes seen on the bus as a map of node ID to
+ * [online, uptime [s], health, mode, reboots]. */
+static void stream_node_table(ip_addr_t *server)
+{
+    static uint8_t buffer[NODE_TRACKER_NB_NODES * 14];
+    cmp_ctx_t ctx;
+    cmp_mem_access_t mem;
+    node_tracker_entry_t node;
+    uint32_t nb_seen = 0;
+    uint32_t now = timestamp_get();
+    int id;
+
+    for (id = 0; id < NODE_TRACKER_NB_NODES; id++) {
+        if (uavcan_node_get_node_status(id, &node)) {
+            nb_seen++;
+        }
+    }
+
+    message_write_header(&ctx, &mem, buffer, sizeof(buffer), "uavcan/nodes");
+    cmp_write_map(&ctx, nb_seen);
+    for (id = 0; id < NODE_TRACKER_NB_NODES && nb_seen > 0; id++) {
+        if (!uavcan_node_get_node_status(id, &node)) {
+            continue;
+        }
+        nb_seen--;
+        cmp_write_uint(&ctx, id);
+        cmp_write_array(&ctx, 5);
+        cmp_write_bool(&ctx, now - node.last_seen_us < NODE_TRACKER_OFFLINE_TIMEOUT_US);
+        cmp_write_uint(&ctx, node.uptime_s);
+        cmp_write_uint(&ctx, node.health);
+        cmp_write_uint(&ctx, node.mode);
+        cmp_write_uint(&ctx, node.reboots);
+    }
+    message_transmit(buffer, cmp_mem_access_get_pos(&mem), server, STREAM_PORT);
+}
+
 static void stream_thread(void *p)
 {
     chRegSetThreadName("stream");
@@ -31,6 +71,8 @@ static void stream_thread(void *p)
 
     STREAM_HOST(&server);
 
+    uint32_t can_load_windows = 0;
+    systime_t last_node_table = chVTGetSystemTime();
 
     while (1) {
         motor_driver_t *drv_list;
@@ -144,6 +186,22 @@ static void stream_thread(void *p)
             }
         }
 
+        float utilization, rate_scale;
+        uint32_t windows = uavcan_node_get_bus_utilization(&utilization, &rate_scale);
+        if (windows != can_load_windows) {
+            can_load_windows = windows;
+            message_write_header(&ctx, &mem, buffer, sizeof(buffer), "can/load");
+            cmp_write_array(&ctx, 2);
+            cmp_write_float(&ctx, utilization);
+            cmp_write_float(&ctx, rate_scale);
+            message_transmit(buffer, cmp_mem_access_get_pos(&mem), &server, STREAM_PORT);
+        }
+
+        if (chVTTimeElapsedSinceX(last_node_table) >= MS2ST(NODE_TABLE_PERIOD_MS)) {
+            last_node_table = chVTGetSystemTime();
+            stream_node_table(&server);
+        }
+
         chThdSleepMilliseconds(STREAM_TIMESTEP_MS);
     }
 }
@@ -154,3 +154,26 @@ float* trajectory_read(trajectory_t *traj, int64_t time)
 
     return &traj->buffer[traj->read_index * traj->dimension];
 }
+
+float* trajectory_peek(const trajectory_t *traj, int64_t time)
+{
+    int offset = (time - traj->read_time_us + 0.5 * traj->sampling_time_us) / traj->sampling_time_us;
+
+    if (time > traj->last_defined_time_us) {
+        return NULL;
+    }
+
+    if (time < traj->read_time_us) {
+        return NULL;
+    }
+
+    int index = (traj->read_index + offset) % traj->length;
+
+    return &traj->buffer[index * traj->dimension];
+}
+
+bool trajectory_segment_sampling_time_ok(int64_t sampling_time_us)
+{
+    return sampling_time_us > 0
+           && sampling_time_us <= TRAJECTORY_SEGMENT_MAX_SAMPLING_TIME_US;
+}
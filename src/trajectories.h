@@ -6,12 +6,16 @@ extern "C" {
 #endif
 
 #include <stdint.h>
+#include <stdbool.h>
 
 #define TRAJECTORY_ERROR_TIMESTEP_MISMATCH          -1
 #define TRAJECTORY_ERROR_CHUNK_TOO_OLD              -2
 #define TRAJECTORY_ERROR_DIMENSION_MISMATCH         -3
 #define TRAJECTORY_ERROR_CHUNK_OUT_OF_ORER          -4
 
+/* Largest sampling time of a cvra.TrajectorySegment, a uint16 in us. */
+#define TRAJECTORY_SEGMENT_MAX_SAMPLING_TIME_US     0xFFFF
+
 typedef struct {
     float *buffer;
     int length;
@@ -90,6 +94,19 @@ int trajectory_apply_chunk(trajectory_t *traj, const trajectory_chunk_t *chunk);
  */
 float* trajectory_read(trajectory_t *traj, int64_t time);
 
+/** Reads the point of the trajectory at the given time without consuming it.
+ *
+ * @returns A pointer to the first field of the point nearest to time, or NULL
+ * if time is before the read pointer or after the last defined point.
+ * @note Unlike trajectory_read, this leaves the read pointer untouched.
+ */
+float* trajectory_peek(const trajectory_t *traj, int64_t time);
+
+/** Tells whether points with the given sampling time can be sent in a
+ * cvra.TrajectorySegment, otherwise they must be sent one by one.
+ */
+bool trajectory_segment_sampling_time_ok(int64_t sampling_time_us);
+
 
 #ifdef __cplusplus
 }
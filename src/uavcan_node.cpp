@@ -3,6 +3,7 @@
 #include <hal.h>
 #include <uavcan_stm32/uavcan_stm32.hpp>
 #include <uavcan/protocol/NodeStatus.hpp>
+#include <uavcan/protocol/dynamic_node_id/Allocation.hpp>
 #include <lwip/api.h>
 #include <cvra/motor/EmergencyStop.hpp>
 #include <cvra/motor/feedback/CurrentPID.hpp>
@@ -14,28 +15,66 @@
 #include <cvra/motor/feedback/MotorTorque.hpp>
 #include <cvra/Reboot.hpp>
 #include <cvra/StringID.hpp>
+#include <uavcan/protocol/global_time_sync_master.hpp>
 #include <cvra/proximity_beacon/Signal.hpp>
-#include "robot_pose.h"
 #include <simplerpc/message.h>
 #include "src/rpc_server.h"
-#include "robot_parameters.h"
 #include "timestamp/timestamp.h"
-#include "odometry/robot_base.h"
 #include "motor_driver.h"
 #include "motor_driver_uavcan.h"
-#include "odometry/odometry.h"
 #include "config.h"
 #include "uavcan_node_private.hpp"
 #include "uavcan_node.h"
 #include "node_tracker.h"
+#include "can_bridge_server.h"
+#include "can_capture.h"
+#include "firmware_update_server.h"
 #include "main.h"
+#include "wheel_odometry.h"
+#include "unix_timestamp.h"
+#include "setpoint_scheduler.h"
+#include "can_load.h"
+#include "node_id_cache.h"
+#include "node_id_allocator.h"
+#include "flash.h"
+#include "priorities.h"
+#include "log.h"
 
 #include <errno.h>
+#include <cstdlib>
+#include <cmath>
+#include <cstring>
 
 
 #define UAVCAN_SPIN_FREQ    500 // [Hz]
 
+/* Phase shift between the setpoint slots of two consecutive drivers. */
+#define UAVCAN_SETPOINT_STAGGER_US  (1000000 / UAVCAN_SPIN_FREQ)
+
+#define CONFIG_UPDATED_EVENT EVENT_MASK(0)
+
+#define CAN_LOAD_WINDOW_US      100000
+#define CAN_LOAD_MAX_RATE_SCALE 4.f
+
 #define UAVCAN_NODE_STACK_SIZE 8192
+#define UAVCAN_TX_STACK_SIZE 4096
+
+/* Filler frames use the lowest priority and a vendor specific data type
+ * which no node subscribes to. */
+#define SYNTHETIC_LOAD_PRIORITY         31
+#define SYNTHETIC_LOAD_DATA_TYPE_ID     20999
+/* A stalled loop does not catch up with a burst of frames. */
+#define SYNTHETIC_LOAD_MAX_BURST        16
+
+#define NODE_ID_CACHE_SECTOR        11
+/* Below this, the cache is compacted at boot rather than running full. */
+#define NODE_ID_CACHE_MIN_FREE      64
+/* String IDs and unique IDs kept when compacting the cache. */
+#define NODE_ID_CACHE_MAX_NODES     128
+
+/* Defined by the linker script. */
+extern "C" uint8_t __node_id_cache_start__[];
+extern "C" uint8_t __node_id_cache_size__[];
 
 
 bus_enumerator_t bus_enumerator;
@@ -46,9 +85,47 @@ namespace uavcan_node
 
 uint8_t reboot_node_id = 0;
 
+/* Cached so that encoder samples can be sorted without looking up the bus
+ * enumerator for each frame. Refreshed whenever a node is identified. */
+static uint8_t right_wheel_id = BUS_ENUMERATOR_CAN_ID_NOT_SET;
+static uint8_t left_wheel_id = BUS_ENUMERATOR_CAN_ID_NOT_SET;
+
 static void node_status_cb(const uavcan::ReceivedDataStructure<uavcan::protocol::NodeStatus>& msg);
+static void update_wheel_ids(void);
+static void time_sync_discipline(void);
+
+static uavcan_time_sync_stats_t time_sync_stats;
 static void node_fail(const char *reason);
 
+/* The type table of can_load is too large to be copied with interrupts
+ * masked. */
+static MUTEX_DECL(can_load_lock);
+static can_load_t can_load;
+static float rate_scale = 1;
+
+/* The node is not thread safe, the RX and TX threads take turns using it. */
+static mutex_t node_lock;
+
+static can_priority_stats_t priority_stats;
+static latency_histogram_t rx_latency;
+static latency_histogram_t tx_latency;
+static volatile uint32_t synthetic_load_rate = 0;
+
+static bool actuators_ready = false;
+static uint32_t actuators_time_to_ready_ms;
+
+static node_id_cache_t node_id_cache;
+static uavcan_node_id_cache_stats_t node_id_cache_stats;
+static void node_id_cache_open(void);
+
+static node_tracker_t node_tracker;
+
+static node_id_allocation_t allocation_table[NODE_ID_ALLOCATOR_MAX_NODE_ID];
+static node_id_allocator_t allocator;
+static void allocator_start(uint8_t own_node_id);
+static void preload_can_id(motor_driver_t *d);
+static void identify_node(const char *str_id, uint8_t can_id);
+
 
 static constexpr int RxQueueSize = 64;
 static constexpr std::uint32_t BitRate = 1000000;
@@ -56,11 +133,118 @@ static constexpr std::uint32_t BitRate = 1000000;
 constexpr unsigned NodeMemoryPoolSize = 16384;
 typedef uavcan::Node<NodeMemoryPoolSize> Node;
 
+/* Timestamp of a frame in the clock of the timestamp module. */
+static uint32_t frame_time(uavcan::MonotonicTime ts_monotonic);
+static void tap_frame(const uavcan::CanFrame& frame, uint32_t timestamp, uint8_t flags);
+static void send_injected_frames(Node& node);
+static void send_synthetic_load(Node& node);
+static void wait_for_frames(Node& node, uint32_t timeout_us);
+static void tx_main(void *arg);
+
 uavcan::ISystemClock& getSystemClock()
 {
     return uavcan_stm32::SystemClock::instance();
 }
 
+/* Forwards to the interface of the STM32 driver, accounting for every frame
+ * sent or received in can_load and handing it to the CAN bridge and to the
+ * CAN recorder. */
+class CanLoadIface : public uavcan::ICanIface
+{
+public:
+    uavcan::ICanIface *iface;
+
+    int16_t send(const uavcan::CanFrame& frame, uavcan::MonotonicTime tx_deadline,
+                 uavcan::CanIOFlags flags) override
+    {
+        int16_t res = iface->send(frame, tx_deadline, flags);
+        if (res > 0 && frame.isExtended()) {
+            uint32_t id = frame.id & uavcan::CanFrame::MaskExtID;
+            uint8_t tail_byte = frame.dlc > 0 ? frame.data[frame.dlc - 1] : 0;
+            chMtxLock(&can_load_lock);
+            can_load_record(&can_load, id, frame.dlc, true);
+            chMtxUnlock(&can_load_lock);
+            chSysLock();
+            can_priority_frame_sent(&priority_stats, id, tail_byte, timestamp_get());
+            chSysUnlock();
+        }
+        if (res > 0) {
+            tap_frame(frame, timestamp_get(), CAN_BRIDGE_FLAG_TX);
+        }
+        return res;
+    }
+
+    int16_t receive(uavcan::CanFrame& out_frame, uavcan::MonotonicTime& out_ts_monotonic,
+                    uavcan::UtcTime& out_ts_utc, uavcan::CanIOFlags& out_flags) override
+    {
+        int16_t res = iface->receive(out_frame, out_ts_monotonic, out_ts_utc, out_flags);
+        // loopback frames were already counted when sent
+        if (res > 0 && out_frame.isExtended() && !(out_flags & uavcan::CanIOFlagLoopback)) {
+            chMtxLock(&can_load_lock);
+            can_load_record(&can_load, out_frame.id & uavcan::CanFrame::MaskExtID, out_frame.dlc, false);
+            chMtxUnlock(&can_load_lock);
+        }
+        if (res > 0 && !(out_flags & uavcan::CanIOFlagLoopback)) {
+            uint32_t rx_time = frame_time(out_ts_monotonic);
+            chSysLock();
+            latency_histogram_record(&rx_latency, timestamp_get() - rx_time);
+            chSysUnlock();
+            tap_frame(out_frame, rx_time, 0);
+        }
+        return res;
+    }
+
+    int16_t configureFilters(const uavcan::CanFilterConfig* filter_configs,
+                             uint16_t num_configs) override
+    {
+        return iface->configureFilters(filter_configs, num_configs);
+    }
+
+    uint16_t getNumFilters() const override
+    {
+        return iface->getNumFilters();
+    }
+
+    uint64_t getErrorCount() const override
+    {
+        return iface->getErrorCount();
+    }
+};
+
+class CanLoadDriver : public uavcan::ICanDriver
+{
+    uavcan::ICanDriver& driver;
+    CanLoadIface ifaces[uavcan::MaxCanIfaces];
+
+public:
+    CanLoadDriver(uavcan::ICanDriver& drv) : driver(drv)
+    {
+        for (uint8_t i = 0; i < driver.getNumIfaces(); i++) {
+            ifaces[i].iface = driver.getIface(i);
+        }
+    }
+
+    uavcan::ICanIface* getIface(uint8_t iface_index) override
+    {
+        if (iface_index >= driver.getNumIfaces()) {
+            return nullptr;
+        }
+        return &ifaces[iface_index];
+    }
+
+    uint8_t getNumIfaces() const override
+    {
+        return driver.getNumIfaces();
+    }
+
+    int16_t select(uavcan::CanSelectMasks& inout_masks,
+                   const uavcan::CanFrame* (& pending_tx)[uavcan::MaxCanIfaces],
+                   uavcan::MonotonicTime blocking_deadline) override
+    {
+        return driver.select(inout_masks, pending_tx, blocking_deadline);
+    }
+};
+
 uavcan::ICanDriver& getCanDriver()
 {
     static uavcan_stm32::CanInitHelper<RxQueueSize> can;
@@ -72,7 +256,8 @@ uavcan::ICanDriver& getCanDriver()
             node_fail("CAN driver");
         }
     }
-    return can.driver;
+    static CanLoadDriver load_driver(can.driver);
+    return load_driver;
 }
 
 Node& getNode()
@@ -81,16 +266,46 @@ Node& getNode()
     return node;
 }
 
+uavcan::TransferPriority transferPriority(can_priority_class_t c)
+{
+    return uavcan::TransferPriority(can_priority_of_class[c]);
+}
+
+void transferSubmitted(can_priority_class_t c)
+{
+    uint32_t now = timestamp_get();
+    chSysLock();
+    can_priority_expire(&priority_stats, now);
+    can_priority_submitted(&priority_stats, c, now);
+    chSysUnlock();
+}
+
+void transferCancelled(can_priority_class_t c)
+{
+    chSysLock();
+    can_priority_cancelled(&priority_stats, c);
+    chSysUnlock();
+}
+
 THD_WORKING_AREA(thread_wa, UAVCAN_NODE_STACK_SIZE);
 
+static THD_WORKING_AREA(tx_thread_wa, UAVCAN_TX_STACK_SIZE);
+
+/* Handles received frames and the housekeeping of the node. Setpoints and
+ * configuration are sent by tx_main. */
 void main(void *arg)
 {
-    chRegSetThreadName("uavcan");
+    chRegSetThreadName("uavcan_rx");
+
+    node_tracker_init(&node_tracker);
+    can_priority_init(&priority_stats);
+    node_id_cache_open();
 
     Node& node = getNode();
 
     uint8_t id = *(uint8_t *)arg;
     node.setNodeID(uavcan::NodeID(id));
+    allocator_start(id);
 
     node.setName("cvra.master");
 
@@ -108,25 +323,6 @@ void main(void *arg)
         node_fail("node start");
     }
 
-    /*
-     * Initialising odometry
-     */
-    static odometry_differential_base_t robot_base;
-    struct robot_base_pose_2d_s init_pose = {0.0f, 0.0f, 0.0f};
-    odometry_base_init(&robot_base,
-                       init_pose,
-                       ROBOT_RIGHT_WHEEL_DIRECTION * config_get_scalar("/master/odometry/radius_right"),
-                       ROBOT_LEFT_WHEEL_DIRECTION * config_get_scalar("/master/odometry/radius_left"),
-                       1,
-                       1,
-                       config_get_scalar("/master/odometry/wheelbase"),
-                       timestamp_get());
-
-    static odometry_encoder_sample_t enc_right;
-    static odometry_encoder_sample_t enc_left;
-    odometry_encoder_record_sample(&enc_right, 0, 0);
-    odometry_encoder_record_sample(&enc_left, 0, 0);
-
     /*
      * NodeStatus subscriber
      */
@@ -136,11 +332,54 @@ void main(void *arg)
         node_fail("NodeStatus subscribe");
     }
 
+    /*
+     * Dynamic node ID allocation server
+     */
+    uavcan::Publisher<uavcan::protocol::dynamic_node_id::Allocation> allocation_pub(node);
+    res = allocation_pub.init();
+    if (res < 0) {
+        node_fail("uavcan::protocol::dynamic_node_id::Allocation publisher");
+    }
+
+    uavcan::Subscriber<uavcan::protocol::dynamic_node_id::Allocation> allocation_sub(node);
+    allocation_sub.allowAnonymousTransfers();
+    res = allocation_sub.start(
+        [&](const uavcan::ReceivedDataStructure<uavcan::protocol::dynamic_node_id::Allocation>& msg)
+        {
+            // only requests are anonymous, the rest are other servers' responses
+            if (!msg.isAnonymousTransfer()) {
+                return;
+            }
+            node_id_allocator_msg_t request, response;
+            request.node_id = msg.node_id;
+            request.first_part_of_unique_id = msg.first_part_of_unique_id;
+            request.unique_id_len = msg.unique_id.size();
+            for (uint8_t i = 0; i < request.unique_id_len; i++) {
+                request.unique_id[i] = msg.unique_id[i];
+            }
+
+            if (node_id_allocator_handle_request(&allocator, &request, timestamp_get(), &response)) {
+                uavcan::protocol::dynamic_node_id::Allocation out;
+                out.node_id = response.node_id;
+                out.first_part_of_unique_id = false;
+                for (uint8_t i = 0; i < response.unique_id_len; i++) {
+                    out.unique_id.push_back(response.unique_id[i]);
+                }
+                allocation_pub.broadcast(out);
+            }
+        }
+    );
+    if (res < 0) {
+        node_fail("uavcan::protocol::dynamic_node_id::Allocation subscriber");
+    }
+
     uavcan::Subscriber<cvra::motor::EmergencyStop> emergency_stop_sub(node);
     res = emergency_stop_sub.start(
         [&](const uavcan::ReceivedDataStructure<cvra::motor::EmergencyStop>& msg)
         {
             (void)msg;
+            // the capture survives the reset
+            can_capture_freeze(CAN_RECORDER_TRIGGER_EMERGENCY_STOP);
             NVIC_SystemReset();
         }
     );
@@ -152,11 +391,7 @@ void main(void *arg)
     res = string_id_sub.start(
         [&](const uavcan::ReceivedDataStructure<cvra::StringID>& msg)
         {
-            uint8_t can_id = msg.getSrcNodeID().get();
-
-            if (bus_enumerator_get_str_id(&bus_enumerator, can_id) == NULL) {
-                bus_enumerator_update_node_info(&bus_enumerator, msg.id.c_str(), can_id);
-            }
+            identify_node(msg.id.c_str(), msg.getSrcNodeID().get());
         }
     );
     if (res != 0) {
@@ -263,33 +498,18 @@ void main(void *arg)
                 motor_driver_set_stream_value(driver, MOTOR_STREAM_MOTOR_ENCODER, msg.raw_encoder_position);
             }
 
-            if (bus_enumerator_get_can_id(&bus_enumerator, "right-wheel") == BUS_ENUMERATOR_STRING_ID_NOT_FOUND
-                || bus_enumerator_get_can_id(&bus_enumerator, "left-wheel") == BUS_ENUMERATOR_STRING_ID_NOT_FOUND) {
-                return;
+            /* The driver timestamps frames in the RX interrupt, with its own
+             * clock. Subtracting the age of the frame from the current time
+             * gives the reception time in the timestamp module's clock,
+             * without the queueing and spin delays. */
+            uint8_t src = msg.getSrcNodeID().get();
+            uint32_t age = (getSystemClock().getMonotonic() - msg.getMonotonicTimestamp()).toUSec();
+            timestamp_t rx_time = timestamp_get() - age;
+            if (src == right_wheel_id) {
+                wheel_odometry_push_sample(WHEEL_ODOMETRY_RIGHT, rx_time, age, msg.raw_encoder_position);
+            } else if (src == left_wheel_id) {
+                wheel_odometry_push_sample(WHEEL_ODOMETRY_LEFT, rx_time, age, msg.raw_encoder_position);
             }
-            if(msg.getSrcNodeID().get() == bus_enumerator_get_can_id(&bus_enumerator, "right-wheel")) {
-                odometry_encoder_record_sample(&enc_right, timestamp_get(), msg.raw_encoder_position);
-            } else if(msg.getSrcNodeID().get() == bus_enumerator_get_can_id(&bus_enumerator, "left-wheel")) {
-                odometry_encoder_record_sample(&enc_left, timestamp_get(), msg.raw_encoder_position);
-            }
-            if (enc_left.timestamp != 0 && enc_right.timestamp != 0) {
-                odometry_base_update(&robot_base, enc_right, enc_left);
-            }
-
-            parameter_namespace_t *odometry_ns;
-            odometry_ns = parameter_namespace_find(&global_config, "/master/odometry");
-            if (parameter_namespace_contains_changed(odometry_ns)) {
-                odometry_base_set_parameters(&robot_base,
-                                             config_get_scalar("/master/odometry/wheelbase"),
-                                             ROBOT_RIGHT_WHEEL_DIRECTION * config_get_scalar("/master/odometry/radius_right"),
-                                             ROBOT_LEFT_WHEEL_DIRECTION * config_get_scalar("/master/odometry/radius_left"));
-
-            }
-
-            /* update global robot pose */
-            chMtxLock(&robot_pose_lock);
-            odometry_base_get_pose(&robot_base, &robot_pose);
-            chMtxUnlock(&robot_pose_lock);
         }
     );
     if (res != 0) {
@@ -330,13 +550,36 @@ void main(void *arg)
         node_fail("cvra::Reboot publisher");
     }
 
+    uavcan::GlobalTimeSyncMaster time_sync_master(node);
+    res = time_sync_master.init();
+    if (res < 0) {
+        node_fail("GlobalTimeSyncMaster");
+    }
+    parameter_t *time_sync_period = parameter_find(&global_config, "/master/time_sync/period");
+    uavcan::MonotonicTime last_time_sync = node.getMonotonicTime();
+
+    firmware_update_server_uavcan_init();
+
+    // the subscribers and servers above live on this stack
+    chThdCreateStatic(tx_thread_wa, sizeof(tx_thread_wa), UAVCAN_TX_PRIO, tx_main, NULL);
+
+    parameter_t *load_budget = parameter_find(&global_config, "/master/can/utilization_budget");
+
     while (true)
     {
-        res = node.spin(uavcan::MonotonicDuration::fromMSec(1000/UAVCAN_SPIN_FREQ));
+        // waiting does not need the node, so the TX thread can send meanwhile
+        wait_for_frames(node, 1000000 / UAVCAN_SPIN_FREQ);
+
+        chMtxLock(&node_lock);
+
+        res = node.spinOnce();
         if (res < 0) {
             // log warning
         }
 
+        send_injected_frames(node);
+        send_synthetic_load(node);
+
         // reboot command
         int button = palReadPad(GPIOA, GPIOA_BUTTON_WKUP);
         if (button) {
@@ -345,28 +588,408 @@ void main(void *arg)
             reboot_pub.broadcast(reboot_msg);
         }
 
+        // firmware updates wait while the bus is over budget
+        float budget = parameter_scalar_get(load_budget);
+        firmware_update_server_poll(budget > 0 && can_load.utilization > budget);
+
+        uavcan::MonotonicTime now = node.getMonotonicTime();
+        if ((now - last_time_sync).toUSec() >= parameter_scalar_get(time_sync_period) * 1e6f) {
+            last_time_sync = now;
+            time_sync_discipline();
+            if (time_sync_master.publish() >= 0) {
+                time_sync_stats.published++;
+            }
+        }
+
+        chMtxUnlock(&node_lock);
+    }
+}
+
+/* Sends the setpoints and the configuration of the motor drivers, at a
+ * higher priority than the RX thread so that setpoints leave in their slot
+ * even while a burst of frames is being handled. */
+static void tx_main(void *arg)
+{
+    (void) arg;
+    chRegSetThreadName("uavcan_tx");
+
+    /* Drivers are only visited when their next setpoint is due, and only
+     * look for changed parameters after a config update. */
+    static setpoint_scheduler_entry_t setpoint_schedule_buffer[MAX_NB_MOTOR_DRIVERS];
+    static bool config_pending[MAX_NB_MOTOR_DRIVERS];
+    setpoint_scheduler_t setpoint_schedule;
+    uint16_t nb_scheduled_drivers = 0;
+    setpoint_scheduler_init(&setpoint_schedule, setpoint_schedule_buffer, MAX_NB_MOTOR_DRIVERS);
+
+    event_listener_t config_listener;
+    chEvtRegisterMask(&config_updated, &config_listener, CONFIG_UPDATED_EVENT);
+
+    static bool streams_pending[MAX_NB_MOTOR_DRIVERS];
+    parameter_t *load_budget = parameter_find(&global_config, "/master/can/utilization_budget");
+    parameter_t *use_node_id_cache = parameter_find(&global_config, "/master/can/node_id_cache");
+    parameter_t *expected_actuators = parameter_find(&global_config, "/master/can/expected_actuators");
+    uint32_t last_can_load_update = timestamp_get();
+    uint32_t boot_time = timestamp_get();
+
+    while (true)
+    {
+        // new drivers and config updates are picked up at the spin frequency
+        uint32_t sleep_us = 1000000 / UAVCAN_SPIN_FREQ;
+        uint32_t next_due;
+        if (setpoint_scheduler_next_due(&setpoint_schedule, &next_due)) {
+            int32_t until_due = next_due - timestamp_get();
+            if (until_due <= 0) {
+                sleep_us = 0;
+            } else if ((uint32_t)until_due < sleep_us) {
+                sleep_us = until_due;
+            }
+        }
+        if (sleep_us > 0) {
+            chThdSleep(US2ST(sleep_us));
+        }
+
         motor_driver_t *drv_list;
         uint16_t drv_list_len;
         motor_manager_get_list(&motor_manager, &drv_list, &drv_list_len);
-        int i;
-        for (i = 0; i < drv_list_len; i++) {
-            motor_driver_uavcan_update_config(&drv_list[i]);
-            motor_driver_uavcan_send_setpoint(&drv_list[i]);
+
+        if (chEvtGetAndClearEvents(CONFIG_UPDATED_EVENT)) {
+            for (uint16_t i = 0; i < nb_scheduled_drivers; i++) {
+                config_pending[i] = true;
+            }
         }
 
-        // todo: publish time once a second
-        // time_sync_master.publish();
+        chMtxLock(&node_lock);
+
+        // drivers created since the last iteration
+        while (nb_scheduled_drivers < drv_list_len) {
+            if (parameter_integer_get(use_node_id_cache)) {
+                preload_can_id(&drv_list[nb_scheduled_drivers]);
+            }
+            config_pending[nb_scheduled_drivers] = true;
+            streams_pending[nb_scheduled_drivers] = true;
+            setpoint_scheduler_add(&setpoint_schedule, nb_scheduled_drivers, timestamp_get());
+            nb_scheduled_drivers++;
+
+            /* Drivers are created one by one by the actuator_create_driver
+             * RPC, a late one makes the set of actuators not ready again. */
+            chSysLock();
+            actuators_ready = false;
+            chSysUnlock();
+        }
+
+        /* Until every actuator is configured, push config to all of them in
+         * each spin instead of one item per setpoint slot. The number of
+         * concurrent calls is bounded by motor_driver_uavcan_process_config. */
+        if (!actuators_ready) {
+            int32_t expected = parameter_integer_get(expected_actuators);
+            bool ready = nb_scheduled_drivers > 0 && nb_scheduled_drivers >= expected;
+            for (uint16_t i = 0; i < nb_scheduled_drivers; i++) {
+                motor_driver_t *d = &drv_list[i];
+                if (config_pending[i]) {
+                    motor_driver_uavcan_update_config(d);
+                    config_pending[i] = motor_driver_get_can_id(d) == CAN_ID_NOT_SET;
+                }
+                motor_driver_uavcan_process_config(d);
+                if (!motor_driver_uavcan_config_is_done(d)) {
+                    ready = false;
+                }
+            }
+            if (ready) {
+                chSysLock();
+                actuators_time_to_ready_ms = (timestamp_get() - boot_time) / 1000;
+                actuators_ready = true;
+                chSysUnlock();
+                log_message("%d actuators configured %lu ms after boot",
+                            nb_scheduled_drivers, actuators_time_to_ready_ms);
+            }
+        }
+
+        uint16_t id;
+        uint32_t due;
+        while (setpoint_scheduler_next_due(&setpoint_schedule, &due)
+               && setpoint_scheduler_pop_due(&setpoint_schedule, timestamp_get(), &id)) {
+            chSysLock();
+            latency_histogram_record(&tx_latency, timestamp_get() - due);
+            chSysUnlock();
+
+            motor_driver_t *d = &drv_list[id];
+            if (config_pending[id]) {
+                motor_driver_uavcan_update_config(d);
+                // retried in the next slot until the board was identified
+                config_pending[id] = motor_driver_get_can_id(d) == CAN_ID_NOT_SET;
+            }
+            if (streams_pending[id]) {
+                motor_driver_uavcan_set_stream_scale(d, rate_scale);
+                streams_pending[id] = false;
+            }
+            motor_driver_uavcan_send_setpoint(d);
+            motor_driver_uavcan_process_config(d);
+
+            uint32_t period_us = motor_driver_get_update_period(d) * rate_scale * 1e6f;
+            setpoint_scheduler_add(&setpoint_schedule, id,
+                                   setpoint_scheduler_next_slot(timestamp_get(), period_us,
+                                                                id * UAVCAN_SETPOINT_STAGGER_US));
+        }
+
+        chMtxUnlock(&node_lock);
+
+        uint32_t now_us = timestamp_get();
+        if (now_us - last_can_load_update >= CAN_LOAD_WINDOW_US) {
+            chMtxLock(&can_load_lock);
+            float utilization = can_load_update(&can_load, now_us - last_can_load_update, BitRate);
+            chMtxUnlock(&can_load_lock);
+            last_can_load_update = now_us;
+
+            float scale = can_load_rate_scale(rate_scale, utilization,
+                                              parameter_scalar_get(load_budget),
+                                              CAN_LOAD_MAX_RATE_SCALE);
+            // stream frequencies are only resent in steps of a quarter
+            if (ceilf(scale * 4) != ceilf(rate_scale * 4)) {
+                for (uint16_t i = 0; i < nb_scheduled_drivers; i++) {
+                    streams_pending[i] = true;
+                }
+            }
+            rate_scale = scale;
+        }
     }
 }
 
 static void node_status_cb(const uavcan::ReceivedDataStructure<uavcan::protocol::NodeStatus>& msg)
 {
-    (void) msg;
-    // TODO !!!
-    // int can_id = msg.getSrcNodeID().get();
-    // bus_enumerator_get_driver()
-    // motor_driver_send_initial_config()
-    node_tracker_set_id((uint8_t)msg.getSrcNodeID().get());
+    uint8_t id = msg.getSrcNodeID().get();
+
+    chSysLock();
+    bool rebooted = node_tracker_update(&node_tracker, id, timestamp_get(),
+                                        msg.uptime_sec, msg.health, msg.mode);
+    chSysUnlock();
+
+    node_id_allocator_node_seen(&allocator, id);
+
+    if (rebooted) {
+        // the board lost its config
+        motor_driver_t *d = (motor_driver_t*)bus_enumerator_get_driver_by_can_id(&bus_enumerator, id);
+        log_message("node %d rebooted", id);
+        if (d != NULL) {
+            motor_driver_uavcan_node_rebooted(d);
+        }
+    }
+}
+
+/* Steers the UTC clock of the CAN driver, which is the one distributed by
+ * the time sync master, towards the SNTP derived unix time. */
+static void time_sync_discipline(void)
+{
+    if (!timestamp_unix_reference_is_set()) {
+        return;
+    }
+
+    unix_timestamp_t now = timestamp_local_us_to_unix(timestamp_get());
+    uavcan::UtcTime unix_time = uavcan::UtcTime::fromUSec((uint64_t)now.s * 1000000 + now.us);
+    uavcan::UtcDuration offset = unix_time - getSystemClock().getUtc();
+
+    getSystemClock().adjustUtc(offset);
+
+    // the first correction jumps from boot time to unix time
+    int64_t offset_us = offset.toUSec();
+    chSysLock();
+    time_sync_stats.last_offset_us = offset_us;
+    if (llabs(offset_us) > llabs(time_sync_stats.max_offset_us)) {
+        time_sync_stats.max_offset_us = offset_us;
+    }
+    chSysUnlock();
+}
+
+static void node_id_cache_erase(void)
+{
+    flash_sector_erase(NODE_ID_CACHE_SECTOR);
+}
+
+static void node_id_cache_open(void)
+{
+    node_id_cache_init(&node_id_cache, __node_id_cache_start__,
+                       (size_t)__node_id_cache_size__, flash_write, node_id_cache_erase);
+
+    // erasing stalls the CPU for seconds, which is only acceptable at boot
+    if (node_id_cache_free_slots(&node_id_cache) < NODE_ID_CACHE_MIN_FREE) {
+        static node_id_cache_record_t scratch[NODE_ID_CACHE_MAX_NODES];
+        node_id_cache_compact(&node_id_cache, scratch, NODE_ID_CACHE_MAX_NODES);
+    }
+}
+
+static void allocation_persist(const uint8_t *unique_id, uint8_t node_id, void *arg)
+{
+    (void) arg;
+    if (node_id == NODE_ID_ALLOCATOR_NONE) {
+        node_id = NODE_ID_CACHE_NOT_FOUND;
+    }
+    if (node_id_cache_store_unique_id(&node_id_cache, unique_id, node_id) < 0) {
+        log_message("node ID cache full, allocation of node %d not stored", node_id);
+    }
+}
+
+static void allocation_restore(const uint8_t *key, uint8_t node_id, void *arg)
+{
+    if (node_id == NODE_ID_CACHE_NOT_FOUND) {
+        node_id = NODE_ID_ALLOCATOR_NONE;
+    }
+    node_id_allocator_restore((node_id_allocator_t *)arg, key, node_id);
+}
+
+/* The allocation table lives in the node ID cache, so that boards keep their
+ * node ID across reboots of the master. */
+static void allocator_start(uint8_t own_node_id)
+{
+    node_id_allocator_init(&allocator, allocation_table, NODE_ID_ALLOCATOR_MAX_NODE_ID,
+                           own_node_id, allocation_persist, NULL);
+    node_id_cache_foreach(&node_id_cache, NODE_ID_CACHE_UNIQUE_ID, allocation_restore, &allocator);
+}
+
+/* Uses the CAN ID the board had before the reboot, until it announces its
+ * string ID. Setpoints sent meanwhile to a wrong ID are harmless as boards
+ * only accept their own. */
+static void preload_can_id(motor_driver_t *d)
+{
+    const char *str_id = motor_driver_get_id(d);
+    if (bus_enumerator_get_can_id(&bus_enumerator, str_id) != BUS_ENUMERATOR_CAN_ID_NOT_SET) {
+        return;
+    }
+    uint8_t can_id = node_id_cache_lookup(&node_id_cache, str_id);
+    if (can_id == NODE_ID_CACHE_NOT_FOUND ||
+        bus_enumerator_get_str_id(&bus_enumerator, can_id) != NULL) {
+        return;
+    }
+    bus_enumerator_update_node_info(&bus_enumerator, str_id, can_id);
+    update_wheel_ids();
+    node_id_cache_stats.preloaded++;
+}
+
+static void forget_node(const char *str_id)
+{
+    motor_driver_t *d = (motor_driver_t*)bus_enumerator_get_driver(&bus_enumerator, str_id);
+    bus_enumerator_clear_node_info(&bus_enumerator, str_id);
+    if (d != NULL) {
+        motor_driver_set_can_id(d, CAN_ID_NOT_SET);
+    }
+    node_id_cache_stats.corrected++;
+}
+
+/* Checks a StringID announcement against the known mappings, which may come
+ * from the cache, and records new mappings in the cache. */
+static void identify_node(const char *str_id, uint8_t can_id)
+{
+    const char *known_str_id = bus_enumerator_get_str_id(&bus_enumerator, can_id);
+    if (known_str_id != NULL && strcmp(known_str_id, str_id) == 0) {
+        return;
+    }
+
+    // a board changed its ID, drop the stale mappings of both sides
+    if (known_str_id != NULL) {
+        forget_node(known_str_id);
+    }
+    uint8_t known_can_id = bus_enumerator_get_can_id(&bus_enumerator, str_id);
+    if (known_can_id != BUS_ENUMERATOR_CAN_ID_NOT_SET &&
+        known_can_id != BUS_ENUMERATOR_STRING_ID_NOT_FOUND) {
+        forget_node(str_id);
+        // the board was replaced, its allocation can be reused
+        node_id_allocator_release(&allocator, known_can_id);
+    }
+
+    bus_enumerator_update_node_info(&bus_enumerator, str_id, can_id);
+    update_wheel_ids();
+
+    motor_driver_t *d = (motor_driver_t*)bus_enumerator_get_driver(&bus_enumerator, str_id);
+    if (d == NULL) {
+        return;
+    }
+    // also covers drivers which were talking to the wrong board
+    motor_driver_send_initial_config(d);
+    if (node_id_cache_store(&node_id_cache, str_id, can_id) < 0) {
+        log_message("node ID cache full, %s not stored", str_id);
+    }
+}
+
+static uint32_t frame_time(uavcan::MonotonicTime ts_monotonic)
+{
+    // same conversion as for the encoder samples
+    uint32_t age = (getSystemClock().getMonotonic() - ts_monotonic).toUSec();
+    return timestamp_get() - age;
+}
+
+static void tap_frame(const uavcan::CanFrame& frame, uint32_t timestamp, uint8_t flags)
+{
+    can_bridge_frame_t f;
+    // libuavcan uses the SocketCAN flags as well
+    f.id = frame.id & (uavcan::CanFrame::FlagEFF | uavcan::CanFrame::FlagRTR | uavcan::CanFrame::MaskExtID);
+    f.timestamp_us = timestamp;
+    f.flags = flags;
+    f.dlc = frame.dlc;
+    memcpy(f.data, frame.data, frame.dlc);
+    can_bridge_forward(&f);
+    can_capture_frame(&f);
+}
+
+static void send_injected_frames(Node& node)
+{
+    can_bridge_frame_t f;
+    while (can_bridge_pop_injected(&f)) {
+        uavcan::CanFrame frame(f.id & (uavcan::CanFrame::FlagEFF | uavcan::CanFrame::FlagRTR |
+                                       uavcan::CanFrame::MaskExtID),
+                               f.data, f.dlc);
+        uavcan::MonotonicTime deadline = node.getMonotonicTime() + uavcan::MonotonicDuration::fromMSec(10);
+        int16_t res = getCanDriver().getIface(0)->send(frame, deadline, 0);
+        can_bridge_injected(res > 0);
+    }
+}
+
+static void send_synthetic_load(Node& node)
+{
+    static uint32_t rate = 0, start_us;
+    static int32_t sent;
+    uint32_t now_us = timestamp_get();
+
+    if (synthetic_load_rate != rate) {
+        rate = synthetic_load_rate;
+        start_us = now_us;
+        sent = 0;
+    }
+    if (rate == 0) {
+        return;
+    }
+    // counts are kept relative to the last second so they do not overflow
+    while (now_us - start_us >= 1000000) {
+        start_us += 1000000;
+        sent -= rate;
+    }
+    int32_t due = (uint64_t)rate * (now_us - start_us) / 1000000;
+    if (due - sent > SYNTHETIC_LOAD_MAX_BURST) {
+        sent = due - SYNTHETIC_LOAD_MAX_BURST;
+    }
+
+    // single frame transfer, the last byte being the tail byte
+    const uint8_t data[8] = {0, 0, 0, 0, 0, 0, 0, 0xc0};
+    uavcan::CanFrame frame((SYNTHETIC_LOAD_PRIORITY << 24) | (SYNTHETIC_LOAD_DATA_TYPE_ID << 8)
+                           | node.getNodeID().get() | uavcan::CanFrame::FlagEFF,
+                           data, sizeof(data));
+    uavcan::MonotonicTime deadline = node.getMonotonicTime() + uavcan::MonotonicDuration::fromMSec(10);
+    for (; sent < due; sent++) {
+        getCanDriver().getIface(0)->send(frame, deadline, 0);
+    }
+}
+
+/* Blocks until a frame was received or sent, or until the timeout. */
+static void wait_for_frames(Node& node, uint32_t timeout_us)
+{
+    uavcan::CanSelectMasks masks;
+    const uavcan::CanFrame *pending_tx[uavcan::MaxCanIfaces] = {};
+    masks.read = (1 << getCanDriver().getNumIfaces()) - 1;
+    getCanDriver().select(masks, pending_tx,
+                          node.getMonotonicTime() + uavcan::MonotonicDuration::fromUSec(timeout_us));
+}
+
+static void update_wheel_ids(void)
+{
+    right_wheel_id = bus_enumerator_get_can_id(&bus_enumerator, "right-wheel");
+    left_wheel_id = bus_enumerator_get_can_id(&bus_enumerator, "left-wheel");
 }
 
 static void node_fail(const char *reason)
@@ -384,7 +1007,88 @@ extern "C" {
 void uavcan_node_start(uint8_t id)
 {
     static uint8_t node_id = id;
-    chThdCreateStatic(uavcan_node::thread_wa, UAVCAN_NODE_STACK_SIZE, NORMALPRIO, uavcan_node::main, &node_id);
+    chMtxObjectInit(&uavcan_node::node_lock);
+    chThdCreateStatic(uavcan_node::thread_wa, UAVCAN_NODE_STACK_SIZE, UAVCAN_RX_PRIO, uavcan_node::main, &node_id);
+}
+
+void uavcan_node_get_latency(latency_histogram_t *rx, latency_histogram_t *tx)
+{
+    chSysLock();
+    *rx = uavcan_node::rx_latency;
+    *tx = uavcan_node::tx_latency;
+    latency_histogram_init(&uavcan_node::rx_latency);
+    latency_histogram_init(&uavcan_node::tx_latency);
+    chSysUnlock();
+}
+
+void uavcan_node_get_priority_stats(can_priority_stats_t *stats)
+{
+    uint32_t now = timestamp_get();
+    chSysLock();
+    can_priority_expire(&uavcan_node::priority_stats, now);
+    *stats = uavcan_node::priority_stats;
+    can_priority_clear(&uavcan_node::priority_stats);
+    chSysUnlock();
+}
+
+void uavcan_node_set_synthetic_load(uint32_t frames_per_s)
+{
+    uavcan_node::synthetic_load_rate = frames_per_s;
+}
+
+void uavcan_node_get_time_sync_stats(uavcan_time_sync_stats_t *stats)
+{
+    chSysLock();
+    *stats = uavcan_node::time_sync_stats;
+    uavcan_node::time_sync_stats.max_offset_us = 0;
+    chSysUnlock();
+}
+
+void uavcan_node_get_can_load(can_load_t *load, float *scale)
+{
+    chMtxLock(&uavcan_node::can_load_lock);
+    *load = uavcan_node::can_load;
+    *scale = uavcan_node::rate_scale;
+    chMtxUnlock(&uavcan_node::can_load_lock);
+}
+
+bool uavcan_node_actuators_ready(uint32_t *time_to_ready_ms)
+{
+    chSysLock();
+    bool ready = uavcan_node::actuators_ready;
+    *time_to_ready_ms = uavcan_node::actuators_time_to_ready_ms;
+    chSysUnlock();
+    return ready;
+}
+
+bool uavcan_node_get_node_status(uint8_t id, node_tracker_entry_t *status)
+{
+    if (id >= NODE_TRACKER_NB_NODES) {
+        return false;
+    }
+    chSysLock();
+    *status = uavcan_node::node_tracker.nodes[id];
+    chSysUnlock();
+    return status->seen;
+}
+
+void uavcan_node_get_node_id_cache_stats(uavcan_node_id_cache_stats_t *stats)
+{
+    chSysLock();
+    *stats = uavcan_node::node_id_cache_stats;
+    stats->free_slots = node_id_cache_free_slots(&uavcan_node::node_id_cache);
+    stats->allocations = uavcan_node::allocator.nb_allocations;
+    chSysUnlock();
+}
+
+uint32_t uavcan_node_get_bus_utilization(float *utilization, float *scale)
+{
+    chMtxLock(&uavcan_node::can_load_lock);
+    *utilization = uavcan_node::can_load.utilization;
+    *scale = uavcan_node::rate_scale;
+    uint32_t windows = uavcan_node::can_load.windows;
+    chMtxUnlock(&uavcan_node::can_load_lock);
+    return windows;
 }
 
 void uavcan_node_send_reboot(uint8_t id)
@@ -7,9 +7,82 @@ extern "C" {
 
 #include <stdint.h>
 #include "bus_enumerator.h"
+#include "can_load.h"
+#include "node_tracker.h"
+#include "latency_histogram.h"
+#include "can_priority.h"
 
 void uavcan_node_start(uint8_t id);
 
+typedef struct {
+    uint32_t published;     /**< Number of GlobalTimeSync messages sent. */
+    int64_t last_offset_us; /**< Unix time minus CAN UTC before the last correction. */
+    int64_t max_offset_us;  /**< Largest correction since the last read. */
+} uavcan_time_sync_stats_t;
+
+/** Copies the time sync master statistics and clears the largest offset. */
+void uavcan_node_get_time_sync_stats(uavcan_time_sync_stats_t *stats);
+
+/** Copies the CAN bus load accounting and the factor by which setpoint
+ * periods are currently stretched to stay under
+ * /master/can/utilization_budget.
+ *
+ * @note can_load_t is large, avoid putting it on small stacks.
+ */
+void uavcan_node_get_can_load(can_load_t *load, float *scale);
+
+/** Gets the bus utilization of the last window and the rate scale.
+ *
+ * @return The number of windows computed so far, to detect new values.
+ */
+uint32_t uavcan_node_get_bus_utilization(float *utilization, float *scale);
+
+/** Tells whether all actuators created so far were identified and sent
+ * their configuration since the node started. Never true before the number
+ * of drivers reaches the /master/can/expected_actuators parameter, and
+ * cleared again when another driver is created.
+ *
+ * @param [out] time_to_ready_ms Time it took from the node start, only set
+ * when ready.
+ */
+bool uavcan_node_actuators_ready(uint32_t *time_to_ready_ms);
+
+/** Copies the health table entry of a node, updated from its NodeStatus.
+ *
+ * @return false if the node was never seen.
+ */
+bool uavcan_node_get_node_status(uint8_t id, node_tracker_entry_t *status);
+
+typedef struct {
+    uint32_t preloaded;     /**< CAN IDs taken from the node ID cache. */
+    uint32_t corrected;     /**< Mappings dropped because a StringID contradicted them. */
+    uint32_t free_slots;    /**< Records which can still be written to flash. */
+    uint32_t allocations;   /**< Node IDs given by the dynamic node ID allocator. */
+} uavcan_node_id_cache_stats_t;
+
+/** Copies the statistics of the flash cache of CAN IDs, which is disabled
+ * by setting /master/can/node_id_cache to 0, and of the node ID allocator
+ * whose table it stores. */
+void uavcan_node_get_node_id_cache_stats(uavcan_node_id_cache_stats_t *stats);
+
+/** Copies the latency histograms of the UAVCAN threads and clears them.
+ *
+ * @param [out] rx Time from the reception of a frame until it is handled.
+ * @param [out] tx Time from the slot of a setpoint until it is sent.
+ */
+void uavcan_node_get_latency(latency_histogram_t *rx, latency_histogram_t *tx);
+
+/** Copies the TX queue statistics of each transfer priority class, then
+ * clears their maximum depth and latencies.
+ *
+ * @note can_priority_stats_t is large, avoid putting it on small stacks.
+ */
+void uavcan_node_get_priority_stats(can_priority_stats_t *stats);
+
+/** Sends lowest priority filler frames at the given rate, to measure
+ * latencies on a loaded bus. 0 stops them. */
+void uavcan_node_set_synthetic_load(uint32_t frames_per_s);
+
 // send reboot command to node id.
 // if id > 127 then the reboot command is broadcast.
 void uavcan_node_send_reboot(uint8_t id);
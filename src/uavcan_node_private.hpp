@@ -1,9 +1,20 @@
 #ifndef UAVCAN_NODE_PRIVATE_HPP
 #define UAVCAN_NODE_PRIVATE_HPP
 
+#include "can_priority.h"
+
 typedef uavcan::Node<16384> Node;
 namespace uavcan_node {
     Node& getNode();
+
+    /* Transfer priority of a class, see can_priority.h. */
+    uavcan::TransferPriority transferPriority(can_priority_class_t c);
+
+    /* Account for transfers of a class in the TX queue statistics. Must be
+     * called right before handing a transfer to the node, and again if it
+     * was refused. */
+    void transferSubmitted(can_priority_class_t c);
+    void transferCancelled(can_priority_class_t c);
 }
 
 #endif
@@ -34,6 +34,12 @@ void timestamp_set_reference(unix_timestamp_t unix_ts, int32_t local_ts)
     local_reference = local_ts;
 }
 
+bool timestamp_unix_reference_is_set(void)
+{
+    /* No valid reference lies at the epoch itself. */
+    return unix_reference.s != 0;
+}
+
 int timestamp_unix_compare(unix_timestamp_t a, unix_timestamp_t b)
 {
     if (a.s < b.s) {
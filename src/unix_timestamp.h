@@ -2,6 +2,7 @@
 #define UNIX_TIMESTAMP_H
 
 #include <stdint.h>
+#include <stdbool.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -30,6 +31,9 @@ unix_timestamp_t timestamp_local_us_to_unix(int32_t ts);
 /** Sets a reference point for synchronization. */
 void timestamp_set_reference(unix_timestamp_t unix_ts, int32_t local_ts);
 
+/** Returns true once a reference point was set, for example by SNTP. */
+bool timestamp_unix_reference_is_set(void);
+
 /** Compares two UNIX timestamps.
  *
  * @return -1 If a < b
@@ -0,0 +1,165 @@
+#include <ch.h>
+#include <math.h>
+#include "odometry/robot_base.h"
+#include "odometry/odometry.h"
+#include "robot_parameters.h"
+#include "robot_pose.h"
+#include "config.h"
+#include "priorities.h"
+#include "spsc_queue.h"
+#include "wheel_odometry.h"
+
+#define WHEEL_ODOMETRY_STACKSIZE 1024
+#define SAMPLE_QUEUE_LEN 16
+
+struct encoder_sample {
+    timestamp_t timestamp;
+    uint32_t dispatch_delay;
+    uint32_t value;
+    wheel_odometry_side_t side;
+};
+
+struct interval_stats {
+    timestamp_t last;
+    uint32_t count;
+    uint32_t min;
+    uint32_t max;
+    float sum;
+    float sum_sq;
+};
+
+static THD_WORKING_AREA(wa_wheel_odometry, WHEEL_ODOMETRY_STACKSIZE);
+
+static struct encoder_sample sample_buffer[SAMPLE_QUEUE_LEN];
+static spsc_queue_t sample_queue;
+static BSEMAPHORE_DECL(sample_available, true);
+
+static struct interval_stats rx_jitter;
+static struct interval_stats dispatch_jitter;
+
+static void interval_stats_update(struct interval_stats *st, timestamp_t t)
+{
+    uint32_t dt = t - st->last;
+
+    chSysLock();
+    if (st->last != 0) {
+        if (st->count == 0 || dt < st->min) {
+            st->min = dt;
+        }
+        if (dt > st->max) {
+            st->max = dt;
+        }
+        st->sum += dt;
+        st->sum_sq += (float)dt * dt;
+        st->count++;
+    }
+    st->last = t;
+    chSysUnlock();
+}
+
+static void interval_stats_get(struct interval_stats *st, wheel_odometry_jitter_t *j)
+{
+    j->count = st->count;
+    j->min = st->min;
+    j->max = st->max;
+    j->mean = 0;
+    j->stddev = 0;
+    if (st->count > 0) {
+        j->mean = st->sum / st->count;
+        j->stddev = sqrtf(fmaxf(st->sum_sq / st->count - j->mean * j->mean, 0));
+    }
+
+    st->count = 0;
+    st->min = 0;
+    st->max = 0;
+    st->sum = 0;
+    st->sum_sq = 0;
+}
+
+void wheel_odometry_get_jitter(wheel_odometry_jitter_t *rx,
+                               wheel_odometry_jitter_t *dispatch)
+{
+    chSysLock();
+    interval_stats_get(&rx_jitter, rx);
+    interval_stats_get(&dispatch_jitter, dispatch);
+    chSysUnlock();
+}
+
+void wheel_odometry_push_sample(wheel_odometry_side_t side, timestamp_t timestamp,
+                                uint32_t dispatch_delay, uint32_t encoder_value)
+{
+    struct encoder_sample s = {timestamp, dispatch_delay, encoder_value, side};
+
+    if (spsc_queue_push(&sample_queue, &s)) {
+        chBSemSignal(&sample_available);
+    }
+}
+
+static void wheel_odometry_thread(void *p)
+{
+    static odometry_differential_base_t robot_base;
+    static odometry_encoder_sample_t enc_right;
+    static odometry_encoder_sample_t enc_left;
+    parameter_namespace_t *odometry_ns;
+    struct robot_base_pose_2d_s pose = {0.0f, 0.0f, 0.0f};
+    struct encoder_sample s;
+
+    (void) p;
+
+    chRegSetThreadName("wheel_odometry");
+
+    odometry_base_init(&robot_base,
+                       pose,
+                       ROBOT_RIGHT_WHEEL_DIRECTION * config_get_scalar("/master/odometry/radius_right"),
+                       ROBOT_LEFT_WHEEL_DIRECTION * config_get_scalar("/master/odometry/radius_left"),
+                       1,
+                       1,
+                       config_get_scalar("/master/odometry/wheelbase"),
+                       timestamp_get());
+
+    odometry_encoder_record_sample(&enc_right, 0, 0);
+    odometry_encoder_record_sample(&enc_left, 0, 0);
+
+    odometry_ns = parameter_namespace_find(&global_config, "/master/odometry");
+
+    while (1) {
+        chBSemWait(&sample_available);
+
+        while (spsc_queue_pop(&sample_queue, &s)) {
+            if (s.side == WHEEL_ODOMETRY_RIGHT) {
+                interval_stats_update(&rx_jitter, s.timestamp);
+                interval_stats_update(&dispatch_jitter, s.timestamp + s.dispatch_delay);
+                odometry_encoder_record_sample(&enc_right, s.timestamp, s.value);
+            } else {
+                odometry_encoder_record_sample(&enc_left, s.timestamp, s.value);
+            }
+
+            if (parameter_namespace_contains_changed(odometry_ns)) {
+                odometry_base_set_parameters(&robot_base,
+                                             config_get_scalar("/master/odometry/wheelbase"),
+                                             ROBOT_RIGHT_WHEEL_DIRECTION * config_get_scalar("/master/odometry/radius_right"),
+                                             ROBOT_LEFT_WHEEL_DIRECTION * config_get_scalar("/master/odometry/radius_left"));
+            }
+
+            if (enc_left.timestamp == 0 || enc_right.timestamp == 0) {
+                continue;
+            }
+
+            odometry_base_update(&robot_base, enc_right, enc_left);
+            odometry_base_get_pose(&robot_base, &pose);
+            robot_pose_set(&pose, s.timestamp);
+        }
+    }
+}
+
+void wheel_odometry_init(void)
+{
+    spsc_queue_init(&sample_queue, sample_buffer, sizeof(struct encoder_sample),
+                    SAMPLE_QUEUE_LEN);
+
+    chThdCreateStatic(wa_wheel_odometry,
+                      sizeof(wa_wheel_odometry),
+                      WHEEL_ODOMETRY_PRIO,
+                      wheel_odometry_thread,
+                      NULL);
+}
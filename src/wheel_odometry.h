@@ -0,0 +1,50 @@
+#ifndef WHEEL_ODOMETRY_H
+#define WHEEL_ODOMETRY_H
+
+#include <stdint.h>
+#include "timestamp/timestamp.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum {
+    WHEEL_ODOMETRY_RIGHT = 0,
+    WHEEL_ODOMETRY_LEFT,
+} wheel_odometry_side_t;
+
+/** Starts the odometry thread, which turns wheel encoder samples into the
+ * robot pose. */
+void wheel_odometry_init(void);
+
+/** Statistics of the interval between two samples of the same wheel [us]. */
+typedef struct {
+    uint32_t count;
+    uint32_t min;
+    uint32_t max;
+    float mean;
+    float stddev;
+} wheel_odometry_jitter_t;
+
+/** Hands an encoder sample over to the odometry thread.
+ *
+ * Called from the CAN thread, never blocks. Samples are dropped if the
+ * odometry thread falls behind.
+ *
+ * @param [in] timestamp Reception time of the CAN frame.
+ * @param [in] dispatch_delay Time between reception and dispatch of the frame
+ * to the subscriber [us], only used for statistics.
+ */
+void wheel_odometry_push_sample(wheel_odometry_side_t side, timestamp_t timestamp,
+                                uint32_t dispatch_delay, uint32_t encoder_value);
+
+/** Copies and clears the sample interval statistics of the right wheel,
+ * computed with the reception timestamps and with the dispatch ones. */
+void wheel_odometry_get_jitter(wheel_odometry_jitter_t *rx,
+                               wheel_odometry_jitter_t *dispatch);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* WHEEL_ODOMETRY_H */
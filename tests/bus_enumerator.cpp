@@ -160,6 +160,28 @@ TEST(BusEnumeratorTestGroup, UpdateNodeInfoWorksOnlyOnce)
     CHECK_EQUAL(LARGE_CAN_ID, en.can_to_str[0].can_id);
 }
 
+TEST(BusEnumeratorTestGroup, ClearNodeInfo)
+{
+    bus_enumerator_init(&en, buffer, buffer_len);
+
+    bus_enumerator_add_node(&en, LARGE_STR_ID, DRIVER_POINTER);
+    bus_enumerator_add_node(&en, SMALL_STR_ID, DRIVER_POINTER);
+
+    bus_enumerator_update_node_info(&en, LARGE_STR_ID, SMALL_CAN_ID);
+    bus_enumerator_update_node_info(&en, SMALL_STR_ID, LARGE_CAN_ID);
+
+    bus_enumerator_clear_node_info(&en, LARGE_STR_ID);
+
+    CHECK_EQUAL(1, en.nb_entries_can_to_str);
+    CHECK_EQUAL(BUS_ENUMERATOR_CAN_ID_NOT_SET, bus_enumerator_get_can_id(&en, LARGE_STR_ID));
+    POINTERS_EQUAL(NULL, bus_enumerator_get_str_id(&en, SMALL_CAN_ID));
+    STRCMP_EQUAL(SMALL_STR_ID, bus_enumerator_get_str_id(&en, LARGE_CAN_ID));
+
+    // the node can then be identified again
+    bus_enumerator_update_node_info(&en, LARGE_STR_ID, MEDIUM_CAN_ID);
+    CHECK_EQUAL(MEDIUM_CAN_ID, bus_enumerator_get_can_id(&en, LARGE_STR_ID));
+}
+
 TEST(BusEnumeratorTestGroup, GetNumberOfEntries)
 {
     bus_enumerator_init(&en, buffer, buffer_len);
@@ -0,0 +1,131 @@
+#include <string.h>
+#include "CppUTest/TestHarness.h"
+#include "../src/can_bridge.h"
+
+TEST_GROUP(CANBridgeTestGroup)
+{
+    uint8_t buffer[64];
+    can_bridge_batch_t batch;
+    can_bridge_frame_t frame;
+    can_bridge_frame_t decoded[4];
+
+    void setup()
+    {
+        memset(&frame, 0, sizeof(frame));
+        frame.timestamp_us = 0x01020304;
+        frame.id = CAN_BRIDGE_ID_EXT | 0x1234567;
+        frame.flags = CAN_BRIDGE_FLAG_TX;
+        frame.dlc = 3;
+        frame.data[0] = 0xaa;
+        frame.data[1] = 0xbb;
+        frame.data[2] = 0xcc;
+    }
+};
+
+TEST(CANBridgeTestGroup, HeaderIsWritten)
+{
+    can_bridge_batch_start(&batch, buffer, sizeof(buffer), 0x1234, 42);
+
+    CHECK_EQUAL(CAN_BRIDGE_HEADER_LEN, can_bridge_batch_len(&batch));
+    CHECK_EQUAL(0, can_bridge_batch_nb_frames(&batch));
+    CHECK_EQUAL(CAN_BRIDGE_VERSION, buffer[0]);
+    CHECK_EQUAL(0x34, buffer[2]);
+    CHECK_EQUAL(0x12, buffer[3]);
+    CHECK_EQUAL(42, buffer[4]);
+}
+
+TEST(CANBridgeTestGroup, FrameIsEncodedLittleEndian)
+{
+    can_bridge_batch_start(&batch, buffer, sizeof(buffer), 0, 0);
+    CHECK_TRUE(can_bridge_batch_append(&batch, &frame));
+
+    CHECK_EQUAL(1, can_bridge_batch_nb_frames(&batch));
+    CHECK_EQUAL(CAN_BRIDGE_HEADER_LEN + 10 + 3, can_bridge_batch_len(&batch));
+    uint8_t *p = &buffer[CAN_BRIDGE_HEADER_LEN];
+    CHECK_EQUAL(0x04, p[0]);
+    CHECK_EQUAL(0x01, p[3]);
+    CHECK_EQUAL(0x67, p[4]);
+    CHECK_EQUAL(0x81, p[7]);
+    CHECK_EQUAL(CAN_BRIDGE_FLAG_TX, p[8]);
+    CHECK_EQUAL(3, p[9]);
+    CHECK_EQUAL(0xcc, p[12]);
+}
+
+TEST(CANBridgeTestGroup, FrameWhichDoesNotFitIsRejected)
+{
+    can_bridge_batch_start(&batch, buffer, CAN_BRIDGE_HEADER_LEN + 2 * 13 + 5, 0, 0);
+
+    CHECK_TRUE(can_bridge_batch_append(&batch, &frame));
+    CHECK_TRUE(can_bridge_batch_append(&batch, &frame));
+    CHECK_FALSE(can_bridge_batch_append(&batch, &frame));
+    CHECK_EQUAL(2, can_bridge_batch_nb_frames(&batch));
+    CHECK_EQUAL(CAN_BRIDGE_HEADER_LEN + 2 * 13, can_bridge_batch_len(&batch));
+}
+
+TEST(CANBridgeTestGroup, EncodedFramesAreDecoded)
+{
+    can_bridge_frame_t empty = frame;
+    empty.dlc = 0;
+    empty.id = 0x123;
+    can_bridge_batch_start(&batch, buffer, sizeof(buffer), 0, 0);
+    can_bridge_batch_append(&batch, &frame);
+    can_bridge_batch_append(&batch, &empty);
+
+    CHECK_EQUAL(2, can_bridge_decode(buffer, can_bridge_batch_len(&batch), decoded, 4));
+    CHECK_EQUAL(frame.timestamp_us, decoded[0].timestamp_us);
+    CHECK_EQUAL(frame.id, decoded[0].id);
+    CHECK_EQUAL(frame.flags, decoded[0].flags);
+    CHECK_EQUAL(3, decoded[0].dlc);
+    CHECK_EQUAL(0xbb, decoded[0].data[1]);
+    CHECK_EQUAL(0x123, decoded[1].id);
+    CHECK_EQUAL(0, decoded[1].dlc);
+}
+
+TEST(CANBridgeTestGroup, TruncatedDatagramIsRejected)
+{
+    can_bridge_batch_start(&batch, buffer, sizeof(buffer), 0, 0);
+    can_bridge_batch_append(&batch, &frame);
+
+    CHECK_EQUAL(-1, can_bridge_decode(buffer, can_bridge_batch_len(&batch) - 1, decoded, 4));
+    CHECK_EQUAL(-1, can_bridge_decode(buffer, 4, decoded, 4));
+}
+
+TEST(CANBridgeTestGroup, TrailingBytesAreRejected)
+{
+    can_bridge_batch_start(&batch, buffer, sizeof(buffer), 0, 0);
+    can_bridge_batch_append(&batch, &frame);
+
+    CHECK_EQUAL(-1, can_bridge_decode(buffer, can_bridge_batch_len(&batch) + 1, decoded, 4));
+}
+
+TEST(CANBridgeTestGroup, TooManyFramesAreRejected)
+{
+    can_bridge_batch_start(&batch, buffer, sizeof(buffer), 0, 0);
+    can_bridge_batch_append(&batch, &frame);
+    can_bridge_batch_append(&batch, &frame);
+
+    CHECK_EQUAL(-1, can_bridge_decode(buffer, can_bridge_batch_len(&batch), decoded, 1));
+}
+
+TEST(CANBridgeTestGroup, InvalidDLCIsRejected)
+{
+    can_bridge_batch_start(&batch, buffer, sizeof(buffer), 0, 0);
+    can_bridge_batch_append(&batch, &frame);
+    buffer[CAN_BRIDGE_HEADER_LEN + 9] = 9;
+
+    CHECK_EQUAL(-1, can_bridge_decode(buffer, can_bridge_batch_len(&batch), decoded, 4));
+}
+
+TEST(CANBridgeTestGroup, NoFilterLetsEverythingThrough)
+{
+    CHECK_TRUE(can_bridge_filter_match(NULL, 0, 0x1234));
+}
+
+TEST(CANBridgeTestGroup, FilterMatchesMaskedBits)
+{
+    can_bridge_filter_t filters[2] = {{0x100, 0xf00}, {0x42, 0xff}};
+
+    CHECK_TRUE(can_bridge_filter_match(filters, 2, 0x1ab));
+    CHECK_TRUE(can_bridge_filter_match(filters, 2, 0x342));
+    CHECK_FALSE(can_bridge_filter_match(filters, 2, 0x243));
+}
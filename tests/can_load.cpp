@@ -0,0 +1,101 @@
+#include "CppUTest/TestHarness.h"
+#include "../src/can_load.h"
+
+/* UAVCAN CAN IDs, see the transport layer specification. */
+static uint32_t message_id(uint16_t type_id, uint8_t src)
+{
+    return (16 << 24) | (type_id << 8) | src;
+}
+
+static uint32_t service_id(uint8_t type_id, bool request, uint8_t dst, uint8_t src)
+{
+    return (16 << 24) | (type_id << 16) | (request << 15) | (dst << 8) | (1 << 7) | src;
+}
+
+TEST_GROUP(CanLoadTestGroup)
+{
+    can_load_t load;
+
+    void setup()
+    {
+        can_load_init(&load);
+    }
+};
+
+TEST(CanLoadTestGroup, FrameBitsIncludeWorstCaseStuffing)
+{
+    CHECK_EQUAL(80, can_load_frame_bits(0));
+    CHECK_EQUAL(160, can_load_frame_bits(8));
+    CHECK_EQUAL(160, can_load_frame_bits(12));
+}
+
+TEST(CanLoadTestGroup, ReceivedMessageIsCountedOnSourceAndType)
+{
+    can_load_record(&load, message_id(20001, 42), 8, false);
+    can_load_record(&load, message_id(20001, 42), 3, false);
+
+    CHECK_EQUAL(1, load.nb_types);
+    CHECK_EQUAL(20001, load.types[0].key);
+    CHECK_EQUAL(2, load.types[0].count.frames);
+    CHECK_EQUAL(11, load.types[0].count.bytes);
+    CHECK_EQUAL(2, load.nodes[42].frames);
+    CHECK_EQUAL(2, load.rx_frames);
+    CHECK_EQUAL(0, load.tx_frames);
+}
+
+TEST(CanLoadTestGroup, SentMessageIsCountedAsBroadcast)
+{
+    can_load_record(&load, message_id(20001, 10), 8, true);
+
+    CHECK_EQUAL(1, load.nodes[CAN_LOAD_BROADCAST_NODE].frames);
+    CHECK_EQUAL(0, load.nodes[10].frames);
+    CHECK_EQUAL(1, load.tx_frames);
+}
+
+TEST(CanLoadTestGroup, ServiceIsCountedOnPeerNode)
+{
+    can_load_record(&load, service_id(5, true, 42, 10), 8, true);
+    can_load_record(&load, service_id(5, false, 10, 42), 4, false);
+
+    CHECK_EQUAL(1, load.nb_types);
+    CHECK_EQUAL(CAN_LOAD_TYPE_SERVICE | 5, load.types[0].key);
+    CHECK_EQUAL(2, load.types[0].count.frames);
+    CHECK_EQUAL(2, load.nodes[42].frames);
+    CHECK_EQUAL(0, load.nodes[10].frames);
+}
+
+TEST(CanLoadTestGroup, TypesBeyondTableAreCountedAsOther)
+{
+    for (int i = 0; i < CAN_LOAD_MAX_TYPES + 2; i++) {
+        can_load_record(&load, message_id(100 + i, 1), 1, false);
+    }
+
+    CHECK_EQUAL(CAN_LOAD_MAX_TYPES, load.nb_types);
+    CHECK_EQUAL(2, load.other_types.frames);
+}
+
+TEST(CanLoadTestGroup, UtilizationIsComputedOverWindow)
+{
+    for (int i = 0; i < 100; i++) {
+        can_load_record(&load, message_id(1, 1), 8, false);
+    }
+
+    // 100 * 160 bits in 32 ms at 1 Mbit/s
+    DOUBLES_EQUAL(0.5, can_load_update(&load, 32000, 1000000), 1e-6);
+    CHECK_EQUAL(0, load.window_bits);
+    CHECK_EQUAL(1, load.windows);
+    DOUBLES_EQUAL(0, can_load_update(&load, 32000, 1000000), 1e-6);
+}
+
+TEST(CanLoadTestGroup, RateScaleIsOneWhenDisabledOrUnderBudget)
+{
+    DOUBLES_EQUAL(1, can_load_rate_scale(3, 0.9, 0, 4), 1e-6);
+    DOUBLES_EQUAL(1, can_load_rate_scale(1, 0.2, 0.5, 4), 1e-6);
+}
+
+TEST(CanLoadTestGroup, RateScaleMovesTowardsBudgetWithinLimits)
+{
+    DOUBLES_EQUAL(1.5, can_load_rate_scale(1, 1.0, 0.5, 4), 1e-6);
+    DOUBLES_EQUAL(1.5, can_load_rate_scale(2, 0.25, 0.5, 4), 1e-6);
+    DOUBLES_EQUAL(4, can_load_rate_scale(4, 1.0, 0.5, 4), 1e-6);
+}
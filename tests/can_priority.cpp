@@ -0,0 +1,110 @@
+#include "CppUTest/TestHarness.h"
+#include "../src/can_priority.h"
+
+/* Tail byte of the last frame of a transfer, see the UAVCAN transport layer
+ * specification. */
+#define TAIL_END    0xc0
+#define TAIL_START  0x80
+
+static uint32_t frame_id(can_priority_class_t c)
+{
+    return (can_priority_of_class[c] << 24) | (1000 << 8) | 10;
+}
+
+TEST_GROUP(CanPriorityTestGroup)
+{
+    can_priority_stats_t s;
+
+    void setup()
+    {
+        can_priority_init(&s);
+    }
+};
+
+TEST(CanPriorityTestGroup, ClassesAreOrdered)
+{
+    CHECK(can_priority_of_class[CAN_PRIORITY_EMERGENCY_STOP] < can_priority_of_class[CAN_PRIORITY_SETPOINT]);
+    CHECK(can_priority_of_class[CAN_PRIORITY_SETPOINT] < can_priority_of_class[CAN_PRIORITY_FEEDBACK_CONFIG]);
+    CHECK(can_priority_of_class[CAN_PRIORITY_FEEDBACK_CONFIG] < can_priority_of_class[CAN_PRIORITY_BULK_CONFIG]);
+}
+
+TEST(CanPriorityTestGroup, FramesAreClassifiedByPriority)
+{
+    CHECK_EQUAL(CAN_PRIORITY_SETPOINT, can_priority_class_of_frame(frame_id(CAN_PRIORITY_SETPOINT)));
+    CHECK_EQUAL(CAN_PRIORITY_BULK_CONFIG, can_priority_class_of_frame(frame_id(CAN_PRIORITY_BULK_CONFIG)));
+    // libuavcan default priority
+    CHECK_EQUAL(-1, can_priority_class_of_frame(16 << 24));
+}
+
+TEST(CanPriorityTestGroup, LatencyIsMeasuredUntilLastFrame)
+{
+    can_priority_submitted(&s, CAN_PRIORITY_BULK_CONFIG, 1000);
+    CHECK_EQUAL(1, s.classes[CAN_PRIORITY_BULK_CONFIG].depth);
+
+    can_priority_frame_sent(&s, frame_id(CAN_PRIORITY_BULK_CONFIG), TAIL_START, 1100);
+    CHECK_EQUAL(1, s.classes[CAN_PRIORITY_BULK_CONFIG].depth);
+
+    can_priority_frame_sent(&s, frame_id(CAN_PRIORITY_BULK_CONFIG), TAIL_END, 1500);
+    CHECK_EQUAL(0, s.classes[CAN_PRIORITY_BULK_CONFIG].depth);
+    CHECK_EQUAL(1, s.classes[CAN_PRIORITY_BULK_CONFIG].sent);
+    CHECK_EQUAL(500, s.classes[CAN_PRIORITY_BULK_CONFIG].latency.max_us);
+}
+
+TEST(CanPriorityTestGroup, ClassesAreQueuedSeparately)
+{
+    can_priority_submitted(&s, CAN_PRIORITY_BULK_CONFIG, 0);
+    can_priority_submitted(&s, CAN_PRIORITY_SETPOINT, 100);
+    can_priority_frame_sent(&s, frame_id(CAN_PRIORITY_SETPOINT), TAIL_END, 150);
+
+    CHECK_EQUAL(50, s.classes[CAN_PRIORITY_SETPOINT].latency.max_us);
+    CHECK_EQUAL(1, s.classes[CAN_PRIORITY_BULK_CONFIG].depth);
+}
+
+TEST(CanPriorityTestGroup, MaxDepthIsKept)
+{
+    can_priority_submitted(&s, CAN_PRIORITY_SETPOINT, 0);
+    can_priority_submitted(&s, CAN_PRIORITY_SETPOINT, 0);
+    can_priority_frame_sent(&s, frame_id(CAN_PRIORITY_SETPOINT), TAIL_END, 10);
+    can_priority_frame_sent(&s, frame_id(CAN_PRIORITY_SETPOINT), TAIL_END, 10);
+
+    CHECK_EQUAL(0, s.classes[CAN_PRIORITY_SETPOINT].depth);
+    CHECK_EQUAL(2, s.classes[CAN_PRIORITY_SETPOINT].max_depth);
+
+    can_priority_clear(&s);
+    CHECK_EQUAL(0, s.classes[CAN_PRIORITY_SETPOINT].max_depth);
+    CHECK_EQUAL(0, s.classes[CAN_PRIORITY_SETPOINT].latency.count);
+}
+
+TEST(CanPriorityTestGroup, CancelledTransferIsForgotten)
+{
+    can_priority_submitted(&s, CAN_PRIORITY_SETPOINT, 0);
+    can_priority_cancelled(&s, CAN_PRIORITY_SETPOINT);
+
+    CHECK_EQUAL(0, s.classes[CAN_PRIORITY_SETPOINT].depth);
+    can_priority_frame_sent(&s, frame_id(CAN_PRIORITY_SETPOINT), TAIL_END, 10);
+    CHECK_EQUAL(0, s.classes[CAN_PRIORITY_SETPOINT].sent);
+}
+
+TEST(CanPriorityTestGroup, StaleTransfersExpire)
+{
+    can_priority_submitted(&s, CAN_PRIORITY_FEEDBACK_CONFIG, 0);
+    can_priority_submitted(&s, CAN_PRIORITY_FEEDBACK_CONFIG, 50000);
+
+    can_priority_expire(&s, CAN_PRIORITY_TIMEOUT_US + 1);
+
+    CHECK_EQUAL(1, s.classes[CAN_PRIORITY_FEEDBACK_CONFIG].depth);
+    CHECK_EQUAL(1, s.classes[CAN_PRIORITY_FEEDBACK_CONFIG].expired);
+}
+
+TEST(CanPriorityTestGroup, FullQueueDropsOldest)
+{
+    for (int i = 0; i < CAN_PRIORITY_QUEUE_LEN + 1; i++) {
+        can_priority_submitted(&s, CAN_PRIORITY_SETPOINT, i);
+    }
+    CHECK_EQUAL(CAN_PRIORITY_QUEUE_LEN, s.classes[CAN_PRIORITY_SETPOINT].depth);
+    CHECK_EQUAL(1, s.classes[CAN_PRIORITY_SETPOINT].expired);
+
+    can_priority_frame_sent(&s, frame_id(CAN_PRIORITY_SETPOINT), TAIL_END, 100);
+    // the transfer submitted at 1 is now the oldest
+    CHECK_EQUAL(99, s.classes[CAN_PRIORITY_SETPOINT].latency.max_us);
+}
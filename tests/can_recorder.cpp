@@ -0,0 +1,186 @@
+#include <string.h>
+#include "CppUTest/TestHarness.h"
+#include "../src/can_recorder.h"
+
+TEST_GROUP(CANRecorderTestGroup)
+{
+    can_bridge_frame_t frames[4];
+    can_recorder_t recorder;
+
+    void setup()
+    {
+        can_recorder_init(&recorder, frames, 4);
+    }
+
+    void record(uint32_t id)
+    {
+        can_bridge_frame_t f;
+        memset(&f, 0, sizeof(f));
+        f.id = id;
+        f.timestamp_us = id * 10;
+        can_recorder_record(&recorder, &f);
+    }
+
+    uint32_t id_at(uint32_t index)
+    {
+        const can_bridge_frame_t *f = can_recorder_get(&recorder, index);
+        return f != NULL ? f->id : 0xffffffff;
+    }
+};
+
+TEST(CANRecorderTestGroup, NothingIsRecordedUntilArmed)
+{
+    record(1);
+
+    CHECK_EQUAL(0, can_recorder_nb_frames(&recorder));
+    CHECK_EQUAL(CAN_RECORDER_STOPPED, recorder.state);
+}
+
+TEST(CANRecorderTestGroup, FramesAreReadOldestFirst)
+{
+    can_recorder_arm(&recorder, 0);
+    record(1);
+    record(2);
+
+    CHECK_EQUAL(2, can_recorder_nb_frames(&recorder));
+    CHECK_EQUAL(1, id_at(0));
+    CHECK_EQUAL(2, id_at(1));
+    POINTERS_EQUAL(NULL, can_recorder_get(&recorder, 2));
+}
+
+TEST(CANRecorderTestGroup, OldestFramesAreOverwritten)
+{
+    can_recorder_arm(&recorder, 0);
+    for (uint32_t id = 1; id <= 6; id++) {
+        record(id);
+    }
+
+    CHECK_EQUAL(4, can_recorder_nb_frames(&recorder));
+    CHECK_EQUAL(3, id_at(0));
+    CHECK_EQUAL(6, id_at(3));
+}
+
+TEST(CANRecorderTestGroup, TriggerWithoutPostFramesFreezes)
+{
+    can_recorder_arm(&recorder, 0);
+    record(1);
+    CHECK_TRUE(can_recorder_trigger(&recorder, CAN_RECORDER_TRIGGER_RPC, 1234));
+    record(2);
+
+    CHECK_EQUAL(CAN_RECORDER_FROZEN, recorder.state);
+    CHECK_EQUAL(1, can_recorder_nb_frames(&recorder));
+    CHECK_EQUAL(CAN_RECORDER_TRIGGER_RPC, recorder.trigger_reason);
+    CHECK_EQUAL(1234, recorder.trigger_time_us);
+    CHECK_EQUAL(1, can_recorder_trigger_index(&recorder));
+}
+
+TEST(CANRecorderTestGroup, PostTriggerFramesAreRecorded)
+{
+    can_recorder_arm(&recorder, 2);
+    for (uint32_t id = 1; id <= 5; id++) {
+        record(id);
+    }
+    can_recorder_trigger(&recorder, CAN_RECORDER_TRIGGER_SERVICE_TIMEOUT, 0);
+    record(6);
+    CHECK_EQUAL(CAN_RECORDER_TRIGGERED, recorder.state);
+    record(7);
+    record(8);
+
+    CHECK_EQUAL(CAN_RECORDER_FROZEN, recorder.state);
+    CHECK_EQUAL(4, id_at(0));
+    CHECK_EQUAL(7, id_at(3));
+    // frame 6 is the first one after the trigger
+    CHECK_EQUAL(2, can_recorder_trigger_index(&recorder));
+}
+
+TEST(CANRecorderTestGroup, PostTriggerIsLimitedToKeepTheTrigger)
+{
+    can_recorder_arm(&recorder, 100);
+    record(1);
+    can_recorder_trigger(&recorder, CAN_RECORDER_TRIGGER_RPC, 0);
+    for (uint32_t id = 2; id <= 10; id++) {
+        record(id);
+    }
+
+    CHECK_EQUAL(CAN_RECORDER_FROZEN, recorder.state);
+    CHECK_EQUAL(1, id_at(0));
+    CHECK_EQUAL(1, can_recorder_trigger_index(&recorder));
+}
+
+TEST(CANRecorderTestGroup, OnlyTheFirstTriggerCounts)
+{
+    can_recorder_arm(&recorder, 1);
+    can_recorder_trigger(&recorder, CAN_RECORDER_TRIGGER_TRAJECTORY_UNDERRUN, 10);
+
+    CHECK_FALSE(can_recorder_trigger(&recorder, CAN_RECORDER_TRIGGER_RPC, 20));
+    can_recorder_freeze(&recorder, CAN_RECORDER_TRIGGER_EMERGENCY_STOP, 30);
+
+    CHECK_EQUAL(CAN_RECORDER_FROZEN, recorder.state);
+    CHECK_EQUAL(CAN_RECORDER_TRIGGER_TRAJECTORY_UNDERRUN, recorder.trigger_reason);
+    CHECK_EQUAL(10, recorder.trigger_time_us);
+}
+
+TEST(CANRecorderTestGroup, FreezeSkipsPostTriggerFrames)
+{
+    can_recorder_arm(&recorder, 2);
+    record(1);
+    can_recorder_freeze(&recorder, CAN_RECORDER_TRIGGER_EMERGENCY_STOP, 0);
+    record(2);
+
+    CHECK_EQUAL(CAN_RECORDER_FROZEN, recorder.state);
+    CHECK_EQUAL(1, can_recorder_nb_frames(&recorder));
+}
+
+TEST(CANRecorderTestGroup, FiltersApplyToRecording)
+{
+    can_bridge_filter_t filter = {.id = 0x100, .mask = 0xf00};
+    can_recorder_set_filters(&recorder, &filter, 1);
+    can_recorder_arm(&recorder, 0);
+    record(0x123);
+    record(0x223);
+
+    CHECK_EQUAL(1, can_recorder_nb_frames(&recorder));
+    CHECK_EQUAL(0x123, id_at(0));
+}
+
+TEST(CANRecorderTestGroup, ArmingDiscardsTheCapture)
+{
+    can_recorder_arm(&recorder, 0);
+    record(1);
+    can_recorder_trigger(&recorder, CAN_RECORDER_TRIGGER_RPC, 0);
+    can_recorder_arm(&recorder, 0);
+
+    CHECK_EQUAL(0, can_recorder_nb_frames(&recorder));
+    CHECK_EQUAL(-1, can_recorder_trigger_index(&recorder));
+    CHECK_EQUAL(CAN_RECORDER_RECORDING, recorder.state);
+}
+
+TEST(CANRecorderTestGroup, FrozenCaptureIsRestored)
+{
+    can_recorder_arm(&recorder, 0);
+    record(1);
+    record(2);
+    can_recorder_trigger(&recorder, CAN_RECORDER_TRIGGER_EMERGENCY_STOP, 0);
+
+    CHECK_TRUE(can_recorder_restore(&recorder, frames, 4));
+    CHECK_EQUAL(2, can_recorder_nb_frames(&recorder));
+    CHECK_EQUAL(CAN_RECORDER_TRIGGER_EMERGENCY_STOP, recorder.trigger_reason);
+}
+
+TEST(CANRecorderTestGroup, GarbageIsNotRestored)
+{
+    memset(&recorder, 0x5a, sizeof(recorder));
+
+    CHECK_FALSE(can_recorder_restore(&recorder, frames, 4));
+    CHECK_EQUAL(CAN_RECORDER_STOPPED, recorder.state);
+    CHECK_EQUAL(0, can_recorder_nb_frames(&recorder));
+}
+
+TEST(CANRecorderTestGroup, RecordingCaptureIsNotRestored)
+{
+    can_recorder_arm(&recorder, 0);
+    record(1);
+
+    CHECK_FALSE(can_recorder_restore(&recorder, frames, 4));
+    CHECK_EQUAL(0, can_recorder_nb_frames(&recorder));
+}
@@ -0,0 +1,189 @@
+#include "CppUTest/TestHarness.h"
+#include "../src/config_queue.h"
+
+#define ENABLE  (1 << 0)
+#define FULL    (1 << 1)
+#define PID_A   (1 << 2)
+#define PID_B   (1 << 3)
+#define STREAM  (1 << 4)
+
+TEST_GROUP(ConfigQueueTestGroup)
+{
+    config_queue_t queue;
+
+    void setup()
+    {
+        config_queue_init(&queue, FULL, PID_A | PID_B);
+    }
+};
+
+TEST(ConfigQueueTestGroup, EmptyQueueHasNothingToSend)
+{
+    CHECK_EQUAL(0, config_queue_next(&queue, 0));
+    CHECK_TRUE(config_queue_is_idle(&queue));
+}
+
+TEST(ConfigQueueTestGroup, ItemsAreSentLowestFirst)
+{
+    config_queue_request(&queue, STREAM | PID_B);
+
+    CHECK_EQUAL(PID_B, config_queue_next(&queue, 0));
+    config_queue_complete(&queue, true, 0);
+    CHECK_EQUAL(STREAM, config_queue_next(&queue, 0));
+    config_queue_complete(&queue, true, 0);
+    CHECK_EQUAL(0, config_queue_next(&queue, 0));
+    CHECK_EQUAL(2, queue.sent);
+}
+
+TEST(ConfigQueueTestGroup, RepeatedRequestsAreCoalesced)
+{
+    config_queue_request(&queue, PID_A);
+    config_queue_request(&queue, PID_A);
+
+    CHECK_EQUAL(PID_A, config_queue_next(&queue, 0));
+    config_queue_complete(&queue, true, 0);
+    CHECK_EQUAL(0, config_queue_next(&queue, 0));
+}
+
+TEST(ConfigQueueTestGroup, FullItemCoversOtherItems)
+{
+    config_queue_request(&queue, PID_A | STREAM);
+    config_queue_request(&queue, FULL);
+    // the caller wrote the values of PID_B in the full item
+    config_queue_request(&queue, PID_B);
+
+    CHECK_EQUAL(FULL | STREAM, queue.pending);
+}
+
+TEST(ConfigQueueTestGroup, OnlyOneCallInFlight)
+{
+    config_queue_request(&queue, PID_A | PID_B);
+
+    CHECK_EQUAL(PID_A, config_queue_next(&queue, 0));
+    CHECK_EQUAL(0, config_queue_next(&queue, 0));
+    CHECK_FALSE(config_queue_is_idle(&queue));
+}
+
+TEST(ConfigQueueTestGroup, ItemRequestedWhileInFlightIsSentAgain)
+{
+    config_queue_request(&queue, PID_A);
+    config_queue_next(&queue, 0);
+    config_queue_request(&queue, PID_A);
+    config_queue_complete(&queue, true, 0);
+
+    CHECK_EQUAL(PID_A, config_queue_next(&queue, 0));
+}
+
+TEST(ConfigQueueTestGroup, FailedItemIsRetriedAfterBackoff)
+{
+    config_queue_request(&queue, PID_A);
+    config_queue_next(&queue, 1000);
+    config_queue_complete(&queue, false, 1000);
+
+    CHECK_EQUAL(1, queue.failed);
+    CHECK_EQUAL(0, config_queue_next(&queue, 1000 + CONFIG_QUEUE_BACKOFF_MIN_US - 1));
+    CHECK_EQUAL(PID_A, config_queue_next(&queue, 1000 + CONFIG_QUEUE_BACKOFF_MIN_US));
+}
+
+TEST(ConfigQueueTestGroup, BackoffDoublesUpToMaximumAndResetsOnSuccess)
+{
+    uint32_t now = 0;
+    config_queue_request(&queue, PID_A);
+
+    for (int i = 0; i < 10; i++) {
+        now += CONFIG_QUEUE_BACKOFF_MAX_US;
+        config_queue_next(&queue, now);
+        config_queue_complete(&queue, false, now);
+    }
+    CHECK_EQUAL(CONFIG_QUEUE_BACKOFF_MAX_US, queue.backoff_us);
+
+    now += CONFIG_QUEUE_BACKOFF_MAX_US;
+    CHECK_EQUAL(PID_A, config_queue_next(&queue, now));
+    config_queue_complete(&queue, true, now);
+    CHECK_EQUAL(0, queue.backoff_us);
+
+    config_queue_request(&queue, STREAM);
+    CHECK_EQUAL(STREAM, config_queue_next(&queue, now));
+}
+
+TEST(ConfigQueueTestGroup, FailedItemIsCoveredByNewFullRequest)
+{
+    config_queue_request(&queue, PID_A);
+    config_queue_next(&queue, 0);
+    config_queue_request(&queue, FULL);
+    config_queue_complete(&queue, false, 0);
+
+    CHECK_EQUAL(FULL, queue.pending);
+}
+
+TEST(ConfigQueueTestGroup, DisableOvertakesQueuedFullConfig)
+{
+    config_queue_request(&queue, FULL | STREAM);
+    config_queue_request_urgent(&queue, ENABLE);
+
+    CHECK_EQUAL(ENABLE, config_queue_next(&queue, 0));
+}
+
+TEST(ConfigQueueTestGroup, UrgentRequestCancelsBackoff)
+{
+    config_queue_request(&queue, FULL);
+    config_queue_next(&queue, 1000);
+    config_queue_complete(&queue, false, 1000);
+
+    config_queue_request_urgent(&queue, ENABLE);
+
+    CHECK_EQUAL(ENABLE, config_queue_next(&queue, 1000));
+    config_queue_complete(&queue, true, 1000);
+    CHECK_EQUAL(FULL, config_queue_next(&queue, 1000));
+}
+
+/* Follows the contract of config_queue.h: a covered item is also written to
+ * the full item, and calls send the data current when they are made. */
+struct config_sim {
+    config_queue_t *queue;
+    float gain;         // data of PID_A
+    float full_gain;    // same gain, in the data of FULL
+    float board_gain;
+
+    void change_gain(float g)
+    {
+        gain = g;
+        full_gain = g;
+        config_queue_request(queue, PID_A);
+    }
+
+    float send(uint32_t now)
+    {
+        uint32_t item = config_queue_next(queue, now);
+        return item == FULL ? full_gain : gain;
+    }
+};
+
+TEST(ConfigQueueTestGroup, GainChangedDuringFullRetryIsNotLost)
+{
+    config_sim sim = {&queue, 1, 1, 0};
+    config_queue_request(&queue, FULL);
+
+    // full config read at t0 times out, gains change at t1
+    sim.send(0);
+    sim.change_gain(2);
+    config_queue_complete(&queue, false, 0);
+
+    CHECK_EQUAL(FULL, queue.pending);
+    sim.board_gain = sim.send(CONFIG_QUEUE_BACKOFF_MIN_US);
+    config_queue_complete(&queue, true, CONFIG_QUEUE_BACKOFF_MIN_US);
+    CHECK_EQUAL(2, sim.board_gain);
+}
+
+TEST(ConfigQueueTestGroup, GainChangedDuringFullCallIsSentAfter)
+{
+    config_sim sim = {&queue, 1, 1, 0};
+    config_queue_request(&queue, FULL);
+
+    sim.board_gain = sim.send(0);
+    sim.change_gain(2);
+    config_queue_complete(&queue, true, 0);
+
+    sim.board_gain = sim.send(0);
+    CHECK_EQUAL(2, sim.board_gain);
+}
@@ -0,0 +1,284 @@
+#include <string.h>
+#include "CppUTest/TestHarness.h"
+#include "../src/firmware_update.h"
+
+#define IMAGE_SIZE 1000
+
+TEST_GROUP(FirmwareUpdateTestGroup)
+{
+    firmware_update_t u;
+    uint8_t image[IMAGE_SIZE];
+    uint8_t chunk[FIRMWARE_UPDATE_CHUNK_LEN];
+
+    void setup()
+    {
+        for (int i = 0; i < IMAGE_SIZE; i++) {
+            image[i] = i * 7;
+        }
+        firmware_update_init(&u);
+        firmware_update_set_image(&u, image, sizeof(image));
+    }
+
+    void start(uint8_t id, uint32_t max_concurrent = 8)
+    {
+        firmware_update_start(&u, &id, 1, max_concurrent, 100000, 0);
+    }
+
+    void begin(uint8_t id, uint32_t now = 0)
+    {
+        CHECK_EQUAL(id, firmware_update_poll(&u, now, true));
+        firmware_update_begin_result(&u, id, true, 0, now);
+    }
+};
+
+TEST(FirmwareUpdateTestGroup, NothingStartsWithoutImage)
+{
+    uint8_t id = 42;
+    firmware_update_init(&u);
+
+    CHECK_FALSE(firmware_update_start(&u, &id, 1, 8, 100000, 0));
+    CHECK_EQUAL(0, firmware_update_poll(&u, 0, true));
+}
+
+TEST(FirmwareUpdateTestGroup, NodeIsAskedToBeginUpdate)
+{
+    start(42);
+
+    CHECK_EQUAL(42, firmware_update_poll(&u, 0, true));
+    CHECK_EQUAL(FIRMWARE_UPDATE_BEGINNING, u.nodes[42].state);
+    CHECK_EQUAL(0, firmware_update_poll(&u, 0, true));
+}
+
+TEST(FirmwareUpdateTestGroup, ImageIsServedByChunks)
+{
+    start(42);
+    begin(42);
+
+    CHECK_EQUAL(FIRMWARE_UPDATE_CHUNK_LEN, firmware_update_read(&u, 42, 0, chunk, 10));
+    CHECK_EQUAL(image[1], chunk[1]);
+    CHECK_EQUAL(FIRMWARE_UPDATE_READING, u.nodes[42].state);
+    CHECK_EQUAL(FIRMWARE_UPDATE_CHUNK_LEN, u.nodes[42].progress);
+
+    CHECK_EQUAL(IMAGE_SIZE - 768, firmware_update_read(&u, 42, 768, chunk, 20));
+    CHECK_EQUAL(image[769], chunk[1]);
+    CHECK_EQUAL(FIRMWARE_UPDATE_DONE, u.nodes[42].state);
+    CHECK_EQUAL(IMAGE_SIZE, u.nodes[42].progress);
+    CHECK_FALSE(firmware_update_is_running(&u));
+}
+
+TEST(FirmwareUpdateTestGroup, ImageOfWholeChunksEndsWithAnEmptyOne)
+{
+    firmware_update_set_image(&u, image, 2 * FIRMWARE_UPDATE_CHUNK_LEN);
+    start(42);
+    begin(42);
+
+    CHECK_EQUAL(FIRMWARE_UPDATE_CHUNK_LEN, firmware_update_read(&u, 42, 256, chunk, 0));
+    CHECK_EQUAL(FIRMWARE_UPDATE_READING, u.nodes[42].state);
+    CHECK_EQUAL(0, firmware_update_read(&u, 42, 512, chunk, 0));
+    CHECK_EQUAL(FIRMWARE_UPDATE_DONE, u.nodes[42].state);
+}
+
+TEST(FirmwareUpdateTestGroup, NodesNotUpdatedCannotRead)
+{
+    CHECK_EQUAL(-1, firmware_update_read(&u, 42, 0, chunk, 0));
+}
+
+TEST(FirmwareUpdateTestGroup, ConcurrentUpdatesAreLimited)
+{
+    uint8_t ids[] = {10, 11, 12};
+    firmware_update_start(&u, ids, 3, 2, 100000, 0);
+
+    uint32_t t = FIRMWARE_UPDATE_RATE_WINDOW_US;
+    CHECK_EQUAL(10, firmware_update_poll(&u, 0, true));
+    CHECK_EQUAL(11, firmware_update_poll(&u, t, true));
+    CHECK_EQUAL(0, firmware_update_poll(&u, 2 * t, true));
+
+    firmware_update_begin_result(&u, 10, true, 0, 2 * t);
+    firmware_update_read(&u, 10, 768, chunk, 2 * t);
+    CHECK_EQUAL(12, firmware_update_poll(&u, 2 * t, true));
+}
+
+TEST(FirmwareUpdateTestGroup, NodesStartOnePerWindow)
+{
+    uint8_t ids[] = {10, 11};
+    firmware_update_start(&u, ids, 2, 8, 100000, 0);
+
+    CHECK_EQUAL(10, firmware_update_poll(&u, 0, true));
+    CHECK_EQUAL(0, firmware_update_poll(&u, FIRMWARE_UPDATE_RATE_WINDOW_US - 1, true));
+    CHECK_EQUAL(11, firmware_update_poll(&u, FIRMWARE_UPDATE_RATE_WINDOW_US, true));
+}
+
+TEST(FirmwareUpdateTestGroup, CallerCanHoldNodesBack)
+{
+    start(42);
+
+    CHECK_EQUAL(0, firmware_update_poll(&u, 0, false));
+    CHECK_EQUAL(42, firmware_update_poll(&u, 0, true));
+}
+
+TEST(FirmwareUpdateTestGroup, NodesAreHeldBackAboveBudget)
+{
+    uint8_t ids[] = {10, 11};
+    firmware_update_start(&u, ids, 2, 8, 1000, 0);
+    begin(10);
+
+    // 512 bytes in 100 ms is above 1000 bytes/s
+    firmware_update_read(&u, 10, 0, chunk, 10);
+    firmware_update_read(&u, 10, 256, chunk, 20);
+    CHECK_EQUAL(0, firmware_update_poll(&u, FIRMWARE_UPDATE_RATE_WINDOW_US, true));
+
+    // nothing was read during the next window
+    CHECK_EQUAL(11, firmware_update_poll(&u, 2 * FIRMWARE_UPDATE_RATE_WINDOW_US, true));
+}
+
+TEST(FirmwareUpdateTestGroup, BeginIsRetriedThenFails)
+{
+    start(42);
+
+    for (int i = 0; i < FIRMWARE_UPDATE_BEGIN_ATTEMPTS; i++) {
+        CHECK_EQUAL(42, firmware_update_poll(&u, 0, true));
+        firmware_update_begin_result(&u, 42, false, 0, 0);
+    }
+
+    CHECK_EQUAL(FIRMWARE_UPDATE_FAILED, u.nodes[42].state);
+    CHECK_EQUAL(0, firmware_update_poll(&u, 0, true));
+}
+
+TEST(FirmwareUpdateTestGroup, BeginErrorFails)
+{
+    start(42);
+    firmware_update_poll(&u, 0, true);
+    firmware_update_begin_result(&u, 42, true, 1, 0);
+
+    CHECK_EQUAL(FIRMWARE_UPDATE_FAILED, u.nodes[42].state);
+    CHECK_EQUAL(1, u.nodes[42].error);
+}
+
+TEST(FirmwareUpdateTestGroup, StalledNodeFails)
+{
+    start(42);
+    begin(42, 0);
+    firmware_update_read(&u, 42, 0, chunk, 1000);
+
+    firmware_update_poll(&u, 1000 + FIRMWARE_UPDATE_READ_TIMEOUT_US, true);
+    CHECK_EQUAL(FIRMWARE_UPDATE_READING, u.nodes[42].state);
+    firmware_update_poll(&u, 1001 + FIRMWARE_UPDATE_READ_TIMEOUT_US, true);
+    CHECK_EQUAL(FIRMWARE_UPDATE_FAILED, u.nodes[42].state);
+}
+
+TEST(FirmwareUpdateTestGroup, ImageCannotChangeDuringUpdate)
+{
+    start(42);
+
+    CHECK_FALSE(firmware_update_set_image(&u, image, 10));
+    CHECK_EQUAL(IMAGE_SIZE, u.image_size);
+}
+
+TEST(FirmwareUpdateTestGroup, FailedNodeCanBeRestarted)
+{
+    start(42);
+    firmware_update_poll(&u, 0, true);
+    firmware_update_begin_result(&u, 42, true, 1, 0);
+    start(42);
+
+    CHECK_EQUAL(FIRMWARE_UPDATE_PENDING, u.nodes[42].state);
+    CHECK_EQUAL(0, u.nodes[42].attempts);
+}
+
+/* Nodes read the next chunk some time after getting the previous one, which
+ * is dominated by the flash write on the node. */
+struct simulated_node {
+    uint8_t id;
+    bool begun;
+    uint32_t offset;
+    uint32_t next_read_us;
+    uint8_t flash[32768];
+};
+
+static uint32_t simulate(firmware_update_t *u, simulated_node *nodes, int nb_nodes,
+                         uint32_t chunk_latency_us)
+{
+    uint8_t chunk[FIRMWARE_UPDATE_CHUNK_LEN];
+    uint32_t now;
+
+    for (now = 0; now < 60000000; now += 1000) {
+        uint8_t id;
+        while ((id = firmware_update_poll(u, now, true)) != 0) {
+            for (int i = 0; i < nb_nodes; i++) {
+                if (nodes[i].id == id) {
+                    nodes[i].begun = true;
+                    nodes[i].next_read_us = now + chunk_latency_us;
+                }
+            }
+            firmware_update_begin_result(u, id, true, 0, now);
+        }
+        for (int i = 0; i < nb_nodes; i++) {
+            simulated_node *n = &nodes[i];
+            if (!n->begun || now < n->next_read_us) {
+                continue;
+            }
+            int len = firmware_update_read(u, n->id, n->offset, chunk, now);
+            memcpy(&n->flash[n->offset], chunk, len);
+            n->offset += len;
+            n->next_read_us = now + chunk_latency_us;
+            if (len < FIRMWARE_UPDATE_CHUNK_LEN) {
+                n->begun = false;
+            }
+        }
+        if (!firmware_update_is_running(u)) {
+            break;
+        }
+    }
+    return now;
+}
+
+TEST(FirmwareUpdateTestGroup, RobotUpdatesAsFastAsOneBoard)
+{
+    static uint8_t big_image[32000];
+    static simulated_node nodes[8];
+    uint8_t ids[8];
+    for (unsigned i = 0; i < sizeof(big_image); i++) {
+        big_image[i] = i * 13;
+    }
+    firmware_update_set_image(&u, big_image, sizeof(big_image));
+
+    memset(nodes, 0, sizeof(nodes));
+    nodes[0].id = 20;
+    ids[0] = 20;
+    firmware_update_start(&u, ids, 1, 8, 100000, 0);
+    uint32_t one_board = simulate(&u, nodes, 1, 20000);
+
+    memset(nodes, 0, sizeof(nodes));
+    for (int i = 0; i < 8; i++) {
+        nodes[i].id = ids[i] = 20 + i;
+    }
+    firmware_update_start(&u, ids, 8, 8, 100000, 0);
+    uint32_t robot = simulate(&u, nodes, 8, 20000);
+
+    CHECK_EQUAL(8, firmware_update_count(&u, FIRMWARE_UPDATE_DONE));
+    for (int i = 0; i < 8; i++) {
+        CHECK_EQUAL(0, memcmp(nodes[i].flash, big_image, sizeof(big_image)));
+    }
+    // nodes start one per rate window
+    CHECK(robot < one_board + 8 * FIRMWARE_UPDATE_RATE_WINDOW_US);
+}
+
+TEST(FirmwareUpdateTestGroup, BudgetLimitsConcurrency)
+{
+    static uint8_t big_image[4000];
+    static simulated_node nodes[8];
+    uint8_t ids[8];
+    firmware_update_set_image(&u, big_image, sizeof(big_image));
+
+    memset(nodes, 0, sizeof(nodes));
+    for (int i = 0; i < 8; i++) {
+        nodes[i].id = ids[i] = 20 + i;
+    }
+    // one node reads 256 bytes every 20 ms, 12800 bytes/s
+    firmware_update_start(&u, ids, 8, 8, 20000, 0);
+    uint32_t duration = simulate(&u, nodes, 8, 20000);
+
+    CHECK_EQUAL(8, firmware_update_count(&u, FIRMWARE_UPDATE_DONE));
+    // 8 * 4000 bytes cannot go much faster than the budget
+    CHECK(duration > 1000000);
+}
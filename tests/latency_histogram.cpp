@@ -0,0 +1,68 @@
+#include "CppUTest/TestHarness.h"
+#include "../src/latency_histogram.h"
+
+TEST_GROUP(LatencyHistogramTestGroup)
+{
+    latency_histogram_t h;
+
+    void setup()
+    {
+        latency_histogram_init(&h);
+    }
+};
+
+TEST(LatencyHistogramTestGroup, LatenciesAreBinnedByPowersOfTwo)
+{
+    latency_histogram_record(&h, 0);
+    latency_histogram_record(&h, 1);
+    latency_histogram_record(&h, 2);
+    latency_histogram_record(&h, 3);
+    latency_histogram_record(&h, 4);
+    latency_histogram_record(&h, 1000);
+
+    CHECK_EQUAL(2, h.bins[0]);
+    CHECK_EQUAL(2, h.bins[1]);
+    CHECK_EQUAL(1, h.bins[2]);
+    // 512 <= 1000 < 1024
+    CHECK_EQUAL(1, h.bins[9]);
+    CHECK_EQUAL(6, h.count);
+    CHECK_EQUAL(1000, h.max_us);
+}
+
+TEST(LatencyHistogramTestGroup, LastBinTakesEverythingAbove)
+{
+    latency_histogram_record(&h, 0xffffffff);
+
+    CHECK_EQUAL(1, h.bins[LATENCY_HISTOGRAM_NB_BINS - 1]);
+}
+
+TEST(LatencyHistogramTestGroup, PercentileIsEmptyWithoutSamples)
+{
+    CHECK_EQUAL(0, latency_histogram_percentile(&h, 99));
+}
+
+TEST(LatencyHistogramTestGroup, PercentileGivesUpperBoundOfBin)
+{
+    for (int i = 0; i < 99; i++) {
+        latency_histogram_record(&h, 10);
+    }
+    latency_histogram_record(&h, 5000);
+
+    CHECK_EQUAL(16, latency_histogram_percentile(&h, 50));
+    CHECK_EQUAL(16, latency_histogram_percentile(&h, 99));
+    CHECK_EQUAL(5000, latency_histogram_percentile(&h, 100));
+}
+
+TEST(LatencyHistogramTestGroup, PercentileIsAtMostTheMaximum)
+{
+    latency_histogram_record(&h, 9);
+
+    CHECK_EQUAL(9, latency_histogram_percentile(&h, 50));
+}
+
+TEST(LatencyHistogramTestGroup, PercentileOfHugeLatencies)
+{
+    latency_histogram_record(&h, 200000);
+
+    CHECK_EQUAL(200000, latency_histogram_percentile(&h, 90));
+}
@@ -0,0 +1,112 @@
+#include "CppUTest/TestHarness.h"
+#include "../src/msg_queue.h"
+
+static int a, b, c;
+
+TEST_GROUP(MessageQueueTestGroup)
+{
+    msg_queue_t queue;
+    void *dropped;
+};
+
+TEST(MessageQueueTestGroup, InvalidDepthIsRejected)
+{
+    CHECK_EQUAL(-1, msg_queue_init(&queue, 0, 100, MSG_QUEUE_REJECT));
+    CHECK_EQUAL(-1, msg_queue_init(&queue, MSG_QUEUE_MAX_DEPTH + 1, 100, MSG_QUEUE_REJECT));
+    CHECK_EQUAL(0, msg_queue_init(&queue, MSG_QUEUE_MAX_DEPTH, 100, MSG_QUEUE_REJECT));
+}
+
+TEST(MessageQueueTestGroup, EmptyQueueReturnsNull)
+{
+    msg_queue_init(&queue, 2, 100, MSG_QUEUE_REJECT);
+
+    POINTERS_EQUAL(NULL, msg_queue_pop(&queue));
+}
+
+TEST(MessageQueueTestGroup, ItemsComeOutInOrder)
+{
+    msg_queue_init(&queue, 2, 100, MSG_QUEUE_REJECT);
+
+    CHECK_TRUE(msg_queue_push(&queue, &a, 1, &dropped));
+    POINTERS_EQUAL(NULL, dropped);
+    CHECK_TRUE(msg_queue_push(&queue, &b, 1, &dropped));
+    POINTERS_EQUAL(&a, msg_queue_pop(&queue));
+    CHECK_TRUE(msg_queue_push(&queue, &c, 1, &dropped));
+    POINTERS_EQUAL(&b, msg_queue_pop(&queue));
+    POINTERS_EQUAL(&c, msg_queue_pop(&queue));
+    POINTERS_EQUAL(NULL, msg_queue_pop(&queue));
+}
+
+TEST(MessageQueueTestGroup, FullQueueRejectsNewItem)
+{
+    msg_queue_init(&queue, 2, 100, MSG_QUEUE_REJECT);
+    msg_queue_push(&queue, &a, 1, &dropped);
+    msg_queue_push(&queue, &b, 1, &dropped);
+
+    CHECK_FALSE(msg_queue_push(&queue, &c, 1, &dropped));
+    POINTERS_EQUAL(&c, dropped);
+    POINTERS_EQUAL(&a, msg_queue_pop(&queue));
+    POINTERS_EQUAL(&b, msg_queue_pop(&queue));
+}
+
+TEST(MessageQueueTestGroup, FullQueueDropsOldestItem)
+{
+    msg_queue_init(&queue, 2, 100, MSG_QUEUE_DROP_OLDEST);
+    msg_queue_push(&queue, &a, 1, &dropped);
+    msg_queue_push(&queue, &b, 1, &dropped);
+
+    CHECK_TRUE(msg_queue_push(&queue, &c, 1, &dropped));
+    POINTERS_EQUAL(&a, dropped);
+    POINTERS_EQUAL(&b, msg_queue_pop(&queue));
+    POINTERS_EQUAL(&c, msg_queue_pop(&queue));
+}
+
+TEST(MessageQueueTestGroup, CountsReceivedAndDroppedItems)
+{
+    msg_queue_init(&queue, 1, 100, MSG_QUEUE_DROP_OLDEST);
+    msg_queue_push(&queue, &a, 1, &dropped);
+    msg_queue_push(&queue, &b, 1, &dropped);
+    msg_queue_push(&queue, &c, 1, &dropped);
+
+    CHECK_EQUAL(3, queue.received);
+    CHECK_EQUAL(2, queue.dropped);
+}
+
+TEST(MessageQueueTestGroup, ItemAboveCostBoundIsRejected)
+{
+    msg_queue_init(&queue, 4, 5, MSG_QUEUE_REJECT);
+    CHECK_TRUE(msg_queue_push(&queue, &a, 3, &dropped));
+
+    CHECK_FALSE(msg_queue_push(&queue, &b, 3, &dropped));
+    POINTERS_EQUAL(&b, dropped);
+    CHECK_TRUE(msg_queue_push(&queue, &c, 2, &dropped));
+    CHECK_EQUAL(5, queue.cost);
+}
+
+TEST(MessageQueueTestGroup, CostIsReleasedWhenPopped)
+{
+    msg_queue_init(&queue, 4, 5, MSG_QUEUE_REJECT);
+    msg_queue_push(&queue, &a, 5, &dropped);
+    msg_queue_pop(&queue);
+
+    CHECK_EQUAL(0, queue.cost);
+    CHECK_TRUE(msg_queue_push(&queue, &b, 5, &dropped));
+}
+
+TEST(MessageQueueTestGroup, CostBoundDoesNotFlushQueue)
+{
+    msg_queue_init(&queue, 2, 4, MSG_QUEUE_DROP_OLDEST);
+    msg_queue_push(&queue, &a, 2, &dropped);
+    msg_queue_push(&queue, &b, 2, &dropped);
+
+    // evicting a only frees 2
+    CHECK_FALSE(msg_queue_push(&queue, &c, 3, &dropped));
+    POINTERS_EQUAL(&c, dropped);
+    POINTERS_EQUAL(&a, msg_queue_pop(&queue));
+
+    // with a full queue, evicting b makes room
+    msg_queue_push(&queue, &a, 2, &dropped);
+    CHECK_TRUE(msg_queue_push(&queue, &c, 2, &dropped));
+    POINTERS_EQUAL(&b, dropped);
+    CHECK_EQUAL(4, queue.cost);
+}
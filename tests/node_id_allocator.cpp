@@ -0,0 +1,257 @@
+#include <string.h>
+#include "CppUTest/TestHarness.h"
+#include "../src/node_id_allocator.h"
+
+#define MASTER_NODE_ID 10
+#define TABLE_LEN 4
+
+/* Client side of the allocation protocol, as run by the boards. */
+struct simulated_board {
+    uint8_t unique_id[NODE_ID_ALLOCATOR_UNIQUE_ID_LEN];
+    uint8_t preferred_node_id;
+    uint8_t node_id;
+    uint8_t confirmed_len;
+
+    simulated_board(uint8_t seed, uint8_t preferred = 0)
+    {
+        for (int i = 0; i < NODE_ID_ALLOCATOR_UNIQUE_ID_LEN; i++) {
+            unique_id[i] = seed + i;
+        }
+        preferred_node_id = preferred;
+        node_id = NODE_ID_ALLOCATOR_NONE;
+        confirmed_len = 0;
+    }
+
+    node_id_allocator_msg_t next_request(void)
+    {
+        node_id_allocator_msg_t msg;
+        int len = NODE_ID_ALLOCATOR_UNIQUE_ID_LEN - confirmed_len;
+        if (len > NODE_ID_ALLOCATOR_MAX_PART_LEN) {
+            len = NODE_ID_ALLOCATOR_MAX_PART_LEN;
+        }
+        msg.node_id = preferred_node_id;
+        msg.first_part_of_unique_id = confirmed_len == 0;
+        memcpy(msg.unique_id, &unique_id[confirmed_len], len);
+        msg.unique_id_len = len;
+        return msg;
+    }
+
+    void receive(const node_id_allocator_msg_t *msg)
+    {
+        if (memcmp(msg->unique_id, unique_id, msg->unique_id_len) != 0) {
+            confirmed_len = 0; // someone else's, start over
+            return;
+        }
+        confirmed_len = msg->unique_id_len;
+        if (msg->unique_id_len == NODE_ID_ALLOCATOR_UNIQUE_ID_LEN) {
+            node_id = msg->node_id;
+        }
+    }
+};
+
+static int nb_persisted;
+static uint8_t last_persisted_node_id;
+
+static void persist(const uint8_t *unique_id, uint8_t node_id, void *arg)
+{
+    (void)unique_id;
+    (void)arg;
+    nb_persisted++;
+    last_persisted_node_id = node_id;
+}
+
+TEST_GROUP(NodeIdAllocatorTestGroup)
+{
+    node_id_allocation_t table[TABLE_LEN];
+    node_id_allocator_t allocator;
+    uint32_t now;
+
+    void setup()
+    {
+        nb_persisted = 0;
+        now = 0;
+        node_id_allocator_init(&allocator, table, TABLE_LEN, MASTER_NODE_ID, persist, NULL);
+    }
+
+    /* Boards send follow-ups right after a matching response and first
+     * parts much less often, so a board which got the first response
+     * usually completes before anyone else starts. */
+    void run_bus(simulated_board *boards, int nb_boards)
+    {
+        int next_first_part = 0;
+        for (int turn = 0; turn < 100; turn++) {
+            int sender = -1;
+            for (int i = 0; i < nb_boards; i++) {
+                if (boards[i].node_id == NODE_ID_ALLOCATOR_NONE && boards[i].confirmed_len > 0) {
+                    sender = i;
+                }
+            }
+            for (int i = 0; i < nb_boards && sender < 0; i++) {
+                int candidate = (next_first_part + i) % nb_boards;
+                if (boards[candidate].node_id == NODE_ID_ALLOCATOR_NONE) {
+                    sender = candidate;
+                    next_first_part = candidate + 1;
+                }
+            }
+            if (sender < 0) {
+                return;
+            }
+
+            node_id_allocator_msg_t request = boards[sender].next_request();
+            node_id_allocator_msg_t response;
+            now += 100000;
+            if (node_id_allocator_handle_request(&allocator, &request, now, &response)) {
+                // responses are broadcast, every waiting board sees them
+                for (int i = 0; i < nb_boards; i++) {
+                    if (boards[i].node_id == NODE_ID_ALLOCATOR_NONE) {
+                        boards[i].receive(&response);
+                    }
+                }
+            } else {
+                boards[sender].confirmed_len = 0;
+            }
+        }
+    }
+};
+
+TEST(NodeIdAllocatorTestGroup, AllocatesTopNodeIdByDefault)
+{
+    simulated_board board(1);
+
+    run_bus(&board, 1);
+
+    CHECK_EQUAL(NODE_ID_ALLOCATOR_MAX_NODE_ID, board.node_id);
+    CHECK_EQUAL(1, nb_persisted);
+    CHECK_EQUAL(NODE_ID_ALLOCATOR_MAX_NODE_ID, node_id_allocator_get_node_id(&allocator, board.unique_id));
+}
+
+TEST(NodeIdAllocatorTestGroup, AllocatesPreferredNodeId)
+{
+    simulated_board board(1, 42);
+
+    run_bus(&board, 1);
+
+    CHECK_EQUAL(42, board.node_id);
+}
+
+TEST(NodeIdAllocatorTestGroup, NeverAllocatesUsedNodeIds)
+{
+    simulated_board board(1, MASTER_NODE_ID);
+    node_id_allocator_node_seen(&allocator, MASTER_NODE_ID + 1);
+
+    run_bus(&board, 1);
+
+    CHECK_EQUAL(MASTER_NODE_ID + 2, board.node_id);
+}
+
+TEST(NodeIdAllocatorTestGroup, SearchesDownwardsWhenTopIsTaken)
+{
+    simulated_board board(1, NODE_ID_ALLOCATOR_MAX_NODE_ID);
+    node_id_allocator_node_seen(&allocator, NODE_ID_ALLOCATOR_MAX_NODE_ID);
+
+    run_bus(&board, 1);
+
+    CHECK_EQUAL(NODE_ID_ALLOCATOR_MAX_NODE_ID - 1, board.node_id);
+}
+
+TEST(NodeIdAllocatorTestGroup, SeveralBoardsGetDistinctIds)
+{
+    simulated_board boards[3] = {simulated_board(1, 20), simulated_board(50, 20), simulated_board(100, 20)};
+
+    run_bus(boards, 3);
+
+    CHECK(boards[0].node_id != NODE_ID_ALLOCATOR_NONE);
+    CHECK(boards[1].node_id != NODE_ID_ALLOCATOR_NONE);
+    CHECK(boards[2].node_id != NODE_ID_ALLOCATOR_NONE);
+    CHECK(boards[0].node_id != boards[1].node_id);
+    CHECK(boards[1].node_id != boards[2].node_id);
+    CHECK(boards[0].node_id != boards[2].node_id);
+}
+
+TEST(NodeIdAllocatorTestGroup, RebootedBoardGetsSameId)
+{
+    simulated_board board(1, 20);
+    run_bus(&board, 1);
+
+    simulated_board rebooted(1, 30);
+    run_bus(&rebooted, 1);
+
+    CHECK_EQUAL(20, rebooted.node_id);
+    CHECK_EQUAL(1, nb_persisted);
+}
+
+TEST(NodeIdAllocatorTestGroup, FollowupAfterTimeoutIsIgnored)
+{
+    simulated_board board(1);
+    node_id_allocator_msg_t request = board.next_request();
+    node_id_allocator_msg_t response;
+
+    CHECK_TRUE(node_id_allocator_handle_request(&allocator, &request, 0, &response));
+    board.receive(&response);
+    request = board.next_request();
+
+    CHECK_FALSE(node_id_allocator_handle_request(&allocator, &request,
+                                                 NODE_ID_ALLOCATOR_FOLLOWUP_TIMEOUT_US + 1,
+                                                 &response));
+}
+
+TEST(NodeIdAllocatorTestGroup, FollowupWithoutFirstPartIsIgnored)
+{
+    simulated_board board(1);
+    board.confirmed_len = NODE_ID_ALLOCATOR_MAX_PART_LEN;
+    node_id_allocator_msg_t request = board.next_request();
+    node_id_allocator_msg_t response;
+
+    CHECK_FALSE(node_id_allocator_handle_request(&allocator, &request, 0, &response));
+}
+
+TEST(NodeIdAllocatorTestGroup, FullTableAllocatesNothing)
+{
+    simulated_board boards[TABLE_LEN + 1] = {
+        simulated_board(1), simulated_board(20), simulated_board(40),
+        simulated_board(60), simulated_board(80),
+    };
+
+    run_bus(boards, TABLE_LEN);
+    run_bus(&boards[TABLE_LEN], 1);
+
+    CHECK_EQUAL(NODE_ID_ALLOCATOR_NONE, boards[TABLE_LEN].node_id);
+}
+
+TEST(NodeIdAllocatorTestGroup, RestoredAllocationIsKept)
+{
+    simulated_board board(1);
+    node_id_allocator_restore(&allocator, board.unique_id, 33);
+
+    run_bus(&board, 1);
+
+    CHECK_EQUAL(33, board.node_id);
+    CHECK_EQUAL(0, nb_persisted);
+}
+
+TEST(NodeIdAllocatorTestGroup, RestoringNoneRemovesAllocation)
+{
+    simulated_board board(1);
+    node_id_allocator_restore(&allocator, board.unique_id, 33);
+    node_id_allocator_restore(&allocator, board.unique_id, NODE_ID_ALLOCATOR_NONE);
+
+    CHECK_EQUAL(NODE_ID_ALLOCATOR_NONE, node_id_allocator_get_node_id(&allocator, board.unique_id));
+}
+
+TEST(NodeIdAllocatorTestGroup, ReleasedNodeIdCanBeReused)
+{
+    simulated_board old_board(1, 20);
+    run_bus(&old_board, 1);
+
+    CHECK_EQUAL(0, node_id_allocator_release(&allocator, 20));
+    CHECK_EQUAL(NODE_ID_ALLOCATOR_NONE, last_persisted_node_id);
+
+    simulated_board new_board(50, 20);
+    run_bus(&new_board, 1);
+    CHECK_EQUAL(20, new_board.node_id);
+}
+
+TEST(NodeIdAllocatorTestGroup, ReleasingUnknownNodeIdFails)
+{
+    CHECK_EQUAL(-1, node_id_allocator_release(&allocator, 20));
+}
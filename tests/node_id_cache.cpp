@@ -0,0 +1,153 @@
+#include <string.h>
+#include "CppUTest/TestHarness.h"
+#include "../src/node_id_cache.h"
+
+#define NB_RECORDS 4
+
+static uint8_t flash[NB_RECORDS * sizeof(node_id_cache_record_t)];
+
+static void program(void *dst, const void *src, size_t len)
+{
+    // like flash, programming can only clear bits
+    uint8_t *d = (uint8_t *)dst;
+    const uint8_t *s = (const uint8_t *)src;
+    for (size_t i = 0; i < len; i++) {
+        d[i] &= s[i];
+    }
+}
+
+static void erase(void)
+{
+    memset(flash, 0xff, sizeof(flash));
+}
+
+TEST_GROUP(NodeIdCacheTestGroup)
+{
+    node_id_cache_t cache;
+
+    void setup()
+    {
+        erase();
+        node_id_cache_init(&cache, flash, sizeof(flash), program, erase);
+    }
+
+    void reopen()
+    {
+        node_id_cache_init(&cache, flash, sizeof(flash), program, erase);
+    }
+};
+
+TEST(NodeIdCacheTestGroup, RecordIsThirtyTwoBytes)
+{
+    CHECK_EQUAL(32, sizeof(node_id_cache_record_t));
+}
+
+TEST(NodeIdCacheTestGroup, ErasedCacheIsEmpty)
+{
+    CHECK_EQUAL(0, cache.nb_written);
+    CHECK_EQUAL(NB_RECORDS, node_id_cache_free_slots(&cache));
+    CHECK_EQUAL(NODE_ID_CACHE_NOT_FOUND, node_id_cache_lookup(&cache, "foo"));
+}
+
+TEST(NodeIdCacheTestGroup, StoredMappingSurvivesReopen)
+{
+    node_id_cache_store(&cache, "foo", 42);
+    node_id_cache_store(&cache, "bar", 12);
+    reopen();
+
+    CHECK_EQUAL(2, cache.nb_written);
+    CHECK_EQUAL(42, node_id_cache_lookup(&cache, "foo"));
+    CHECK_EQUAL(12, node_id_cache_lookup(&cache, "bar"));
+}
+
+TEST(NodeIdCacheTestGroup, NewestRecordWins)
+{
+    node_id_cache_store(&cache, "foo", 42);
+    node_id_cache_store(&cache, "foo", 43);
+
+    CHECK_EQUAL(43, node_id_cache_lookup(&cache, "foo"));
+}
+
+TEST(NodeIdCacheTestGroup, UnchangedMappingIsNotWrittenAgain)
+{
+    node_id_cache_store(&cache, "foo", 42);
+    node_id_cache_store(&cache, "foo", 42);
+
+    CHECK_EQUAL(1, cache.nb_written);
+}
+
+TEST(NodeIdCacheTestGroup, LongStringIdIsComparedOnFullLength)
+{
+    node_id_cache_store(&cache, "abcdefghijklmnopqrstuvwx", 1);
+    node_id_cache_store(&cache, "abcdefghijklmnopqrstuvwy", 2);
+
+    CHECK_EQUAL(1, node_id_cache_lookup(&cache, "abcdefghijklmnopqrstuvwx"));
+    CHECK_EQUAL(2, node_id_cache_lookup(&cache, "abcdefghijklmnopqrstuvwy"));
+}
+
+TEST(NodeIdCacheTestGroup, CorruptedRecordIsSkipped)
+{
+    node_id_cache_store(&cache, "foo", 42);
+    node_id_cache_store(&cache, "foo", 43);
+    flash[sizeof(node_id_cache_record_t) + 4] = 0; // interrupted write
+    reopen();
+
+    CHECK_EQUAL(2, cache.nb_written);
+    CHECK_EQUAL(42, node_id_cache_lookup(&cache, "foo"));
+}
+
+TEST(NodeIdCacheTestGroup, FullCacheRefusesRecords)
+{
+    for (int i = 0; i < NB_RECORDS; i++) {
+        CHECK_EQUAL(0, node_id_cache_store(&cache, "foo", i));
+    }
+
+    CHECK_EQUAL(-1, node_id_cache_store(&cache, "foo", 10));
+    CHECK_EQUAL(0, node_id_cache_free_slots(&cache));
+}
+
+TEST(NodeIdCacheTestGroup, CompactionKeepsNewestRecords)
+{
+    node_id_cache_record_t scratch[NB_RECORDS];
+    node_id_cache_store(&cache, "foo", 1);
+    node_id_cache_store(&cache, "bar", 2);
+    node_id_cache_store(&cache, "foo", 3);
+    node_id_cache_store(&cache, "bar", 4);
+
+    CHECK_EQUAL(2, node_id_cache_compact(&cache, scratch, NB_RECORDS));
+    reopen();
+
+    CHECK_EQUAL(2, cache.nb_written);
+    CHECK_EQUAL(3, node_id_cache_lookup(&cache, "foo"));
+    CHECK_EQUAL(4, node_id_cache_lookup(&cache, "bar"));
+}
+
+TEST(NodeIdCacheTestGroup, UniqueIdsAndStringIdsAreSeparateKeys)
+{
+    uint8_t unique_id[NODE_ID_CACHE_UNIQUE_ID_LEN] = {'f', 'o', 'o'};
+    node_id_cache_store(&cache, "foo", 42);
+    node_id_cache_store_unique_id(&cache, unique_id, 43);
+
+    CHECK_EQUAL(42, node_id_cache_lookup(&cache, "foo"));
+    CHECK_EQUAL(43, node_id_cache_lookup_unique_id(&cache, unique_id));
+}
+
+static void count_visits(const uint8_t *key, uint8_t can_id, void *arg)
+{
+    (void)key;
+    int *sum = (int *)arg;
+    *sum = *sum * 100 + can_id;
+}
+
+TEST(NodeIdCacheTestGroup, ForeachVisitsOneTypeOldestFirst)
+{
+    uint8_t unique_id[NODE_ID_CACHE_UNIQUE_ID_LEN] = {1, 2, 3};
+    int visits = 0;
+    node_id_cache_store_unique_id(&cache, unique_id, 12);
+    node_id_cache_store(&cache, "foo", 42);
+    node_id_cache_store_unique_id(&cache, unique_id, NODE_ID_CACHE_NOT_FOUND);
+
+    node_id_cache_foreach(&cache, NODE_ID_CACHE_UNIQUE_ID, count_visits, &visits);
+
+    CHECK_EQUAL(12 * 100 + NODE_ID_CACHE_NOT_FOUND, visits);
+}
@@ -0,0 +1,76 @@
+#include "CppUTest/TestHarness.h"
+#include "../src/node_tracker.h"
+
+#define HEALTH_OK 0
+#define MODE_OPERATIONAL 0
+
+TEST_GROUP(NodeTrackerTestGroup)
+{
+    node_tracker_t tracker;
+
+    void setup()
+    {
+        node_tracker_init(&tracker);
+    }
+};
+
+TEST(NodeTrackerTestGroup, UnknownNodeIsOffline)
+{
+    CHECK_FALSE(node_tracker_is_online(&tracker, 42, 0));
+    CHECK_FALSE(tracker.nodes[42].seen);
+}
+
+TEST(NodeTrackerTestGroup, NodeStatusIsRecorded)
+{
+    node_tracker_update(&tracker, 42, 1000, 12, 1, 2);
+
+    CHECK_TRUE(tracker.nodes[42].seen);
+    CHECK_EQUAL(1000, tracker.nodes[42].last_seen_us);
+    CHECK_EQUAL(12, tracker.nodes[42].uptime_s);
+    CHECK_EQUAL(1, tracker.nodes[42].health);
+    CHECK_EQUAL(2, tracker.nodes[42].mode);
+}
+
+TEST(NodeTrackerTestGroup, NodeGoesOfflineAfterTimeout)
+{
+    node_tracker_update(&tracker, 42, 1000, 12, HEALTH_OK, MODE_OPERATIONAL);
+
+    CHECK_TRUE(node_tracker_is_online(&tracker, 42, 1000 + NODE_TRACKER_OFFLINE_TIMEOUT_US - 1));
+    CHECK_FALSE(node_tracker_is_online(&tracker, 42, 1000 + NODE_TRACKER_OFFLINE_TIMEOUT_US));
+}
+
+TEST(NodeTrackerTestGroup, FirstStatusIsNotAReboot)
+{
+    CHECK_FALSE(node_tracker_update(&tracker, 42, 1000, 0, HEALTH_OK, MODE_OPERATIONAL));
+}
+
+TEST(NodeTrackerTestGroup, IncreasingUptimeIsNotAReboot)
+{
+    node_tracker_update(&tracker, 42, 0, 100, HEALTH_OK, MODE_OPERATIONAL);
+
+    CHECK_FALSE(node_tracker_update(&tracker, 42, 1000000, 101, HEALTH_OK, MODE_OPERATIONAL));
+    CHECK_FALSE(node_tracker_update(&tracker, 42, 2000000, 101, HEALTH_OK, MODE_OPERATIONAL));
+    CHECK_EQUAL(0, tracker.nodes[42].reboots);
+}
+
+TEST(NodeTrackerTestGroup, UptimeGoingBackwardsIsAReboot)
+{
+    node_tracker_update(&tracker, 42, 0, 100, HEALTH_OK, MODE_OPERATIONAL);
+
+    CHECK_TRUE(node_tracker_update(&tracker, 42, 1000000, 0, HEALTH_OK, MODE_OPERATIONAL));
+    CHECK_EQUAL(1, tracker.nodes[42].reboots);
+}
+
+TEST(NodeTrackerTestGroup, RebootWhileOfflineIsDetected)
+{
+    node_tracker_update(&tracker, 42, 0, 5, HEALTH_OK, MODE_OPERATIONAL);
+
+    // back after a minute, but only up for 30 seconds
+    CHECK_TRUE(node_tracker_update(&tracker, 42, 60000000, 30, HEALTH_OK, MODE_OPERATIONAL));
+}
+
+TEST(NodeTrackerTestGroup, InvalidIdIsIgnored)
+{
+    CHECK_FALSE(node_tracker_update(&tracker, NODE_TRACKER_NB_NODES, 0, 0, HEALTH_OK, MODE_OPERATIONAL));
+    CHECK_FALSE(node_tracker_is_online(&tracker, NODE_TRACKER_NB_NODES, 0));
+}
@@ -0,0 +1,111 @@
+#include "CppUTest/TestHarness.h"
+#include <math.h>
+#include "../src/pose_history.h"
+
+#define HISTORY_LEN 4
+
+TEST_GROUP(PoseHistoryTestGroup)
+{
+    pose_history_t history;
+    pose_history_entry_t buffer[HISTORY_LEN];
+    struct robot_base_pose_2d_s pose;
+
+    void setup(void)
+    {
+        pose_history_init(&history, buffer, HISTORY_LEN);
+    }
+
+    void push(uint32_t timestamp, float x, float y, float theta)
+    {
+        struct robot_base_pose_2d_s p = {x, y, theta};
+        pose_history_push(&history, timestamp, &p);
+    }
+};
+
+TEST(PoseHistoryTestGroup, EmptyHistoryHasNoPose)
+{
+    CHECK_EQUAL(POSE_HISTORY_TOO_RECENT, pose_history_get(&history, 0, &pose));
+}
+
+TEST(PoseHistoryTestGroup, ExactSampleIsReturned)
+{
+    push(100, 1, 2, 0.5);
+    push(200, 3, 4, 0.6);
+
+    CHECK_EQUAL(POSE_HISTORY_OK, pose_history_get(&history, 200, &pose));
+    DOUBLES_EQUAL(3, pose.x, 1e-6);
+    DOUBLES_EQUAL(4, pose.y, 1e-6);
+    DOUBLES_EQUAL(0.6, pose.theta, 1e-6);
+
+    CHECK_EQUAL(POSE_HISTORY_OK, pose_history_get(&history, 100, &pose));
+    DOUBLES_EQUAL(1, pose.x, 1e-6);
+}
+
+TEST(PoseHistoryTestGroup, PoseIsInterpolated)
+{
+    push(100, 0, 0, 0);
+    push(200, 1, 2, 0.4);
+    push(300, 2, 2, 0.4);
+
+    CHECK_EQUAL(POSE_HISTORY_OK, pose_history_get(&history, 125, &pose));
+    DOUBLES_EQUAL(0.25, pose.x, 1e-6);
+    DOUBLES_EQUAL(0.5, pose.y, 1e-6);
+    DOUBLES_EQUAL(0.1, pose.theta, 1e-6);
+
+    CHECK_EQUAL(POSE_HISTORY_OK, pose_history_get(&history, 250, &pose));
+    DOUBLES_EQUAL(1.5, pose.x, 1e-6);
+}
+
+TEST(PoseHistoryTestGroup, TimeOutsideHistoryIsAnError)
+{
+    push(100, 0, 0, 0);
+    push(200, 1, 0, 0);
+
+    CHECK_EQUAL(POSE_HISTORY_TOO_OLD, pose_history_get(&history, 99, &pose));
+    CHECK_EQUAL(POSE_HISTORY_TOO_RECENT, pose_history_get(&history, 201, &pose));
+}
+
+TEST(PoseHistoryTestGroup, OldestSamplesAreOverwritten)
+{
+    int i;
+    for (i = 0; i < HISTORY_LEN + 2; i++) {
+        push(100 * i, i, 0, 0);
+    }
+
+    CHECK_EQUAL(POSE_HISTORY_TOO_OLD, pose_history_get(&history, 150, &pose));
+    CHECK_EQUAL(POSE_HISTORY_OK, pose_history_get(&history, 250, &pose));
+    DOUBLES_EQUAL(2.5, pose.x, 1e-6);
+    CHECK_EQUAL(POSE_HISTORY_OK, pose_history_get(&history, 500, &pose));
+    DOUBLES_EQUAL(5, pose.x, 1e-6);
+}
+
+TEST(PoseHistoryTestGroup, HeadingIsInterpolatedTheShortWay)
+{
+    push(100, 0, 0, 3.1);
+    push(200, 0, 0, -3.1);
+
+    CHECK_EQUAL(POSE_HISTORY_OK, pose_history_get(&history, 150, &pose));
+    // half way is pi, which may come out as -pi
+    DOUBLES_EQUAL(M_PI, fabs(pose.theta), 1e-5);
+}
+
+TEST(PoseHistoryTestGroup, InterpolatedHeadingStaysInRange)
+{
+    push(100, 0, 0, 3.1);
+    push(200, 0, 0, -3.1);
+
+    // past the +-pi crossing
+    CHECK_EQUAL(POSE_HISTORY_OK, pose_history_get(&history, 175, &pose));
+    DOUBLES_EQUAL(3.1 + 0.75 * (2 * M_PI - 6.2) - 2 * M_PI, pose.theta, 1e-5);
+    CHECK(pose.theta >= -M_PI && pose.theta <= M_PI);
+}
+
+TEST(PoseHistoryTestGroup, TimestampsMayWrapAround)
+{
+    push(0xffffff00, 0, 0, 0);
+    push(0x00000100, 2, 0, 0);
+
+    CHECK_EQUAL(POSE_HISTORY_OK, pose_history_get(&history, 0, &pose));
+    DOUBLES_EQUAL(1, pose.x, 1e-6);
+    CHECK_EQUAL(POSE_HISTORY_TOO_OLD, pose_history_get(&history, 0xfffffe00, &pose));
+}
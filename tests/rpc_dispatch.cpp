@@ -0,0 +1,213 @@
+#include <cstring>
+#include "CppUTest/TestHarness.h"
+#include <cmp/cmp.h>
+#include <cmp_mem_access/cmp_mem_access.h>
+#include "../src/rpc_dispatch.h"
+
+TEST_GROUP(RPCDispatchTableTestGroup)
+{
+    rpc_dispatch_table_t table;
+
+    void setup(void)
+    {
+        rpc_dispatch_table_init(&table);
+    }
+};
+
+TEST(RPCDispatchTableTestGroup, EmptyTableFindsNothing)
+{
+    CHECK_EQUAL(RPC_DISPATCH_NOT_FOUND, rpc_dispatch_table_find(&table, "foo", 3));
+}
+
+TEST(RPCDispatchTableTestGroup, CanFindNames)
+{
+    rpc_dispatch_table_add(&table, "foo", 0);
+    rpc_dispatch_table_add(&table, "bar", 1);
+    rpc_dispatch_table_add(&table, "actuator_velocity", 2);
+
+    CHECK_EQUAL(0, rpc_dispatch_table_find(&table, "foo", 3));
+    CHECK_EQUAL(1, rpc_dispatch_table_find(&table, "bar", 3));
+    CHECK_EQUAL(2, rpc_dispatch_table_find(&table, "actuator_velocity", 17));
+}
+
+TEST(RPCDispatchTableTestGroup, PrefixIsNotAMatch)
+{
+    rpc_dispatch_table_add(&table, "actuator_velocity", 0);
+
+    CHECK_EQUAL(RPC_DISPATCH_NOT_FOUND, rpc_dispatch_table_find(&table, "actuator", 8));
+}
+
+TEST(RPCDispatchTableTestGroup, NameDoesNotNeedToBeTerminated)
+{
+    rpc_dispatch_table_add(&table, "foo", 0);
+
+    CHECK_EQUAL(0, rpc_dispatch_table_find(&table, "foobar", 3));
+}
+
+TEST(RPCDispatchTableTestGroup, DuplicateNameIsRejected)
+{
+    CHECK_EQUAL(0, rpc_dispatch_table_add(&table, "foo", 0));
+    CHECK_EQUAL(-1, rpc_dispatch_table_add(&table, "foo", 1));
+    CHECK_EQUAL(0, rpc_dispatch_table_find(&table, "foo", 3));
+}
+
+TEST(RPCDispatchTableTestGroup, TableKeepsHalfOfTheSlotsFree)
+{
+    char names[RPC_DISPATCH_TABLE_SIZE][8];
+    int i;
+
+    for (i = 0; i < RPC_DISPATCH_TABLE_SIZE / 2; i++) {
+        snprintf(names[i], sizeof(names[i]), "m%d", i);
+        CHECK_EQUAL(0, rpc_dispatch_table_add(&table, names[i], i));
+    }
+    snprintf(names[i], sizeof(names[i]), "m%d", i);
+    CHECK_EQUAL(-1, rpc_dispatch_table_add(&table, names[i], i));
+
+    for (i = 0; i < RPC_DISPATCH_TABLE_SIZE / 2; i++) {
+        CHECK_EQUAL(i, rpc_dispatch_table_find(&table, names[i], strlen(names[i])));
+    }
+}
+
+static int last_called;
+static int32_t last_arg;
+
+static void foo_cb(void *p, cmp_ctx_t *input)
+{
+    (void) p;
+    last_called = 0;
+    cmp_read_int(input, &last_arg);
+}
+
+static void bar_cb(void *p, cmp_ctx_t *input)
+{
+    (void) p;
+    last_called = 1;
+    cmp_read_int(input, &last_arg);
+}
+
+TEST_GROUP(MessageDispatcherTestGroup)
+{
+    struct message_method_s callbacks[2];
+    message_dispatcher_t dispatcher;
+    uint8_t buffer[64];
+    cmp_ctx_t ctx;
+    cmp_mem_access_t mem;
+
+    void setup(void)
+    {
+        memset(callbacks, 0, sizeof(callbacks));
+        callbacks[0].name = "foo";
+        callbacks[0].cb = foo_cb;
+        callbacks[1].name = "bar";
+        callbacks[1].cb = bar_cb;
+        message_dispatcher_init(&dispatcher, callbacks, 2);
+
+        last_called = -1;
+        last_arg = 0;
+        cmp_mem_access_init(&ctx, &mem, buffer, sizeof(buffer));
+    }
+};
+
+TEST(MessageDispatcherTestGroup, DispatchesByName)
+{
+    cmp_write_array(&ctx, 2);
+    cmp_write_str(&ctx, "bar", 3);
+    cmp_write_int(&ctx, 42);
+
+    CHECK_TRUE(message_dispatcher_process(&dispatcher, buffer, cmp_mem_access_get_pos(&mem)));
+    CHECK_EQUAL(1, last_called);
+    CHECK_EQUAL(42, last_arg);
+}
+
+TEST(MessageDispatcherTestGroup, DispatchesByNumericId)
+{
+    cmp_write_array(&ctx, 2);
+    cmp_write_uint(&ctx, 0);
+    cmp_write_int(&ctx, 23);
+
+    CHECK_TRUE(message_dispatcher_process(&dispatcher, buffer, cmp_mem_access_get_pos(&mem)));
+    CHECK_EQUAL(0, last_called);
+    CHECK_EQUAL(23, last_arg);
+}
+
+TEST(MessageDispatcherTestGroup, UnknownNameIsIgnored)
+{
+    cmp_write_array(&ctx, 2);
+    cmp_write_str(&ctx, "baz", 3);
+    cmp_write_int(&ctx, 42);
+
+    CHECK_FALSE(message_dispatcher_process(&dispatcher, buffer, cmp_mem_access_get_pos(&mem)));
+    CHECK_EQUAL(-1, last_called);
+}
+
+TEST(MessageDispatcherTestGroup, OutOfRangeIdIsIgnored)
+{
+    cmp_write_array(&ctx, 2);
+    cmp_write_uint(&ctx, 2);
+    cmp_write_int(&ctx, 42);
+
+    CHECK_FALSE(message_dispatcher_process(&dispatcher, buffer, cmp_mem_access_get_pos(&mem)));
+    CHECK_EQUAL(-1, last_called);
+}
+
+TEST(MessageDispatcherTestGroup, LookupDoesNotCallAnything)
+{
+    cmp_write_array(&ctx, 2);
+    cmp_write_str(&ctx, "bar", 3);
+    cmp_write_int(&ctx, 42);
+
+    CHECK_EQUAL(1, message_dispatcher_lookup(&dispatcher, buffer, cmp_mem_access_get_pos(&mem)));
+    CHECK_EQUAL(-1, last_called);
+}
+
+TEST(MessageDispatcherTestGroup, LookupOfTruncatedHeaderFails)
+{
+    cmp_write_array(&ctx, 2);
+    cmp_write_str(&ctx, "bar", 3);
+
+    CHECK_EQUAL(RPC_DISPATCH_NOT_FOUND, message_dispatcher_lookup(&dispatcher, buffer, 3));
+}
+
+TEST(MessageDispatcherTestGroup, SubsetKeepsTheMethodIds)
+{
+    message_dispatcher_t subset;
+    const bool accepted[] = {false, true};
+    message_dispatcher_init_subset(&subset, callbacks, 2, accepted);
+
+    cmp_write_array(&ctx, 2);
+    cmp_write_str(&ctx, "bar", 3);
+    cmp_write_int(&ctx, 42);
+    size_t len = cmp_mem_access_get_pos(&mem);
+
+    CHECK_EQUAL(message_dispatcher_lookup(&dispatcher, buffer, len),
+                message_dispatcher_lookup(&subset, buffer, len));
+
+    cmp_mem_access_init(&ctx, &mem, buffer, sizeof(buffer));
+    cmp_write_array(&ctx, 2);
+    cmp_write_uint(&ctx, 1);
+    cmp_write_int(&ctx, 23);
+
+    CHECK_TRUE(message_dispatcher_process(&subset, buffer, cmp_mem_access_get_pos(&mem)));
+    CHECK_EQUAL(1, last_called);
+    CHECK_EQUAL(23, last_arg);
+}
+
+TEST(MessageDispatcherTestGroup, SubsetIgnoresOtherMethods)
+{
+    message_dispatcher_t subset;
+    const bool accepted[] = {false, true};
+    message_dispatcher_init_subset(&subset, callbacks, 2, accepted);
+
+    cmp_write_array(&ctx, 2);
+    cmp_write_str(&ctx, "foo", 3);
+    cmp_write_int(&ctx, 42);
+    CHECK_FALSE(message_dispatcher_process(&subset, buffer, cmp_mem_access_get_pos(&mem)));
+
+    cmp_mem_access_init(&ctx, &mem, buffer, sizeof(buffer));
+    cmp_write_array(&ctx, 2);
+    cmp_write_uint(&ctx, 0);
+    cmp_write_int(&ctx, 42);
+    CHECK_FALSE(message_dispatcher_process(&subset, buffer, cmp_mem_access_get_pos(&mem)));
+
+    CHECK_EQUAL(-1, last_called);
+}
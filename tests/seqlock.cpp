@@ -0,0 +1,102 @@
+#include <thread>
+#include <atomic>
+#include "CppUTest/TestHarness.h"
+#include "../src/seqlock.h"
+
+TEST_GROUP(SeqlockTestGroup)
+{
+    seqlock_t lock;
+
+    void setup(void)
+    {
+        seqlock_init(&lock);
+    }
+};
+
+TEST(SeqlockTestGroup, ReadWithoutWriteSucceeds)
+{
+    uint32_t seq = seqlock_read_begin(&lock);
+
+    CHECK_FALSE(seqlock_read_retry(&lock, seq));
+}
+
+TEST(SeqlockTestGroup, ConcurrentWriteForcesRetry)
+{
+    uint32_t seq = seqlock_read_begin(&lock);
+
+    seqlock_write_begin(&lock);
+    seqlock_write_end(&lock);
+
+    CHECK_TRUE(seqlock_read_retry(&lock, seq));
+}
+
+TEST(SeqlockTestGroup, CountsWrites)
+{
+    seqlock_write_begin(&lock);
+    CHECK_EQUAL(0, seqlock_write_count(&lock));
+    seqlock_write_end(&lock);
+    CHECK_EQUAL(1, seqlock_write_count(&lock));
+}
+
+/* Same layout as a timestamped pose: every field holds the same value, so a
+ * torn read shows up as differing fields. */
+struct sample {
+    float x, y, theta;
+    uint32_t timestamp;
+};
+
+TEST(SeqlockTestGroup, ReadersNeverSeeTornData)
+{
+    const int nb_writes = 200000;
+    const int nb_readers = 3;
+    static volatile sample data;
+    std::atomic<bool> done(false);
+    std::atomic<int> torn(0);
+    std::atomic<int> reads(0);
+
+    auto writer = [&]() {
+        for (int i = 1; i <= nb_writes; i++) {
+            seqlock_write_begin(&lock);
+            data.x = i;
+            data.y = i;
+            data.theta = i;
+            data.timestamp = i;
+            seqlock_write_end(&lock);
+        }
+        done = true;
+    };
+
+    auto reader = [&]() {
+        while (!done) {
+            sample s;
+            uint32_t seq;
+            do {
+                seq = seqlock_read_begin(&lock);
+                s.x = data.x;
+                s.y = data.y;
+                s.theta = data.theta;
+                s.timestamp = data.timestamp;
+            } while (seqlock_read_retry(&lock, seq));
+
+            if (s.x != s.y || s.x != s.theta || s.x != (float)s.timestamp) {
+                torn++;
+            }
+            reads++;
+        }
+    };
+
+    std::thread readers[nb_readers];
+    for (auto &t : readers) {
+        t = std::thread(reader);
+    }
+    std::thread w(writer);
+
+    w.join();
+    for (auto &t : readers) {
+        t.join();
+    }
+
+    CHECK_EQUAL(0, torn.load());
+    CHECK(reads.load() > 0);
+    CHECK_EQUAL(nb_writes, seqlock_write_count(&lock));
+}
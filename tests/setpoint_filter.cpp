@@ -0,0 +1,70 @@
+#include "CppUTest/TestHarness.h"
+#include "../src/setpoint_filter.h"
+
+TEST_GROUP(SetpointFilterTestGroup)
+{
+    setpoint_filter_t filter;
+    const float deadband = 0.1;
+    const uint32_t keepalive = 500000;
+
+    void setup()
+    {
+        setpoint_filter_init(&filter);
+    }
+};
+
+TEST(SetpointFilterTestGroup, FirstSetpointIsSent)
+{
+    CHECK_TRUE(setpoint_filter_should_send(&filter, 1, 3.f, 0, deadband, keepalive));
+    CHECK_EQUAL(1, filter.sent);
+    CHECK_EQUAL(0, filter.suppressed);
+}
+
+TEST(SetpointFilterTestGroup, UnchangedSetpointIsSuppressed)
+{
+    setpoint_filter_should_send(&filter, 1, 3.f, 0, deadband, keepalive);
+
+    CHECK_FALSE(setpoint_filter_should_send(&filter, 1, 3.05f, 1000, deadband, keepalive));
+    CHECK_EQUAL(1, filter.sent);
+    CHECK_EQUAL(1, filter.suppressed);
+}
+
+TEST(SetpointFilterTestGroup, ChangeOutsideDeadbandIsSent)
+{
+    setpoint_filter_should_send(&filter, 1, 3.f, 0, deadband, keepalive);
+
+    CHECK_TRUE(setpoint_filter_should_send(&filter, 1, 3.2f, 1000, deadband, keepalive));
+}
+
+TEST(SetpointFilterTestGroup, DeadbandIsRelativeToLastSentValue)
+{
+    setpoint_filter_should_send(&filter, 1, 3.f, 0, deadband, keepalive);
+    setpoint_filter_should_send(&filter, 1, 3.08f, 1000, deadband, keepalive);
+
+    // slow drift is sent once it exceeds the deadband
+    CHECK_TRUE(setpoint_filter_should_send(&filter, 1, 3.16f, 2000, deadband, keepalive));
+}
+
+TEST(SetpointFilterTestGroup, ModeChangeIsSent)
+{
+    setpoint_filter_should_send(&filter, 1, 3.f, 0, deadband, keepalive);
+
+    CHECK_TRUE(setpoint_filter_should_send(&filter, 2, 3.f, 1000, deadband, keepalive));
+}
+
+TEST(SetpointFilterTestGroup, KeepaliveIsSent)
+{
+    setpoint_filter_should_send(&filter, 1, 3.f, 0, deadband, keepalive);
+
+    CHECK_FALSE(setpoint_filter_should_send(&filter, 1, 3.f, keepalive - 1, deadband, keepalive));
+    CHECK_TRUE(setpoint_filter_should_send(&filter, 1, 3.f, keepalive, deadband, keepalive));
+    CHECK_FALSE(setpoint_filter_should_send(&filter, 1, 3.f, keepalive + 1, deadband, keepalive));
+}
+
+TEST(SetpointFilterTestGroup, ZeroKeepaliveDisablesFilter)
+{
+    setpoint_filter_should_send(&filter, 1, 3.f, 0, deadband, 0);
+
+    CHECK_TRUE(setpoint_filter_should_send(&filter, 1, 3.f, 1000, deadband, 0));
+    CHECK_EQUAL(2, filter.sent);
+}
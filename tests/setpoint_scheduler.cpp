@@ -0,0 +1,86 @@
+#include "CppUTest/TestHarness.h"
+#include "../src/setpoint_scheduler.h"
+
+TEST_GROUP(SetpointSchedulerTestGroup)
+{
+    setpoint_scheduler_t sched;
+    setpoint_scheduler_entry_t buffer[4];
+    uint16_t id;
+
+    void setup()
+    {
+        setpoint_scheduler_init(&sched, buffer, 4);
+    }
+};
+
+TEST(SetpointSchedulerTestGroup, EmptySchedulerHasNothingDue)
+{
+    uint32_t due;
+
+    CHECK_FALSE(setpoint_scheduler_pop_due(&sched, 1000, &id));
+    CHECK_FALSE(setpoint_scheduler_next_due(&sched, &due));
+}
+
+TEST(SetpointSchedulerTestGroup, EntryIsNotPoppedBeforeDue)
+{
+    setpoint_scheduler_add(&sched, 1, 100);
+
+    CHECK_FALSE(setpoint_scheduler_pop_due(&sched, 99, &id));
+    CHECK_TRUE(setpoint_scheduler_pop_due(&sched, 100, &id));
+    CHECK_EQUAL(1, id);
+    CHECK_FALSE(setpoint_scheduler_pop_due(&sched, 100, &id));
+}
+
+TEST(SetpointSchedulerTestGroup, EntriesArePoppedInDueOrder)
+{
+    uint32_t due;
+    setpoint_scheduler_add(&sched, 1, 300);
+    setpoint_scheduler_add(&sched, 2, 100);
+    setpoint_scheduler_add(&sched, 3, 400);
+    setpoint_scheduler_add(&sched, 4, 200);
+
+    CHECK_TRUE(setpoint_scheduler_next_due(&sched, &due));
+    CHECK_EQUAL(100, due);
+
+    setpoint_scheduler_pop_due(&sched, 1000, &id);
+    CHECK_EQUAL(2, id);
+    setpoint_scheduler_pop_due(&sched, 1000, &id);
+    CHECK_EQUAL(4, id);
+    setpoint_scheduler_pop_due(&sched, 1000, &id);
+    CHECK_EQUAL(1, id);
+    setpoint_scheduler_pop_due(&sched, 1000, &id);
+    CHECK_EQUAL(3, id);
+}
+
+TEST(SetpointSchedulerTestGroup, FullSchedulerRejectsEntries)
+{
+    for (int i = 0; i < 4; i++) {
+        CHECK_EQUAL(0, setpoint_scheduler_add(&sched, i, 100));
+    }
+    CHECK_EQUAL(-1, setpoint_scheduler_add(&sched, 4, 100));
+}
+
+TEST(SetpointSchedulerTestGroup, OrderSurvivesTimestampWrapAround)
+{
+    setpoint_scheduler_add(&sched, 1, 10);
+    setpoint_scheduler_add(&sched, 2, UINT32_MAX - 10);
+
+    CHECK_TRUE(setpoint_scheduler_pop_due(&sched, UINT32_MAX, &id));
+    CHECK_EQUAL(2, id);
+    CHECK_FALSE(setpoint_scheduler_pop_due(&sched, UINT32_MAX, &id));
+    CHECK_TRUE(setpoint_scheduler_pop_due(&sched, 10, &id));
+    CHECK_EQUAL(1, id);
+}
+
+TEST(SetpointSchedulerTestGroup, NextSlotIsAlignedOnPhase)
+{
+    CHECK_EQUAL(1020, setpoint_scheduler_next_slot(1000, 50, 20));
+    CHECK_EQUAL(1070, setpoint_scheduler_next_slot(1020, 50, 20));
+    CHECK_EQUAL(1070, setpoint_scheduler_next_slot(1021, 50, 20));
+}
+
+TEST(SetpointSchedulerTestGroup, NextSlotIsAlignedAcrossWrapAround)
+{
+    // 2^32 is a multiple of 16
+    CHECK_EQUAL(4, setpoint_scheduler_next_slot(UINT32_MAX - 5, 16, 4));
+}
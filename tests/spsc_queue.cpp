@@ -0,0 +1,88 @@
+#include <thread>
+#include "CppUTest/TestHarness.h"
+#include "../src/spsc_queue.h"
+
+#define QUEUE_LEN 4
+
+TEST_GROUP(SPSCQueueTestGroup)
+{
+    spsc_queue_t queue;
+    uint32_t buffer[QUEUE_LEN];
+
+    void setup(void)
+    {
+        spsc_queue_init(&queue, buffer, sizeof(uint32_t), QUEUE_LEN);
+    }
+};
+
+TEST(SPSCQueueTestGroup, LengthMustBeAPowerOfTwo)
+{
+    CHECK_EQUAL(-1, spsc_queue_init(&queue, buffer, sizeof(uint32_t), 3));
+    CHECK_EQUAL(-1, spsc_queue_init(&queue, buffer, sizeof(uint32_t), 0));
+    CHECK_EQUAL(0, spsc_queue_init(&queue, buffer, sizeof(uint32_t), 4));
+}
+
+TEST(SPSCQueueTestGroup, EmptyQueueCannotBePopped)
+{
+    uint32_t item;
+
+    CHECK_FALSE(spsc_queue_pop(&queue, &item));
+}
+
+TEST(SPSCQueueTestGroup, ItemsComeOutInOrder)
+{
+    uint32_t a = 1, b = 2, item;
+
+    CHECK_TRUE(spsc_queue_push(&queue, &a));
+    CHECK_TRUE(spsc_queue_push(&queue, &b));
+
+    CHECK_TRUE(spsc_queue_pop(&queue, &item));
+    CHECK_EQUAL(1, item);
+    CHECK_TRUE(spsc_queue_pop(&queue, &item));
+    CHECK_EQUAL(2, item);
+    CHECK_FALSE(spsc_queue_pop(&queue, &item));
+}
+
+TEST(SPSCQueueTestGroup, FullQueueRefusesItems)
+{
+    uint32_t i, item;
+
+    for (i = 0; i < QUEUE_LEN; i++) {
+        CHECK_TRUE(spsc_queue_push(&queue, &i));
+    }
+    CHECK_FALSE(spsc_queue_push(&queue, &i));
+
+    CHECK_TRUE(spsc_queue_pop(&queue, &item));
+    CHECK_EQUAL(0, item);
+    CHECK_TRUE(spsc_queue_push(&queue, &i));
+}
+
+TEST(SPSCQueueTestGroup, ItemsSurviveConcurrentAccess)
+{
+    const uint32_t nb_items = 100000;
+    static uint32_t large_buffer[256];
+    uint32_t errors = 0;
+
+    spsc_queue_init(&queue, large_buffer, sizeof(uint32_t), 256);
+
+    std::thread producer([&]() {
+        for (uint32_t i = 0; i < nb_items; i++) {
+            while (!spsc_queue_push(&queue, &i)) {
+                std::this_thread::yield();
+            }
+        }
+    });
+
+    for (uint32_t expected = 0; expected < nb_items; expected++) {
+        uint32_t item;
+        while (!spsc_queue_pop(&queue, &item)) {
+            std::this_thread::yield();
+        }
+        if (item != expected) {
+            errors++;
+        }
+    }
+    producer.join();
+
+    CHECK_EQUAL(0, errors);
+}
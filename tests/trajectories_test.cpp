@@ -237,6 +237,39 @@ TEST(TrajectoriesReadTestGroup, ReadRoundsToNearest)
     LONGS_EQUAL(5 * dt, traj.read_time_us);
 }
 
+TEST(TrajectoriesReadTestGroup, PeekDoesNotChangeTheReadPointer)
+{
+    int64_t time = traj.read_time_us + 4 * dt;
+    traj.last_defined_time_us = time;
+
+    float *res = trajectory_peek(&traj, time);
+
+    POINTERS_EQUAL(&traj.buffer[4], res);
+    CHECK_EQUAL(0, traj.read_index);
+    LONGS_EQUAL(0, traj.read_time_us);
+}
+
+TEST(TrajectoriesReadTestGroup, PeekRoundsToNearestAndWrapsAround)
+{
+    traj.read_index = 98;
+    traj.read_time_us = 10 * dt;
+    traj.last_defined_time_us = 20 * dt;
+
+    float *res = trajectory_peek(&traj, 12.7 * dt);
+
+    // 3 points after the read pointer, past the end of the buffer
+    POINTERS_EQUAL(&traj.buffer[1], res);
+}
+
+TEST(TrajectoriesReadTestGroup, PeekOutsideDefinedRangeReturnsNull)
+{
+    traj.read_time_us = 10 * dt;
+    traj.last_defined_time_us = 20 * dt;
+
+    POINTERS_EQUAL(NULL, trajectory_peek(&traj, 9 * dt));
+    POINTERS_EQUAL(NULL, trajectory_peek(&traj, 21 * dt));
+}
+
 TEST_GROUP(TrajectoriesMultipleDimensionTestGroup)
 {
     const uint64_t dt = 100;
@@ -445,3 +478,26 @@ TEST(TrajectoryCopyFromBufferGroup, WriteIndexAlreadyWrapped)
     CHECK_EQUAL(points[1], traj_buffer[2]);
     CHECK_EQUAL(points[2], traj_buffer[3]);
 }
+
+TEST_GROUP(TrajectorySegmentTestGroup)
+{
+};
+
+TEST(TrajectorySegmentTestGroup, SamplingTimeFitsInSegment)
+{
+    CHECK_TRUE(trajectory_segment_sampling_time_ok(10000));
+    CHECK_TRUE(trajectory_segment_sampling_time_ok(TRAJECTORY_SEGMENT_MAX_SAMPLING_TIME_US));
+}
+
+TEST(TrajectorySegmentTestGroup, SamplingTimeAboveUint16IsRejected)
+{
+    // would be truncated to 0 by the uint16 delta_t field
+    CHECK_FALSE(trajectory_segment_sampling_time_ok(65536));
+    CHECK_FALSE(trajectory_segment_sampling_time_ok(100000));
+}
+
+TEST(TrajectorySegmentTestGroup, NonPositiveSamplingTimeIsRejected)
+{
+    CHECK_FALSE(trajectory_segment_sampling_time_ok(0));
+    CHECK_FALSE(trajectory_segment_sampling_time_ok(-1));
+}
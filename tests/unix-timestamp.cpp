@@ -63,6 +63,15 @@ TEST(UnixTimeStampTestGroup, CanConvertToUnixTimeStampUsingReference)
     CHECK_EQUAL(10, r.us);
 }
 
+TEST(UnixTimeStampTestGroup, KnowsWhenReferenceIsSet)
+{
+    CHECK_FALSE(timestamp_unix_reference_is_set());
+
+    timestamp_set_reference({.s=100, .us=0}, 2000);
+
+    CHECK_TRUE(timestamp_unix_reference_is_set());
+}
+
 TEST(UnixTimeStampTestGroup, OverflowsGracefully)
 {
     unix_timestamp_t r;